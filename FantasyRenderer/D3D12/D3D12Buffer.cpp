@@ -2,21 +2,16 @@
 
 #include "D3D12Device.h"
 
-D3D12Buffer::D3D12Buffer(D3D12Device* InDevice, const D3D12BufferDesc& InDesc, D3D12Buffer* InAliasingBuffer/* = nullptr*/)
+D3D12Buffer::D3D12Buffer(D3D12Device* InDevice, const D3D12BufferDesc& InDesc, UINT64 InOffsetInHeap/* = INVALID_SIZE_64*/)
     : Device(InDevice),
       Desc(InDesc),
       ResourceLocation(InDevice->GetResourceAllocator(), ConvertToED3D12ResourceLocationType(InDesc.Type))
 {
-    UINT64 OffsetInHeap = INVALID_SIZE_64;
-    if (InAliasingBuffer)
+    // 放在外部预留的区间上时, 区间由预留者释放
+    if (InOffsetInHeap != INVALID_SIZE_64)
     {
-        if (Desc.CanAlias(InAliasingBuffer->GetDesc()))
-        {
-            InAliasingBuffer->NoNeedToRelease();
-            OffsetInHeap = InAliasingBuffer->ResourceLocation.GetOffset();
-            
-            CPUDescriptor = InAliasingBuffer->CPUDescriptor;
-        }
+        ThrowIfFalse(Desc.Type == ED3D12BufferType::Default, "Only default buffer can be placed at given offset.");
+        ResourceLocation.bOwnLocation = false;
     }
     
     D3D12_RESOURCE_DESC BufferDesc;
@@ -38,7 +33,7 @@ D3D12Buffer::D3D12Buffer(D3D12Device* InDevice, const D3D12BufferDesc& InDesc, D
     LocationDesc.Size = Desc.Size;
     
     D3D12ResourceAllocator* ResourceAllocator = Device->GetResourceAllocator();
-    ThrowIfFalse(ResourceAllocator->TryAllocate(&ResourceLocation, &LocationDesc, OffsetInHeap), "Memory allocate failed.");
+    ThrowIfFalse(ResourceAllocator->TryAllocate(&ResourceLocation, &LocationDesc, InOffsetInHeap), "Memory allocate failed.");
 }
 
 D3D12Buffer::D3D12Buffer(D3D12Buffer* InBuffer) : ResourceLocation(nullptr, ED3D12ResourceLocationType::Invalid)
@@ -53,6 +48,7 @@ D3D12Buffer::D3D12Buffer(D3D12Buffer* InBuffer) : ResourceLocation(nullptr, ED3D
     ResourceLocation.Resource = InBuffer->ResourceLocation.Resource;        InBuffer->ResourceLocation.Resource = nullptr;
     ResourceLocation.Location = InBuffer->ResourceLocation.Location;
     ResourceLocation.NeedRelease = InBuffer->ResourceLocation.NeedRelease;  InBuffer->ResourceLocation.NeedRelease = false;
+    ResourceLocation.bOwnLocation = InBuffer->ResourceLocation.bOwnLocation;
 
     CPUDescriptor = InBuffer->CPUDescriptor;
     InBuffer->CPUDescriptor.Reset();
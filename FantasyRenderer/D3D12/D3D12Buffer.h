@@ -27,7 +27,8 @@ class D3D12Buffer
 public:
     CLASS_NO_COPY(D3D12Buffer)
 
-    D3D12Buffer(D3D12Device* InDevice, const D3D12BufferDesc& InDesc, D3D12Buffer* InAliasingBuffer = nullptr);
+    // InOffsetInHeap不为INVALID_SIZE_64时放在Default Buffer堆中外部预留的区间上
+    D3D12Buffer(D3D12Device* InDevice, const D3D12BufferDesc& InDesc, UINT64 InOffsetInHeap = INVALID_SIZE_64);
     explicit D3D12Buffer(D3D12Buffer* InBuffer);
     ~D3D12Buffer() noexcept;
 
@@ -61,13 +61,20 @@ void D3D12CommandList::CreateTransitionBarrier(ID3D12Resource* InResource, ED3D1
 {
     if (InOldState == InNewState) return;
 
+    CreateTransitionBarrier(InResource, ConvertToD3D12ResourceStates(InOldState), ConvertToD3D12ResourceStates(InNewState), D3D12_RESOURCE_BARRIER_FLAG_NONE);
+}
+
+void D3D12CommandList::CreateTransitionBarrier(ID3D12Resource* InResource, D3D12_RESOURCE_STATES InOldState, D3D12_RESOURCE_STATES InNewState, D3D12_RESOURCE_BARRIER_FLAGS InFlags)
+{
+    if (InOldState == InNewState) return;
+
     D3D12_RESOURCE_BARRIER Barrier;
-    Barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    Barrier.Flags = InFlags;
     Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
     Barrier.Transition.pResource = InResource;
     Barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    Barrier.Transition.StateBefore = ConvertToD3D12ResourceStates(InOldState);
-    Barrier.Transition.StateAfter = ConvertToD3D12ResourceStates(InNewState);
+    Barrier.Transition.StateBefore = InOldState;
+    Barrier.Transition.StateAfter = InNewState;
     PendingBarriers.push_back(Barrier);
 }
 
@@ -124,19 +131,22 @@ void D3D12CommandList::CreateAliasingBarrier(ID3D12Resource* InOldResource, ID3D
 
 void D3D12CommandList::BeginRenderPass(const D3D12RenderPassDesc& InDesc) const
 {
+    const UINT32 RenderTargetNum = static_cast<UINT32>(InDesc.RenderTargets.size());
+    ThrowIfFalse(RenderTargetNum <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT, "Too many render targets.");
+    
     if (HasFlag(InDesc.Flags, ED3D12RenderPassFlags::UseLegacy))
     {
-        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> RTVs;
-        for (UINT32 ix = 0; ix < InDesc.RenderTargets.size(); ++ix)
+        D3D12_CPU_DESCRIPTOR_HANDLE RTVs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        for (UINT32 ix = 0; ix < RenderTargetNum; ++ix)
         {
             const auto RenderTarget = InDesc.RenderTargets[ix];
 
-            RTVs.push_back(RenderTarget->GetCPUDescriptor().GetCPUHandle());
+            RTVs[ix] = RenderTarget->GetCPUDescriptor().GetCPUHandle();
 
             if (InDesc.RenderTargetAccessTypes[ix] == ED3D12AccessType::Clear_Preserve)
             {
                 const auto ClearValue = RenderTarget->GetDesc()->ClearValue.GetNative();
-                CmdList->ClearRenderTargetView(RTVs.back(), ClearValue->Color, 0, nullptr);
+                CmdList->ClearRenderTargetView(RTVs[ix], ClearValue->Color, 0, nullptr);
             }
         }
 
@@ -159,12 +169,12 @@ void D3D12CommandList::BeginRenderPass(const D3D12RenderPassDesc& InDesc) const
                 CmdList->ClearDepthStencilView(DSV, ClearFlag, ClearValue->DepthStencil.Depth, ClearValue->DepthStencil.Stencil, 0, nullptr);
             }
         }
-        CmdList->OMSetRenderTargets(static_cast<UINT>(RTVs.size()), RTVs.data(), false, InDesc.DepthStencil ? &DSV : nullptr);
+        CmdList->OMSetRenderTargets(RenderTargetNum, RTVs, false, InDesc.DepthStencil ? &DSV : nullptr);
     }
     else
     {
-        std::vector<D3D12_RENDER_PASS_RENDER_TARGET_DESC> RenderTargetDescs;
-        for (UINT32 ix = 0; ix < InDesc.RenderTargets.size(); ++ix)
+        D3D12_RENDER_PASS_RENDER_TARGET_DESC RenderTargetDescs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        for (UINT32 ix = 0; ix < RenderTargetNum; ++ix)
         {
             const auto RenderTarget = InDesc.RenderTargets[ix];
             
@@ -177,7 +187,7 @@ void D3D12CommandList::BeginRenderPass(const D3D12RenderPassDesc& InDesc) const
                 &RenderTargetDesc.EndingAccess.Type
             );
 
-            RenderTargetDescs.push_back(RenderTargetDesc);
+            RenderTargetDescs[ix] = RenderTargetDesc;
         }
 
         D3D12_RENDER_PASS_DEPTH_STENCIL_DESC DepthStencilDesc{};
@@ -201,8 +211,8 @@ void D3D12CommandList::BeginRenderPass(const D3D12RenderPassDesc& InDesc) const
             );
         }
         CmdList->BeginRenderPass(
-            static_cast<UINT>(RenderTargetDescs.size()),
-            RenderTargetDescs.data(),
+            RenderTargetNum,
+            RenderTargetDescs,
             InDesc.DepthStencil ? &DepthStencilDesc : nullptr,
             ConvertToD3D12RenderPassFlags(InDesc.Flags)
         );
@@ -1,11 +1,17 @@
 ﻿#pragma once
 
+#include <memory_resource>
+
 #include "D3D12CommandQueue.h"
 
 struct D3D12RenderPassDesc
 {
-    std::vector<D3D12Texture*> RenderTargets;
-    std::vector<ED3D12AccessType> RenderTargetAccessTypes;
+    explicit D3D12RenderPassDesc(std::pmr::memory_resource* InResource = std::pmr::get_default_resource())
+        : RenderTargets(InResource), RenderTargetAccessTypes(InResource)
+    {}
+    
+    std::pmr::vector<D3D12Texture*> RenderTargets;
+    std::pmr::vector<ED3D12AccessType> RenderTargetAccessTypes;
     D3D12Texture* DepthStencil = nullptr;
     ED3D12AccessType DepthAccessType;
     ED3D12AccessType StencilAccessType;
@@ -41,6 +47,8 @@ public:
     void CreateBufferTransitionBarrier(D3D12Buffer* InBuffer, ED3D12ResourceState InNewState);
     void CreateTextureTransitionBarrier(D3D12Texture* InTexture, ED3D12ResourceState InNewState);
     void CreateTransitionBarrier(ID3D12Resource* InResource, ED3D12ResourceState InOldState, ED3D12ResourceState InNewState);
+    // 状态可以是多个只读状态的组合, InFlags用于拆分的BEGIN_ONLY/END_ONLY屏障
+    void CreateTransitionBarrier(ID3D12Resource* InResource, D3D12_RESOURCE_STATES InOldState, D3D12_RESOURCE_STATES InNewState, D3D12_RESOURCE_BARRIER_FLAGS InFlags);
 
     ID3D12GraphicsCommandList* GetNative() const { return CmdList.Get(); }
     D3D12Device* GetDevice() const { return Device;}
@@ -72,25 +72,17 @@ bool D3D12GPUDescriptorHeap::TryAllocate(D3D12Descriptor* OutDescriptor, UINT32
     if (RingBuffer.TryAllocate(&Index, InNum))
     {
         *OutDescriptor = GetDescriptor(Index);
-        CurrentFrameAllocation += InNum;
         return true;
     }
     return false;
 }
 
-void D3D12GPUDescriptorHeap::FinishFrameAllocation()
+void D3D12GPUDescriptorHeap::FinishFrameAllocation(UINT64 InFrameIndex)
 {
-    std::lock_guard LockGuard(Mutex);
-
-    FrameAllocations.push(CurrentFrameAllocation);
-    CurrentFrameAllocation = 0;
+    RingBuffer.MarkFrame(InFrameIndex);
 }
 
-void D3D12GPUDescriptorHeap::ClearFrameDescriptors()
+void D3D12GPUDescriptorHeap::ClearFrameDescriptors(UINT64 InFrameIndex)
 {
-    std::lock_guard LockGuard(Mutex);
-
-    const UINT32 Size = FrameAllocations.front();
-    FrameAllocations.pop();
-    RingBuffer.TryFree(Size);
+    RingBuffer.RetireFrames(InFrameIndex);
 }
@@ -3,7 +3,7 @@
 #include <queue>
 
 #include "D3D12Descriptor.h"
-#include "../MultiThreading/ConcurrentFreeListAllocator.h"
+#include "../MultiThreading/ConcurrentIndexAllocator.h"
 #include "../MultiThreading/ConcurrentRingAllocator.h"
 
 struct D3D12DescriptorHeapDesc
@@ -48,7 +48,7 @@ public:
     void ClearFrameDescriptors();
     
 private:
-    ConcurrentFreeListAllocator FreeList;
+    ConcurrentIndexAllocator FreeList;
 };
 
 class D3D12GPUDescriptorHeap : public D3D12DescriptorHeap
@@ -61,8 +61,8 @@ public:
 
 public:
     bool TryAllocate(D3D12Descriptor* OutDescriptor, UINT32 InNum = 1);
-    void FinishFrameAllocation();
-    void ClearFrameDescriptors();
+    void FinishFrameAllocation(UINT64 InFrameIndex);
+    void ClearFrameDescriptors(UINT64 InFrameIndex);
 
 public:
     D3D12Descriptor GetPreservedDescriptor() const { return PreservedDescriptor; }
@@ -70,9 +70,5 @@ public:
 private:
     ConcurrentRingAllocator RingBuffer;
 
-    std::mutex Mutex;
-    std::queue<UINT32> FrameAllocations;
-    UINT32 CurrentFrameAllocation = 0;
-
     D3D12Descriptor PreservedDescriptor;
 };
\ No newline at end of file
@@ -202,7 +202,12 @@ D3D12Descriptor D3D12Device::CreateBufferUAV(D3D12Buffer* InBuffer) const
 
 D3D12Descriptor D3D12Device::CreateTextureView(D3D12Texture* InTexture) const
 {
-    switch (InTexture->GetDesc()->State)
+    return CreateTextureView(InTexture, InTexture->GetDesc()->State);
+}
+
+D3D12Descriptor D3D12Device::CreateTextureView(D3D12Texture* InTexture, ED3D12ResourceState InViewState) const
+{
+    switch (InViewState)
     {
     case ED3D12ResourceState::DepthRead:
     case ED3D12ResourceState::DepthWrite:
@@ -274,16 +279,16 @@ void D3D12Device::CopyDescriptor(const D3D12Descriptor& InDst, const D3D12Descri
     Device->CopyDescriptorsSimple(1, InDst.GetCPUHandle(), InSrc.GetCPUHandle(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
 
-void D3D12Device::FinishFrameAllocation()
+void D3D12Device::FinishFrameAllocation(UINT64 InFrameIndex)
 {
-    GPUDescriptorHeap->FinishFrameAllocation();
-    ResourceAllocator->FinishFrameAllocation();
+    GPUDescriptorHeap->FinishFrameAllocation(InFrameIndex);
+    ResourceAllocator->FinishFrameAllocation(InFrameIndex);
 }
 
-void D3D12Device::ClearFrameResource()
+void D3D12Device::ClearFrameResource(UINT64 InFrameIndex)
 {
-    GPUDescriptorHeap->ClearFrameDescriptors();
-    ResourceAllocator->ClearFrameResource();
+    GPUDescriptorHeap->ClearFrameDescriptors(InFrameIndex);
+    ResourceAllocator->ClearFrameResource(InFrameIndex);
 }
 
 void D3D12Device::FreeCPUDescriptor(D3D12Descriptor InDescriptor) const
@@ -19,8 +19,8 @@ public:
     void ExecuteGraphicsCommandLists(std::span<D3D12CommandList*>) const;
     D3D12Descriptor AllocateCPUDescriptor(ED3D12DescriptorType InType) const;
     D3D12Descriptor AllocateGPUDescriptor(UINT32 InNum = 1) const;
-    void FinishFrameAllocation();
-    void ClearFrameResource();
+    void FinishFrameAllocation(UINT64 InFrameIndex);
+    void ClearFrameResource(UINT64 InFrameIndex);   // 释放InFrameIndex及之前的帧中分配的常量和GPU描述符
     void FreeCPUDescriptor(D3D12Descriptor InDescriptor) const;
     D3D12Descriptor GetGPUDescriptor(UINT32 Index) const;
     D3D12Descriptor GetPreservedGPUDescriptor() const;
@@ -29,6 +29,7 @@ public:
     void CopyDescriptor(const D3D12Descriptor& InDst, const D3D12Descriptor& InSrc) const;
     D3D12Descriptor CreateBufferView(D3D12Buffer* InBuffer);
     D3D12Descriptor CreateTextureView(D3D12Texture* InTexture) const;
+    D3D12Descriptor CreateTextureView(D3D12Texture* InTexture, ED3D12ResourceState InViewState) const;
     
 
     ID3D12Device* GetNative() const { return Device.Get(); }
@@ -1,5 +1,7 @@
 ﻿#include "D3D12ResourceAllocator.h"
 
+#include <fstream>
+
 #include "D3D12Device.h"
 
 D3D12BufferAllocator::D3D12BufferAllocator(D3D12Device* InDevice, D3D12_HEAP_TYPE HeapType, UINT64 InCapacity)
@@ -49,42 +51,33 @@ void D3D12BufferAllocator::Clear()
     Allocator.Clear();
 }
 
-D3D12TextureAllocator::D3D12TextureAllocator(D3D12Device* InDevice, UINT64 InCapacity, UINT64 InTextureMaxSize, UINT64 InTextureMinSize)
+D3D12TextureAllocator::D3D12TextureAllocator(D3D12Device* InDevice, UINT64 InCapacity)
     : Device(InDevice),
-      Allocator(InCapacity, InTextureMaxSize, InTextureMinSize)
+      Allocator(InCapacity)
 {
-    const UINT32 IndexNum = Allocator.GetIndexNum();
-    
     D3D12_HEAP_DESC HeapDesc;
     HeapDesc.Alignment = 0;
     HeapDesc.Flags = D3D12_HEAP_FLAG_NONE;
     HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
     HeapDesc.SizeInBytes = InCapacity;
-
-    Heaps.resize(IndexNum + 1);
-    for (UINT32 ix = 0; ix <= IndexNum; ++ix)
-    {
-        ThrowIfFailed(Device->GetNative()->CreateHeap(&HeapDesc, IID_PPV_ARGS(Heaps[ix].GetAddressOf())));
-    }
+    ThrowIfFailed(Device->GetNative()->CreateHeap(&HeapDesc, IID_PPV_ARGS(Heap.GetAddressOf())));
 }
 
 
 bool D3D12TextureAllocator::TryAllocate(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InLocationDesc, UINT64 InOffset/* = INVALID_SIZE_64*/)
 {
+    // 按驱动实际要求的大小和对齐分配, 不再向上取到2的幂
+    const D3D12_RESOURCE_ALLOCATION_INFO AllocationInfo = Device->GetNative()->GetResourceAllocationInfo(0, 1, InLocationDesc->ResourceDesc);
+
     UINT64 Offset;
-    UINT64 Index;
-    const UINT64 Size = InLocationDesc->Size;
+    const UINT64 Size = AllocationInfo.SizeInBytes;
     
-    if (InOffset != INVALID_SIZE_64)
-    {
-        Offset = InOffset;
-        Index = Allocator.GetBlockIndex(Size);
-    }
-    else if (!Allocator.TryAllocate(&Offset, &Index, Size)) return false;
+    if (InOffset != INVALID_SIZE_64) Offset = InOffset;
+    else if (!Allocator.TryAllocate(&Offset, Size, AllocationInfo.Alignment)) return false;
 
     Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
     ThrowIfFailed(Device->GetNative()->CreatePlacedResource(
-            Heaps[Index].Get(),
+            Heap.Get(),
             Offset,
             InLocationDesc->ResourceDesc,
             InLocationDesc->ResourceState,
@@ -100,7 +93,7 @@ bool D3D12TextureAllocator::TryAllocate(D3D12ResourceLocation* OutLocation, cons
 
 bool D3D12TextureAllocator::TryFree(const D3D12ResourceLocation* InLocation)
 {
-    if (!Allocator.TryFree(InLocation->GetOffset(), InLocation->GetSize())) return false;
+    if (!Allocator.TryFree(InLocation->GetOffset())) return false;
     return true;
 }
 
@@ -143,37 +136,112 @@ bool D3D12ConstantAllocator::TryAllocate(D3D12ResourceLocation* OutLocation, con
     const UINT64 AlignedSize = Align(InLocationDesc->Size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
     if (!Allocator.TryAllocate(&Offset, AlignedSize)) return false;
 
-    CurrentFrameAllocation += static_cast<UINT32>(AlignedSize);
     OutLocation->SetLocation(Offset, AlignedSize);
     OutLocation->SetResource(ResourceHeap.Get());
     return true;
 }
 
-void D3D12ConstantAllocator::FinishFrameAllocation()
+void D3D12ConstantAllocator::FinishFrameAllocation(UINT64 InFrameIndex)
 {
-    std::lock_guard LockGuard(Mutex);
-    FrameAllocations.push(CurrentFrameAllocation);
-    CurrentFrameAllocation = 0;
+    Allocator.MarkFrame(InFrameIndex);
 }
 
-void D3D12ConstantAllocator::ClearFrameResource()
+void D3D12ConstantAllocator::ClearFrameResource(UINT64 InFrameIndex)
 {
-    std::lock_guard LockGuard(Mutex);
-         
-    const UINT32 Size = FrameAllocations.front();
-    FrameAllocations.pop();
-    Allocator.TryFree(Size);
+    Allocator.RetireFrames(InFrameIndex);
 }
 
 D3D12ResourceAllocator::D3D12ResourceAllocator(D3D12Device* InDevice)
     : ConstantAllocator(InDevice, HEAP_DEFAULT_SIZE),
-      TextureAllocator(InDevice, HEAP_DEFAULT_SIZE, TEXTURE_MAX_SIZE, TEXTURE_MIN_SIZE),
+      TextureAllocator(InDevice, HEAP_DEFAULT_SIZE),
       DefaultBufferAllocator(InDevice, D3D12_HEAP_TYPE_DEFAULT, HEAP_DEFAULT_SIZE),
       UploadBufferAllocator(InDevice, D3D12_HEAP_TYPE_UPLOAD, HEAP_DEFAULT_SIZE)
 {
 }
 
 bool D3D12ResourceAllocator::TryAllocate(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InDesc/* = nullptr*/, UINT64 InOffset/* = INVALID_SIZE_64*/)
+{
+    const bool bSucceeded = TryAllocateImpl(OutLocation, InDesc, InOffset);
+
+    // 指定了偏移的放置不经过分配器, 不记录
+    if (TraceRecorder.IsRecording() && InOffset == INVALID_SIZE_64)
+    {
+        const ED3D12ResourceLocationType Type = OutLocation->GetType();
+
+        UINT64 Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        if (Type == ED3D12ResourceLocationType::ConstantBuffer)
+        {
+            Alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+        }
+        else if (Type == ED3D12ResourceLocationType::Texture)
+        {
+            const D3D12_RESOURCE_DESC* ResourceDesc = InDesc->ResourceDesc;
+            if (ResourceDesc->Alignment != 0) Alignment = ResourceDesc->Alignment;
+            else if (ResourceDesc->SampleDesc.Count > 1) Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+        }
+
+        TraceRecorder.RecordAllocate(
+            static_cast<UINT8>(Type),
+            bSucceeded ? OutLocation->GetOffset() : INVALID_SIZE_64,
+            bSucceeded ? OutLocation->GetSize() : InDesc->Size,
+            Alignment,
+            bSucceeded
+        );
+    }
+    return bSucceeded;
+}
+
+bool D3D12ResourceAllocator::TryFree(const D3D12ResourceLocation* InLocation)
+{
+    const bool bSucceeded = TryFreeImpl(InLocation);
+    if (bSucceeded)
+    {
+        TraceRecorder.RecordFree(static_cast<UINT8>(InLocation->GetType()), InLocation->GetOffset(), InLocation->GetSize());
+    }
+    return bSucceeded;
+}
+
+bool D3D12ResourceAllocator::TryAllocateRange(ED3D12ResourceLocationType InType, UINT64 InSize, UINT64 InAlignment, UINT64* OutOffset)
+{
+    bool bSucceeded = false;
+    switch (InType)
+    {
+    case ED3D12ResourceLocationType::Texture:
+        bSucceeded = TextureAllocator.TryAllocateRange(OutOffset, InSize, InAlignment);
+        break;
+    case ED3D12ResourceLocationType::DefaultBuffer:
+        // 伙伴块的偏移按块大小对齐, 最小块即为D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+        ThrowIfFalse(InAlignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, "Default buffer range alignment is too large.");
+        bSucceeded = DefaultBufferAllocator.TryAllocateRange(OutOffset, InSize);
+        break;
+    default:
+        return false;
+    }
+
+    TraceRecorder.RecordAllocate(static_cast<UINT8>(InType), bSucceeded ? *OutOffset : INVALID_SIZE_64, InSize, InAlignment, bSucceeded);
+    return bSucceeded;
+}
+
+bool D3D12ResourceAllocator::TryFreeRange(ED3D12ResourceLocationType InType, UINT64 InOffset, UINT64 InSize)
+{
+    bool bSucceeded = false;
+    switch (InType)
+    {
+    case ED3D12ResourceLocationType::Texture:
+        bSucceeded = TextureAllocator.TryFreeRange(InOffset);
+        break;
+    case ED3D12ResourceLocationType::DefaultBuffer:
+        bSucceeded = DefaultBufferAllocator.TryFreeRange(InOffset, InSize);
+        break;
+    default:
+        return false;
+    }
+
+    if (bSucceeded) TraceRecorder.RecordFree(static_cast<UINT8>(InType), InOffset, InSize);
+    return bSucceeded;
+}
+
+bool D3D12ResourceAllocator::TryAllocateImpl(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InDesc, UINT64 InOffset)
 {
     switch (OutLocation->GetType())
     {
@@ -191,9 +259,8 @@ bool D3D12ResourceAllocator::TryAllocate(D3D12ResourceLocation* OutLocation, con
     }
 }
 
-bool D3D12ResourceAllocator::TryFree(const D3D12ResourceLocation* InLocation)
+bool D3D12ResourceAllocator::TryFreeImpl(const D3D12ResourceLocation* InLocation)
 {
-    
     switch (InLocation->GetType())
     {
     case ED3D12ResourceLocationType::Texture:
@@ -208,12 +275,68 @@ bool D3D12ResourceAllocator::TryFree(const D3D12ResourceLocation* InLocation)
     }
 }
 
-void D3D12ResourceAllocator::FinishFrameAllocation()
+void D3D12ResourceAllocator::FinishFrameAllocation(UINT64 InFrameIndex)
 {
-    ConstantAllocator.FinishFrameAllocation();
+    ConstantAllocator.FinishFrameAllocation(InFrameIndex);
+    TraceRecorder.RecordFrameEnd(InFrameIndex);
 }
 
-void D3D12ResourceAllocator::ClearFrameResource()
+void D3D12ResourceAllocator::ClearFrameResource(UINT64 InFrameIndex)
 {
-    ConstantAllocator.ClearFrameResource();
+    ConstantAllocator.ClearFrameResource(InFrameIndex);
+    TraceRecorder.RecordFrameRetire(InFrameIndex);
+}
+
+void D3D12ResourceAllocator::GetStats(D3D12_HEAP_TYPE InHeapType, AllocatorStats* OutStats) const
+{
+    *OutStats = AllocatorStats{};
+
+    AllocatorStats FirstStats, SecondStats;
+    switch (InHeapType)
+    {
+    case D3D12_HEAP_TYPE_DEFAULT:
+        TextureAllocator.GetStats(&FirstStats);
+        DefaultBufferAllocator.GetStats(&SecondStats);
+        break;
+    case D3D12_HEAP_TYPE_UPLOAD:
+        UploadBufferAllocator.GetStats(&FirstStats);
+        ConstantAllocator.GetStats(&SecondStats);
+        break;
+    default:
+        return;
+    }
+    OutStats->Merge(FirstStats);
+    OutStats->Merge(SecondStats);
+}
+
+void D3D12ResourceAllocator::DumpStats(const std::string& InFilePath) const
+{
+    std::ofstream Output(InFilePath, std::ios::trunc);
+    ThrowIfFalse(Output.is_open(), "Open allocator stats file " + InFilePath + " failed.");
+
+    AllocatorStats Stats;
+    auto WriteEntry = [&](const char* InName, bool bInLast)
+    {
+        Output << "    \"" << InName << "\": ";
+        WriteAllocatorStatsJson(Output, Stats);
+        Output << (bInLast ? "\n" : ",\n");
+    };
+
+    Output << "{\n";
+
+    GetStats(D3D12_HEAP_TYPE_DEFAULT, &Stats);
+    WriteEntry("DefaultHeap", false);
+    TextureAllocator.GetStats(&Stats, true);
+    WriteEntry("Texture", false);
+    DefaultBufferAllocator.GetStats(&Stats, true);
+    WriteEntry("DefaultBuffer", false);
+
+    GetStats(D3D12_HEAP_TYPE_UPLOAD, &Stats);
+    WriteEntry("UploadHeap", false);
+    UploadBufferAllocator.GetStats(&Stats, true);
+    WriteEntry("UploadBuffer", false);
+    ConstantAllocator.GetStats(&Stats, true);
+    WriteEntry("Constant", true);
+
+    Output << "}\n";
 }
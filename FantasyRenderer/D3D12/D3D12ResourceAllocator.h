@@ -1,9 +1,10 @@
 ﻿#pragma once
 
 #include "D3D12ResourceLocation.h"
-#include "../MultiThreading/ConcurrentBuddyAllocator.h"
+#include "../MultiThreading/AllocatorTrace.h"
+#include "../MultiThreading/ConcurrentBitmapBuddyAllocator.h"
 #include "../MultiThreading/ConcurrentRingAllocator.h"
-#include "../MultiThreading/ConcurrentSegListAllocator.h"
+#include "../MultiThreading/ConcurrentTLSFAllocator.h"
 
 class D3D12BufferAllocator
 {
@@ -17,12 +18,16 @@ public:
     bool TryAllocate(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InLocationDesc, UINT64 InOffset = INVALID_SIZE_64);
     bool TryFree(const D3D12ResourceLocation* InLocation);
 
+    bool TryAllocateRange(UINT64* OutOffset, UINT64 InSize) { return Allocator.TryAllocate(OutOffset, InSize); }
+    bool TryFreeRange(UINT64 InOffset, UINT64 InSize) { return Allocator.TryFree(InOffset, InSize); }
+
     void Clear();
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const { Allocator.GetStats(OutStats, bInCollectFreeRanges); }
 
 private:
     D3D12Device* Device;
     Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
-    ConcurrentBuddyAllocator Allocator;
+    ConcurrentBitmapBuddyAllocator Allocator;
 };
 
 class D3D12TextureAllocator
@@ -30,19 +35,23 @@ class D3D12TextureAllocator
 public:
     CLASS_NO_COPY(D3D12TextureAllocator)
 
-    D3D12TextureAllocator(D3D12Device* InDevice, UINT64 InCapacity, UINT64 InTextureMaxSize, UINT64 InTextureMinSize);
+    D3D12TextureAllocator(D3D12Device* InDevice, UINT64 InCapacity);
     ~D3D12TextureAllocator() = default;
 
 public:
     bool TryAllocate(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InLocationDesc, UINT64 InOffset = INVALID_SIZE_64);
     bool TryFree(const D3D12ResourceLocation* InLocation);
 
+    bool TryAllocateRange(UINT64* OutOffset, UINT64 InSize, UINT64 InAlignment) { return Allocator.TryAllocate(OutOffset, InSize, InAlignment); }
+    bool TryFreeRange(UINT64 InOffset) { return Allocator.TryFree(InOffset); }
+
     void Clear();
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const { Allocator.GetStats(OutStats, bInCollectFreeRanges); }
 
 private:
     D3D12Device* Device;
-    std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> Heaps;
-    ConcurrentSegListAllocator Allocator;
+    Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+    ConcurrentTLSFAllocator Allocator;
 };
 
 class D3D12ConstantAllocator
@@ -55,20 +64,17 @@ public:
 
 public:
     bool TryAllocate(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InDesc);
-    void FinishFrameAllocation();
-    void ClearFrameResource();
+    void FinishFrameAllocation(UINT64 InFrameIndex);
+    void ClearFrameResource(UINT64 InFrameIndex);
 
     UINT8* GetMappedData() const { return MappedData; }
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const { Allocator.GetStats(OutStats, bInCollectFreeRanges); }
     
 private:
     D3D12Device* Device;
     Microsoft::WRL::ComPtr<ID3D12Resource> ResourceHeap;
     ConcurrentRingAllocator Allocator;
     UINT8* MappedData = nullptr;
-
-    std::mutex Mutex;
-    std::queue<UINT32> FrameAllocations;
-    UINT32 CurrentFrameAllocation = 0;
 };
 
 
@@ -84,14 +90,35 @@ public:
     bool TryAllocate(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InDesc, UINT64 InOffset = INVALID_SIZE_64);
     bool TryFree(const D3D12ResourceLocation* InLocation);
 
-    void FinishFrameAllocation();
-    void ClearFrameResource();
+    // 只预留一段区间, 不创建资源, 之后用指定偏移的TryAllocate()在区间内放置资源.
+    // 只支持Texture和DefaultBuffer, RenderGraph用它为临时资源预留共用的内存
+    bool TryAllocateRange(ED3D12ResourceLocationType InType, UINT64 InSize, UINT64 InAlignment, UINT64* OutOffset);
+    bool TryFreeRange(ED3D12ResourceLocationType InType, UINT64 InOffset, UINT64 InSize);
+
+    void FinishFrameAllocation(UINT64 InFrameIndex);
+    void ClearFrameResource(UINT64 InFrameIndex);
     UINT8* GetConstantMappedData() const { return ConstantAllocator.GetMappedData(); }
 
+    // 只支持D3D12_HEAP_TYPE_DEFAULT(纹理和Default Buffer)和D3D12_HEAP_TYPE_UPLOAD(Upload Buffer和常量缓冲)
+    void GetStats(D3D12_HEAP_TYPE InHeapType, AllocatorStats* OutStats) const;
+
+    // 按堆类型导出每个分配器的统计和空闲区间, 用于离线分析
+    void DumpStats(const std::string& InFilePath) const;
+
+    // 录制之后所有的分配, 释放和帧边界, 停止时写入InFilePath, 用Tools/AllocatorReplay离线重放
+    void StartTraceRecording() { TraceRecorder.Start(); }
+    void StopTraceRecording(const std::string& InFilePath) { TraceRecorder.Stop(InFilePath); }
+
+private:
+    bool TryAllocateImpl(D3D12ResourceLocation* OutLocation, const D3D12ResourceLocationDesc* InDesc, UINT64 InOffset);
+    bool TryFreeImpl(const D3D12ResourceLocation* InLocation);
+
 private:
     D3D12ConstantAllocator ConstantAllocator;
     D3D12TextureAllocator TextureAllocator;
     D3D12BufferAllocator DefaultBufferAllocator;
     D3D12BufferAllocator UploadBufferAllocator;
+
+    AllocatorTraceRecorder TraceRecorder;
 };
 
@@ -12,7 +12,7 @@ D3D12ResourceLocation::~D3D12ResourceLocation() noexcept
     if (NeedRelease && Type != ED3D12ResourceLocationType::ConstantBuffer)
     {
         if (Resource) Resource->Release();
-        while (!ResourceAllocator->TryFree(this));
+        if (bOwnLocation) while (!ResourceAllocator->TryFree(this));
     }
 }
 
@@ -46,4 +46,5 @@ private:
     ID3D12Resource* Resource = nullptr;
     LocationData Location;
     bool NeedRelease = true;
+    bool bOwnLocation = true;   // 为false时所在的区间由外部预留和释放(如RenderGraph的临时资源), 析构时只释放资源
 };
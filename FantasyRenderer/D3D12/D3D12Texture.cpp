@@ -2,34 +2,31 @@
 
 #include "D3D12Device.h"
 
-D3D12Texture::D3D12Texture(D3D12Device* InDevice, const D3D12TextureDesc& InDesc, D3D12Texture* InAliasingTexture/* = nullptr*/)
-    : Device(InDevice),
-      Desc(InDesc),
-      ResourceLocation(InDevice->GetResourceAllocator(), ED3D12ResourceLocationType::Texture)
+static D3D12_RESOURCE_DESC GetTextureResourceDesc(const D3D12TextureDesc& InDesc)
 {
-    UINT64 OffsetInHeap = INVALID_SIZE_64;
-    if (InAliasingTexture)
-    {
-        if (Desc.CanAlias(InAliasingTexture->GetDesc()))
-        {
-            InAliasingTexture->NoNeedToRelease();
-            OffsetInHeap = InAliasingTexture->ResourceLocation.GetOffset();
-            
-            CPUDescriptor = InAliasingTexture->CPUDescriptor;
-        }
-    }
-    
     D3D12_RESOURCE_DESC TextureDesc;
     TextureDesc.Alignment = 0;
     TextureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    TextureDesc.Flags = ConvertToD3D12ResourceFlags(Desc.Flag);
-    TextureDesc.Format = Desc.Format;
-    TextureDesc.Width = Desc.Width;
-    TextureDesc.Height = Desc.Height;
+    TextureDesc.Flags = ConvertToD3D12ResourceFlags(InDesc.Flag);
+    TextureDesc.Format = InDesc.Format;
+    TextureDesc.Width = InDesc.Width;
+    TextureDesc.Height = InDesc.Height;
     TextureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;;
     TextureDesc.MipLevels = 1;
     TextureDesc.SampleDesc = { 1, 0 };
     TextureDesc.DepthOrArraySize = 1;
+    return TextureDesc;
+}
+
+D3D12Texture::D3D12Texture(D3D12Device* InDevice, const D3D12TextureDesc& InDesc, UINT64 InOffsetInHeap/* = INVALID_SIZE_64*/)
+    : Device(InDevice),
+      Desc(InDesc),
+      ResourceLocation(InDevice->GetResourceAllocator(), ED3D12ResourceLocationType::Texture)
+{
+    // 放在外部预留的区间上时, 区间由预留者释放
+    if (InOffsetInHeap != INVALID_SIZE_64) ResourceLocation.bOwnLocation = false;
+
+    D3D12_RESOURCE_DESC TextureDesc = GetTextureResourceDesc(Desc);
 
     const UINT32 PixelSize = GetDXGIPixelSize(Desc.Format);
     const UINT32 SubresourceNum = TextureDesc.DepthOrArraySize * TextureDesc.MipLevels;
@@ -42,7 +39,7 @@ D3D12Texture::D3D12Texture(D3D12Device* InDevice, const D3D12TextureDesc& InDesc
     LocationDesc.Size = Desc.Width * Desc.Height * PixelSize;
     
     D3D12ResourceAllocator* ResourceAllocator = Device->GetResourceAllocator();
-    ThrowIfFalse(ResourceAllocator->TryAllocate(&ResourceLocation, &LocationDesc, OffsetInHeap), "Memory allocate failed.");
+    ThrowIfFalse(ResourceAllocator->TryAllocate(&ResourceLocation, &LocationDesc, InOffsetInHeap), "Memory allocate failed.");
 }
 
 D3D12Texture::D3D12Texture(D3D12Texture* InTexture) : ResourceLocation(nullptr, ED3D12ResourceLocationType::Invalid)
@@ -57,6 +54,7 @@ D3D12Texture::D3D12Texture(D3D12Texture* InTexture) : ResourceLocation(nullptr,
     ResourceLocation.Resource = InTexture->ResourceLocation.Resource;        InTexture->ResourceLocation.Resource = nullptr;
     ResourceLocation.Location = InTexture->ResourceLocation.Location;
     ResourceLocation.NeedRelease = InTexture->ResourceLocation.NeedRelease;  InTexture->ResourceLocation.NeedRelease = false;
+    ResourceLocation.bOwnLocation = InTexture->ResourceLocation.bOwnLocation;
 
     UploadDataRequiredSize = InTexture->UploadDataRequiredSize;
 
@@ -66,6 +64,12 @@ D3D12Texture::D3D12Texture(D3D12Texture* InTexture) : ResourceLocation(nullptr,
     InTexture = nullptr;
 }
 
+D3D12_RESOURCE_ALLOCATION_INFO D3D12Texture::GetAllocationInfo(D3D12Device* InDevice, const D3D12TextureDesc& InDesc)
+{
+    const D3D12_RESOURCE_DESC TextureDesc = GetTextureResourceDesc(InDesc);
+    return InDevice->GetNative()->GetResourceAllocationInfo(0, 1, &TextureDesc);
+}
+
 D3D12Texture::~D3D12Texture() noexcept
 {
     FreeOwnCPUDescriptor();
@@ -114,6 +118,12 @@ void D3D12Texture::CreateOwnCPUDescriptor()
     CPUDescriptor = Device->CreateTextureView(this);
 }
 
+void D3D12Texture::CreateOwnCPUDescriptor(ED3D12ResourceState InViewState)
+{
+    FreeOwnCPUDescriptor();
+    CPUDescriptor = Device->CreateTextureView(this, InViewState);
+}
+
 void D3D12Texture::FreeOwnCPUDescriptor()
 {
     if (CPUDescriptor.IsValid())
@@ -26,14 +26,20 @@ class D3D12Texture
 public:
     CLASS_NO_COPY(D3D12Texture)
 
-    D3D12Texture(D3D12Device* InDevice, const D3D12TextureDesc& InDesc, D3D12Texture* InAliasingTexture = nullptr);
+    // InOffsetInHeap不为INVALID_SIZE_64时放在纹理堆中外部预留的区间上
+    D3D12Texture(D3D12Device* InDevice, const D3D12TextureDesc& InDesc, UINT64 InOffsetInHeap = INVALID_SIZE_64);
     explicit D3D12Texture(D3D12Texture* InTexture);
     ~D3D12Texture() noexcept;
 
 public:
+    // 在纹理堆中实际占用的大小和对齐
+    static D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(D3D12Device* InDevice, const D3D12TextureDesc& InDesc);
+
     void UploadData(D3D12CommandList* InCmdList, void* Data) const;
 
     void CreateOwnCPUDescriptor();
+    // RenderGraph中Desc.State只是一帧开始时的状态, 按Pass要求的状态创建描述符
+    void CreateOwnCPUDescriptor(ED3D12ResourceState InViewState);
     void FreeOwnCPUDescriptor();
 
     ID3D12Resource* GetNative() const { return ResourceLocation.GetResource(); }
@@ -215,16 +215,22 @@ void ModelLoader::LoadGLTFNode(const tinygltf::Model& InGLTFModel, const tinyglt
             std::vector<DirectX::XMFLOAT3> PositionForAABB(AttributeSize);
             
             CurrentMeshData.Vertices.resize(AttributeSize);
-            for (UINT32 ix = 0; ix < AttributeSize; ++ix)
-            {
-                CurrentMeshData.Vertices[ix].Position = *reinterpret_cast<DirectX::XMFLOAT3*>((PositionData) + ix * AttributeStride[0]);
-                CurrentMeshData.Vertices[ix].Normal = *reinterpret_cast<DirectX::XMFLOAT3*>(NormalData + ix * AttributeStride[1]);
-                CurrentMeshData.Vertices[ix].UV = *reinterpret_cast<DirectX::XMFLOAT2*>(UVData + ix * AttributeStride[2]);
-                //CurrentMeshData.Vertices[ix].Tangent = *reinterpret_cast<DirectX::XMFLOAT3*>(TangentData + ix * AttributeStride[3]);
-                CurrentMeshData.Vertices[ix].MeshIndex = static_cast<UINT32>(Model.MeshData.size() - 1);
-
-                PositionForAABB[ix] = CurrentMeshData.Vertices[ix].Position;
-            }
+            const UINT32 MeshIndex = static_cast<UINT32>(Model.MeshData.size() - 1);
+            Executor.ParallelFor(
+                0,
+                AttributeSize,
+                VertexGrainSize,
+                [&](UINT64 ix)
+                {
+                    CurrentMeshData.Vertices[ix].Position = *reinterpret_cast<DirectX::XMFLOAT3*>((PositionData) + ix * AttributeStride[0]);
+                    CurrentMeshData.Vertices[ix].Normal = *reinterpret_cast<DirectX::XMFLOAT3*>(NormalData + ix * AttributeStride[1]);
+                    CurrentMeshData.Vertices[ix].UV = *reinterpret_cast<DirectX::XMFLOAT2*>(UVData + ix * AttributeStride[2]);
+                    //CurrentMeshData.Vertices[ix].Tangent = *reinterpret_cast<DirectX::XMFLOAT3*>(TangentData + ix * AttributeStride[3]);
+                    CurrentMeshData.Vertices[ix].MeshIndex = MeshIndex;
+
+                    PositionForAABB[ix] = CurrentMeshData.Vertices[ix].Position;
+                }
+            );
             
             CurrentMeshData.MaterialIndex = GLTFPrimitives.material;
             CurrentMeshData.Box = CreateAABB(PositionForAABB);
@@ -240,42 +246,42 @@ void ModelLoader::LoadGLTFNode(const tinygltf::Model& InGLTFModel, const tinyglt
 
 DirectX::BoundingBox ModelLoader::CreateAABB(const std::vector<DirectX::XMFLOAT3>& InPosition)
 {
-    const auto XMinMax = std::minmax_element(
-        InPosition.begin(),
-        InPosition.end(),
-        [](const auto& lhs, const auto& rhs)
-        {
-            return lhs.x < rhs.x;    
-        }
-    );
-    const auto YMinMax = std::minmax_element(
-        InPosition.begin(),
-        InPosition.end(),
-        [](const auto& lhs, const auto& rhs)
+    struct MinMax
+    {
+        DirectX::XMFLOAT3 Min;
+        DirectX::XMFLOAT3 Max;
+    };
+
+    const MinMax Box = Executor.ParallelReduce(
+        0,
+        InPosition.size(),
+        VertexGrainSize,
+        MinMax{ InPosition[0], InPosition[0] },
+        [&InPosition](UINT64 ix, MinMax& InOutBox)
         {
-            return lhs.y < rhs.y;    
-        }
-    );
-    const auto ZMinMax = std::minmax_element(
-        InPosition.begin(),
-        InPosition.end(),
-        [](const auto& lhs, const auto& rhs)
+            DirectX::XMStoreFloat3(&InOutBox.Min, DirectX::XMVectorMin(DirectX::XMLoadFloat3(&InOutBox.Min), DirectX::XMLoadFloat3(&InPosition[ix])));
+            DirectX::XMStoreFloat3(&InOutBox.Max, DirectX::XMVectorMax(DirectX::XMLoadFloat3(&InOutBox.Max), DirectX::XMLoadFloat3(&InPosition[ix])));
+        },
+        [](const MinMax& InLhs, const MinMax& InRhs)
         {
-            return lhs.z < rhs.z;    
+            MinMax Result;
+            DirectX::XMStoreFloat3(&Result.Min, DirectX::XMVectorMin(DirectX::XMLoadFloat3(&InLhs.Min), DirectX::XMLoadFloat3(&InRhs.Min)));
+            DirectX::XMStoreFloat3(&Result.Max, DirectX::XMVectorMax(DirectX::XMLoadFloat3(&InLhs.Max), DirectX::XMLoadFloat3(&InRhs.Max)));
+            return Result;
         }
     );
     
     const DirectX::XMFLOAT3 Center(
-        (XMinMax.first->x + XMinMax.second->x) / 2.0f,
-        (YMinMax.first->y + YMinMax.second->y) / 2.0f,
-        (ZMinMax.first->z + ZMinMax.second->z) / 2.0f
+        (Box.Min.x + Box.Max.x) / 2.0f,
+        (Box.Min.y + Box.Max.y) / 2.0f,
+        (Box.Min.z + Box.Max.z) / 2.0f
     );
     
     // Max - Center相当于(Min + Max) / 2
     const DirectX::XMFLOAT3 Extents(
-        XMinMax.second->x - Center.x,
-        YMinMax.second->y - Center.y,
-        ZMinMax.second->z - Center.z
+        Box.Max.x - Center.x,
+        Box.Max.y - Center.y,
+        Box.Max.z - Center.z
     );    
 
     return DirectX::BoundingBox{ Center, Extents };
@@ -2,6 +2,7 @@
 
 #include "ModelDefines.h"
 #include "../External/tinygltf/tiny_gltf.h"
+#include "../TaskFlow/TaskExecutor.h"
 
 
 struct ModelLoadDesc
@@ -16,6 +17,8 @@ struct ModelLoadDesc
 
 class ModelLoader
 {
+    static constexpr UINT64 VertexGrainSize = 4096;     // 顶点少的Mesh不拆分
+
     struct WorldTransform
     {
         DirectX::XMFLOAT3 TranslationVector = { 0.0f, 0.0f, 0.0f };
@@ -51,8 +54,9 @@ public:
 
 private:
     void LoadGLTFNode(const tinygltf::Model& InGLTFModel, const tinygltf::Node& InGLTFNode, const DirectX::XMMATRIX& InParentMatrix);
-    static DirectX::BoundingBox CreateAABB(const std::vector<DirectX::XMFLOAT3>& InPosition);
+    DirectX::BoundingBox CreateAABB(const std::vector<DirectX::XMFLOAT3>& InPosition);
 private:
+    TaskExecutor Executor{ ThreadPoolDesc{ .Name = "ModelLoaderWorker" } };
     ImageLoader ImagesLoader;
     std::vector<ModelData> Models;
 
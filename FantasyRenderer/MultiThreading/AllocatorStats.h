@@ -0,0 +1,178 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <ostream>
+#include <vector>
+#include <windows.h>
+
+/*
+ * 分配器的统计信息, 用于分配失败时查看分配器有多满, 碎片有多严重.
+ * 计数(分配/释放/失败次数, 峰值)由AllocatorStatsCounter在分配路径上用relaxed原子累加, ALLOCATOR_STATS_ENABLE为0时为空操作.
+ * 空闲块的分布(直方图, 最大空闲块, 空闲区间)在调用各分配器的GetStats()时现场扫描得到, 和并发的分配, 释放同时调用时只是一个近似的快照.
+ */
+
+#ifndef ALLOCATOR_STATS_ENABLE
+#define ALLOCATOR_STATS_ENABLE 1
+#endif
+
+struct AllocatorFreeRange
+{
+    UINT64 Offset;
+    UINT64 Size;
+};
+
+struct AllocatorStats
+{
+    static constexpr UINT32 HistogramBucketNum = 64;    // 第ix个桶统计大小在[2^ix, 2^(ix + 1))中的空闲块
+
+    UINT64 Capacity = 0;
+    UINT64 UsedSize = 0;
+    UINT64 PeakUsedSize = 0;
+    UINT64 FreeSize = 0;
+    UINT64 LargestFreeBlockSize = 0;
+    UINT64 FreeBlockNum = 0;
+
+    UINT64 AllocationNum = 0;
+    UINT64 FreeNum = 0;
+    UINT64 FailedAllocationNum = 0;
+
+    UINT64 FreeBlockHistogram[HistogramBucketNum] = {};
+    std::vector<AllocatorFreeRange> FreeRanges;     // 只在GetStats()要求时填充, 按Offset排序
+
+    void AddFreeBlock(UINT64 InOffset, UINT64 InSize, bool bInCollectFreeRanges)
+    {
+        if (InSize == 0) return;
+
+        FreeSize += InSize;
+        FreeBlockNum++;
+        if (InSize > LargestFreeBlockSize) LargestFreeBlockSize = InSize;
+        FreeBlockHistogram[63 - std::countl_zero(InSize)]++;
+
+        if (bInCollectFreeRanges) FreeRanges.push_back(AllocatorFreeRange{ InOffset, InSize });
+    }
+
+    void SortFreeRanges()
+    {
+        std::ranges::sort(FreeRanges, {}, &AllocatorFreeRange::Offset);
+    }
+
+    // 外部碎片率, 1 - 最大空闲块 / 总空闲大小
+    float GetFragmentation() const
+    {
+        if (FreeSize == 0) return 0.0f;
+        return 1.0f - static_cast<float>(LargestFreeBlockSize) / static_cast<float>(FreeSize);
+    }
+
+    // 用于把多个分配器的统计合在一起, 不同分配器的空闲区间不在同一个地址空间, 所以不合并FreeRanges
+    void Merge(const AllocatorStats& InOther)
+    {
+        Capacity += InOther.Capacity;
+        UsedSize += InOther.UsedSize;
+        PeakUsedSize += InOther.PeakUsedSize;
+        FreeSize += InOther.FreeSize;
+        FreeBlockNum += InOther.FreeBlockNum;
+        if (InOther.LargestFreeBlockSize > LargestFreeBlockSize) LargestFreeBlockSize = InOther.LargestFreeBlockSize;
+
+        AllocationNum += InOther.AllocationNum;
+        FreeNum += InOther.FreeNum;
+        FailedAllocationNum += InOther.FailedAllocationNum;
+
+        for (UINT32 ix = 0; ix < HistogramBucketNum; ++ix) FreeBlockHistogram[ix] += InOther.FreeBlockHistogram[ix];
+    }
+};
+
+
+// 写成一个JSON对象, 不带结尾的换行
+inline void WriteAllocatorStatsJson(std::ostream& Output, const AllocatorStats& InStats)
+{
+    Output << R"({"Capacity":)" << InStats.Capacity
+           << R"(,"UsedSize":)" << InStats.UsedSize
+           << R"(,"PeakUsedSize":)" << InStats.PeakUsedSize
+           << R"(,"FreeSize":)" << InStats.FreeSize
+           << R"(,"LargestFreeBlockSize":)" << InStats.LargestFreeBlockSize
+           << R"(,"FreeBlockNum":)" << InStats.FreeBlockNum
+           << R"(,"Fragmentation":)" << InStats.GetFragmentation()
+           << R"(,"AllocationNum":)" << InStats.AllocationNum
+           << R"(,"FreeNum":)" << InStats.FreeNum
+           << R"(,"FailedAllocationNum":)" << InStats.FailedAllocationNum;
+
+    // 直方图只写到最后一个非空的桶
+    UINT32 BucketNum = AllocatorStats::HistogramBucketNum;
+    while (BucketNum > 0 && InStats.FreeBlockHistogram[BucketNum - 1] == 0) BucketNum--;
+
+    Output << R"(,"FreeBlockHistogram":[)";
+    for (UINT32 ix = 0; ix < BucketNum; ++ix)
+    {
+        if (ix > 0) Output << ",";
+        Output << InStats.FreeBlockHistogram[ix];
+    }
+
+    Output << R"(],"FreeRanges":[)";
+    for (UINT64 ix = 0; ix < InStats.FreeRanges.size(); ++ix)
+    {
+        if (ix > 0) Output << ",";
+        Output << "[" << InStats.FreeRanges[ix].Offset << "," << InStats.FreeRanges[ix].Size << "]";
+    }
+    Output << "]}";
+}
+
+
+class AllocatorStatsCounter
+{
+public:
+    void RecordAllocation()
+    {
+#if ALLOCATOR_STATS_ENABLE
+        AllocationNum.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    void RecordFree()
+    {
+#if ALLOCATOR_STATS_ENABLE
+        FreeNum.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    void RecordFailure()
+    {
+#if ALLOCATOR_STATS_ENABLE
+        FailedAllocationNum.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    // 分配成功后用当时的已用大小更新峰值
+    void RecordUsedSize(UINT64 InUsedSize)
+    {
+#if ALLOCATOR_STATS_ENABLE
+        UINT64 OldPeak = PeakUsedSize.load(std::memory_order_relaxed);
+        while (InUsedSize > OldPeak && !PeakUsedSize.compare_exchange_weak(OldPeak, InUsedSize, std::memory_order_relaxed)) {}
+#endif
+    }
+
+    void Reset()
+    {
+        AllocationNum.store(0, std::memory_order_relaxed);
+        FreeNum.store(0, std::memory_order_relaxed);
+        FailedAllocationNum.store(0, std::memory_order_relaxed);
+        PeakUsedSize.store(0, std::memory_order_relaxed);
+    }
+
+    // OutStats->UsedSize需要先填好
+    void FillStats(AllocatorStats* OutStats) const
+    {
+        OutStats->AllocationNum = AllocationNum.load(std::memory_order_relaxed);
+        OutStats->FreeNum = FreeNum.load(std::memory_order_relaxed);
+        OutStats->FailedAllocationNum = FailedAllocationNum.load(std::memory_order_relaxed);
+
+        const UINT64 Peak = PeakUsedSize.load(std::memory_order_relaxed);
+        OutStats->PeakUsedSize = Peak > OutStats->UsedSize ? Peak : OutStats->UsedSize;
+    }
+
+private:
+    std::atomic<UINT64> AllocationNum = 0;
+    std::atomic<UINT64> FreeNum = 0;
+    std::atomic<UINT64> FailedAllocationNum = 0;
+    std::atomic<UINT64> PeakUsedSize = 0;
+};
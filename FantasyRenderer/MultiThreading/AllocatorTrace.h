@@ -0,0 +1,165 @@
+﻿#pragma once
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#include "../Utility/Exception.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 分配记录, 用于把真实运行时的分配序列录下来, 再离线重放到不同的分配器上比较(见Tools/AllocatorReplay).
+ * 文件格式: AllocatorTraceHeader后紧跟RecordNum个定长的AllocatorTraceRecord, 小端.
+ * 一次分配由(Type, Offset)标识, Offset是录制时分配器返回的偏移, 重放时只用来把Free对应到之前的Allocate.
+ * 这里不依赖D3D12, Type在渲染器中为ED3D12ResourceLocationType.
+ */
+
+enum class EAllocatorTraceOp : UINT8
+{
+    Allocate,
+    Free,
+    FrameEnd,       // 该帧的分配结束, Frame为帧号
+    FrameRetire     // Frame及之前的帧在GPU上完成, 按帧回收的分配(常量缓冲)在此时整体释放
+};
+
+struct AllocatorTraceRecord
+{
+    UINT64 Frame;
+    UINT64 Offset;
+    UINT64 Size;
+    UINT32 Alignment;
+    EAllocatorTraceOp Op;
+    UINT8 Type;
+    UINT8 bSucceeded;
+    UINT8 Padding;
+};
+static_assert(sizeof(AllocatorTraceRecord) == 32);
+
+struct AllocatorTraceHeader
+{
+    static constexpr char MagicValue[4] = { 'A', 'T', 'R', 'C' };
+    static constexpr UINT32 CurrentVersion = 1;
+
+    char Magic[4];
+    UINT32 Version;
+    UINT64 RecordNum;
+};
+
+
+class AllocatorTraceRecorder
+{
+public:
+    CLASS_NO_COPY(AllocatorTraceRecorder)
+
+    AllocatorTraceRecorder() = default;
+    ~AllocatorTraceRecorder() = default;
+
+public:
+    // 清空之前的记录并开始录制
+    void Start()
+    {
+        std::lock_guard LockGuard(Mutex);
+        Records.clear();
+        bRecording.store(true, std::memory_order_release);
+    }
+
+    // 停止录制并写入文件
+    void Stop(const std::string& InFilePath)
+    {
+        bRecording.store(false, std::memory_order_release);
+
+        std::lock_guard LockGuard(Mutex);
+        SaveAllocatorTrace(InFilePath, Records);
+        Records.clear();
+    }
+
+    bool IsRecording() const
+    {
+        return bRecording.load(std::memory_order_relaxed);
+    }
+
+    void RecordAllocate(UINT8 InType, UINT64 InOffset, UINT64 InSize, UINT64 InAlignment, bool bInSucceeded)
+    {
+        Record(EAllocatorTraceOp::Allocate, InType, InOffset, InSize, InAlignment, bInSucceeded);
+    }
+
+    void RecordFree(UINT8 InType, UINT64 InOffset, UINT64 InSize)
+    {
+        Record(EAllocatorTraceOp::Free, InType, InOffset, InSize, 0, true);
+    }
+
+    // 之后的分配记为下一帧
+    void RecordFrameEnd(UINT64 InFrameIndex)
+    {
+        Record(EAllocatorTraceOp::FrameEnd, 0, 0, 0, 0, true, InFrameIndex);
+        CurrentFrame.store(InFrameIndex + 1, std::memory_order_relaxed);
+    }
+
+    void RecordFrameRetire(UINT64 InFrameIndex)
+    {
+        Record(EAllocatorTraceOp::FrameRetire, 0, 0, 0, 0, true, InFrameIndex);
+    }
+
+    static void SaveAllocatorTrace(const std::string& InFilePath, const std::vector<AllocatorTraceRecord>& InRecords)
+    {
+        std::ofstream Output(InFilePath, std::ios::binary | std::ios::trunc);
+        ThrowIfFalse(Output.is_open(), "Open allocator trace file " + InFilePath + " failed.");
+
+        AllocatorTraceHeader Header;
+        memcpy(Header.Magic, AllocatorTraceHeader::MagicValue, sizeof(Header.Magic));
+        Header.Version = AllocatorTraceHeader::CurrentVersion;
+        Header.RecordNum = InRecords.size();
+
+        Output.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+        Output.write(reinterpret_cast<const char*>(InRecords.data()), static_cast<std::streamsize>(InRecords.size() * sizeof(AllocatorTraceRecord)));
+    }
+
+    static std::vector<AllocatorTraceRecord> LoadAllocatorTrace(const std::string& InFilePath)
+    {
+        std::ifstream Input(InFilePath, std::ios::binary);
+        ThrowIfFalse(Input.is_open(), "Open allocator trace file " + InFilePath + " failed.");
+
+        AllocatorTraceHeader Header;
+        Input.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+        ThrowIfFalse(
+            Input.good() && memcmp(Header.Magic, AllocatorTraceHeader::MagicValue, sizeof(Header.Magic)) == 0,
+            InFilePath + " is not an allocator trace file."
+        );
+        ThrowIfFalse(Header.Version == AllocatorTraceHeader::CurrentVersion, "Unsupported allocator trace version.");
+
+        std::vector<AllocatorTraceRecord> Output(Header.RecordNum);
+        Input.read(reinterpret_cast<char*>(Output.data()), static_cast<std::streamsize>(Output.size() * sizeof(AllocatorTraceRecord)));
+        ThrowIfFalse(Input.good(), InFilePath + " is truncated.");
+        return Output;
+    }
+
+private:
+    void Record(EAllocatorTraceOp InOp, UINT8 InType, UINT64 InOffset, UINT64 InSize, UINT64 InAlignment, bool bInSucceeded, UINT64 InFrame = INVALID_FRAME)
+    {
+        if (!IsRecording()) return;
+
+        AllocatorTraceRecord NewRecord{};
+        NewRecord.Frame = InFrame != INVALID_FRAME ? InFrame : CurrentFrame.load(std::memory_order_relaxed);
+        NewRecord.Offset = InOffset;
+        NewRecord.Size = InSize;
+        NewRecord.Alignment = static_cast<UINT32>(InAlignment);
+        NewRecord.Op = InOp;
+        NewRecord.Type = InType;
+        NewRecord.bSucceeded = bInSucceeded ? 1 : 0;
+
+        std::lock_guard LockGuard(Mutex);
+        Records.push_back(NewRecord);
+    }
+
+private:
+    static constexpr UINT64 INVALID_FRAME = ~0ull;
+
+    std::atomic<bool> bRecording = false;
+    std::atomic<UINT64> CurrentFrame = 0;
+
+    std::mutex Mutex;
+    std::vector<AllocatorTraceRecord> Records;
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include "../Utility/FormatConvert.h"
+#else
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * CPU拓扑和线程放置.
+ * Windows下通过GetLogicalProcessorInformationEx()获取, Linux下读取/sys/devices/system.
+ * 逻辑核编号在Windows下为 处理器组 * 64 + 组内编号, 在Linux下为cpu编号.
+ * NumaNodeCores按节点编号从小到大排列, 下标不一定等于节点编号(编号可能不连续), 没有逻辑核的节点不计入.
+ */
+
+struct CPUTopology
+{
+    uint32_t LogicalCoreNum = 0;
+    uint32_t PhysicalCoreNum = 0;
+
+    // 每个物理核的第一个逻辑核排在前面, 超线程的兄弟核排在后面, 按这个顺序绑定可以先占满物理核
+    std::vector<uint32_t> LogicalCoreOrder;
+    std::vector<std::vector<uint32_t>> NumaNodeCores;
+
+    static const CPUTopology& Get()
+    {
+        static const CPUTopology Topology = Query();
+        return Topology;
+    }
+
+private:
+    static CPUTopology Query()
+    {
+        CPUTopology Topology;
+        std::vector<std::vector<uint32_t>> PhysicalCores;
+
+#ifdef _WIN32
+        DWORD BufferSize = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &BufferSize);
+        std::vector<BYTE> Buffer(BufferSize);
+        if (BufferSize > 0 && GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(Buffer.data()), &BufferSize))
+        {
+            auto CollectCores = [](const GROUP_AFFINITY& InAffinity, std::vector<uint32_t>& OutCores)
+            {
+                for (uint32_t ix = 0; ix < sizeof(KAFFINITY) * 8; ++ix)
+                {
+                    if (InAffinity.Mask & (static_cast<KAFFINITY>(1) << ix)) OutCores.push_back(InAffinity.Group * 64 + ix);
+                }
+            };
+
+            for (DWORD Offset = 0; Offset < BufferSize;)
+            {
+                const auto* Info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(Buffer.data() + Offset);
+                if (Info->Relationship == RelationProcessorCore)
+                {
+                    auto& Cores = PhysicalCores.emplace_back();
+                    for (WORD ix = 0; ix < Info->Processor.GroupCount; ++ix) CollectCores(Info->Processor.GroupMask[ix], Cores);
+                }
+                else if (Info->Relationship == RelationNumaNode)
+                {
+                    CollectCores(Info->NumaNode.GroupMask, Topology.NumaNodeCores.emplace_back());
+                }
+                Offset += Info->Size;
+            }
+        }
+#else
+        // cpu或node的编号列表, 形如 "0-3,8-11"
+        auto ParseCPUList = [](const std::string& InPath)
+        {
+            std::vector<uint32_t> Cores;
+            std::ifstream Input(InPath);
+            std::string List;
+            if (!std::getline(Input, List)) return Cores;
+
+            size_t Begin = 0;
+            while (Begin < List.size())
+            {
+                size_t End = List.find(',', Begin);
+                if (End == std::string::npos) End = List.size();
+
+                const std::string Range = List.substr(Begin, End - Begin);
+                const size_t Dash = Range.find('-');
+                const uint32_t First = static_cast<uint32_t>(std::stoul(Range.substr(0, Dash)));
+                const uint32_t Last = Dash == std::string::npos ? First : static_cast<uint32_t>(std::stoul(Range.substr(Dash + 1)));
+                for (uint32_t ix = First; ix <= Last; ++ix) Cores.push_back(ix);
+
+                Begin = End + 1;
+            }
+            return Cores;
+        };
+
+        auto ReadNumber = [](const std::string& InPath, int64_t InDefault)
+        {
+            std::ifstream Input(InPath);
+            int64_t Number = InDefault;
+            Input >> Number;
+            return Number;
+        };
+
+        const std::string CPURoot = "/sys/devices/system/cpu/";
+        std::vector<std::pair<std::pair<int64_t, int64_t>, uint32_t>> CoreKeys;
+        for (const uint32_t Core : ParseCPUList(CPURoot + "online"))
+        {
+            const std::string TopologyPath = CPURoot + "cpu" + std::to_string(Core) + "/topology/";
+            const int64_t PackageId = ReadNumber(TopologyPath + "physical_package_id", 0);
+            const int64_t CoreId = ReadNumber(TopologyPath + "core_id", Core);
+            CoreKeys.push_back({ { PackageId, CoreId }, Core });
+        }
+        std::ranges::sort(CoreKeys);
+        for (uint32_t ix = 0; ix < CoreKeys.size(); ++ix)
+        {
+            if (ix == 0 || CoreKeys[ix].first != CoreKeys[ix - 1].first) PhysicalCores.emplace_back();
+            PhysicalCores.back().push_back(CoreKeys[ix].second);
+        }
+
+        // 多路服务器上节点编号可能不连续, 按online列出的编号读取
+        const std::string NodeRoot = "/sys/devices/system/node/";
+        for (const uint32_t NodeId : ParseCPUList(NodeRoot + "online"))
+        {
+            std::vector<uint32_t> Cores = ParseCPUList(NodeRoot + "node" + std::to_string(NodeId) + "/cpulist");
+            if (!Cores.empty()) Topology.NumaNodeCores.push_back(std::move(Cores));
+        }
+#endif
+
+        if (PhysicalCores.empty())
+        {
+            const uint32_t CoreNum = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+            for (uint32_t ix = 0; ix < CoreNum; ++ix) PhysicalCores.push_back({ ix });
+        }
+
+        for (uint32_t SiblingIndex = 0;; ++SiblingIndex)
+        {
+            bool bFound = false;
+            for (const auto& Cores : PhysicalCores)
+            {
+                if (SiblingIndex < Cores.size())
+                {
+                    Topology.LogicalCoreOrder.push_back(Cores[SiblingIndex]);
+                    bFound = true;
+                }
+            }
+            if (!bFound) break;
+        }
+
+        Topology.PhysicalCoreNum = static_cast<uint32_t>(PhysicalCores.size());
+        Topology.LogicalCoreNum = static_cast<uint32_t>(Topology.LogicalCoreOrder.size());
+        if (Topology.NumaNodeCores.empty())
+        {
+            Topology.NumaNodeCores.push_back(Topology.LogicalCoreOrder);
+        }
+        return Topology;
+    }
+};
+
+
+inline void SetCurrentThreadName(const std::string& InName)
+{
+#ifdef _WIN32
+    SetThreadDescription(GetCurrentThread(), StringToWString(InName).c_str());
+#else
+    pthread_setname_np(pthread_self(), InName.substr(0, 15).c_str());   // Linux下最长15个字符
+#endif
+}
+
+// 把当前线程绑定到InCores中的逻辑核上, Windows下只能绑定到同一个处理器组内, 取第一个核所在的组
+inline bool SetCurrentThreadAffinity(const std::vector<uint32_t>& InCores)
+{
+    if (InCores.empty()) return false;
+
+#ifdef _WIN32
+    GROUP_AFFINITY Affinity{};
+    Affinity.Group = static_cast<WORD>(InCores[0] / 64);
+    for (const uint32_t Core : InCores)
+    {
+        if (Core / 64 == Affinity.Group) Affinity.Mask |= static_cast<KAFFINITY>(1) << (Core % 64);
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &Affinity, nullptr) != 0;
+#else
+    cpu_set_t CPUSet;
+    CPU_ZERO(&CPUSet);
+    for (const uint32_t Core : InCores) CPU_SET(Core, &CPUSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(CPUSet), &CPUSet) == 0;
+#endif
+}
@@ -0,0 +1,297 @@
+﻿#pragma once
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <windows.h>
+
+#include "AllocatorStats.h"
+#include "../Utility/AlignUtil.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 用每一阶的位图记录空闲块的伙伴分配器, 接口与ConcurrentBuddyAllocator相同.
+ * 第Order阶的第ix位为1表示[ix << Order, (ix + 1) << Order)个最小块是一整个空闲块.
+ * 伙伴块的编号只差最低位, 一定在同一个64位字里, 所以释放时"伙伴是否空闲"的判断和合并可以用一次CAS完成, 不需要锁.
+ * 分配和释放最多沿阶数走一遍, 为O(log n).
+ * 合并或拆分时块先从一阶的位图中取走, 之后才放到另一阶, 这期间它不在任何位图里. 分配失败时如果有这样的块, 等它放回后重试.
+ */
+
+class ConcurrentBitmapBuddyAllocator
+{
+    static constexpr UINT64 WordBitNum = 64;
+    static constexpr UINT64 TransitNumMask = 0xFFFFFFFFull;     // TransitState的低32位是正在合并或拆分的次数, 高32位是完成的次数
+    static constexpr UINT64 TransitFinishIncrement = (1ull << 32) - 1;
+
+public:
+    CLASS_NO_COPY(ConcurrentBitmapBuddyAllocator)
+
+    ConcurrentBitmapBuddyAllocator(size_t InMaxSize, size_t InAlignSize = 2)
+        : MaxSize(AlignPow2(InMaxSize, InAlignSize)), AlignSize(InAlignSize)
+    {
+        MaxOrder = static_cast<UINT32>(std::countr_zero(MaxSize / AlignSize));
+
+        UINT64 WordNum = 0;
+        for (UINT32 ix = 0; ix <= MaxOrder; ++ix)
+        {
+            const UINT64 BlockNum = (MaxSize / AlignSize) >> ix;
+            OrderWordOffsets.push_back(WordNum);
+            WordNum += (BlockNum + WordBitNum - 1) / WordBitNum;
+        }
+
+        FreeBits = std::make_unique<std::atomic<UINT64>[]>(WordNum);
+        FreeBlockNums = std::make_unique<std::atomic<UINT64>[]>(MaxOrder + 1);
+        SearchHints = std::make_unique<std::atomic<UINT64>[]>(MaxOrder + 1);
+        TotalWordNum = WordNum;
+
+        Clear();
+    }
+    ~ConcurrentBitmapBuddyAllocator() noexcept = default;
+
+public:
+    bool TryAllocate(size_t* OutAddress, size_t InSize)
+    {
+        const size_t AlignedSize = AlignPow2(InSize, AlignSize);
+        UINT64 BlockIndex = INVALID_SIZE_64;
+        while (AlignedSize <= MaxSize)
+        {
+            const UINT64 OldTransitState = TransitState.load(std::memory_order_seq_cst);
+            BlockIndex = AllocateBlock(GetOrder(AlignedSize));
+            if (BlockIndex != INVALID_SIZE_64) break;
+
+            // 查找期间没有开始或完成过合并与拆分, 才说明确实没有足够大的空闲块
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const UINT64 NewTransitState = TransitState.load(std::memory_order_relaxed);
+            if (NewTransitState == OldTransitState && (NewTransitState & TransitNumMask) == 0) break;
+
+            std::this_thread::yield();
+        }
+        if (BlockIndex == INVALID_SIZE_64)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
+
+        Counter.RecordAllocation();
+        Counter.RecordUsedSize(UsedSize.fetch_add(AlignedSize, std::memory_order_relaxed) + AlignedSize);
+
+        *OutAddress = static_cast<size_t>((BlockIndex << GetOrder(AlignedSize)) * AlignSize);
+        return true;
+    }
+
+    bool TryFree(size_t InAddress, size_t InSize)
+    {
+        const size_t AlignedSize = AlignPow2(InSize, AlignSize);
+        if (InAddress + AlignedSize > MaxSize || InAddress % AlignedSize != 0) return false;
+
+        const UINT32 Order = GetOrder(AlignedSize);
+        if (!FreeBlock(Order, InAddress / AlignedSize)) return false;
+
+        Counter.RecordFree();
+        UsedSize.fetch_sub(AlignedSize, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 不能和分配, 释放同时调用
+    void Clear()
+    {
+        for (UINT64 ix = 0; ix < TotalWordNum; ++ix) FreeBits[ix].store(0, std::memory_order_relaxed);
+        for (UINT32 ix = 0; ix <= MaxOrder; ++ix)
+        {
+            FreeBlockNums[ix].store(0, std::memory_order_relaxed);
+            SearchHints[ix].store(0, std::memory_order_relaxed);
+        }
+
+        FreeBits[OrderWordOffsets[MaxOrder]].store(1, std::memory_order_relaxed);
+        FreeBlockNums[MaxOrder].store(1, std::memory_order_release);
+
+        UsedSize.store(0, std::memory_order_relaxed);
+        TransitState.store(0, std::memory_order_relaxed);
+        Counter.Reset();
+    }
+
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const
+    {
+        *OutStats = AllocatorStats{};
+        OutStats->Capacity = MaxSize;
+        OutStats->UsedSize = UsedSize.load(std::memory_order_relaxed);
+        Counter.FillStats(OutStats);
+
+        for (UINT32 Order = 0; Order <= MaxOrder; ++Order)
+        {
+            const UINT64 WordNum = (GetBlockNum(Order) + WordBitNum - 1) / WordBitNum;
+            for (UINT64 ix = 0; ix < WordNum; ++ix)
+            {
+                UINT64 Bits = FreeBits[OrderWordOffsets[Order] + ix].load(std::memory_order_relaxed);
+                while (Bits != 0)
+                {
+                    const UINT64 BlockIndex = ix * WordBitNum + std::countr_zero(Bits);
+                    OutStats->AddFreeBlock((BlockIndex << Order) * AlignSize, AlignSize << Order, bInCollectFreeRanges);
+                    Bits &= Bits - 1;
+                }
+            }
+        }
+        OutStats->SortFreeRanges();
+    }
+
+    void PrintAll() const
+    {
+        for (UINT32 Order = 0; Order <= MaxOrder; ++Order)
+        {
+            const UINT64 BlockNum = GetBlockNum(Order);
+            for (UINT64 ix = 0; ix < BlockNum; ++ix)
+            {
+                if (GetWord(Order, ix).load(std::memory_order_relaxed) & GetBit(ix))
+                {
+                    printf_s("(%llu, %llu)\n", static_cast<UINT64>((ix << Order) * AlignSize), static_cast<UINT64>(AlignSize << Order));
+                }
+            }
+        }
+    }
+
+private:
+    UINT32 GetOrder(size_t InAlignedSize) const
+    {
+        return static_cast<UINT32>(std::countr_zero(InAlignedSize / AlignSize));
+    }
+
+    UINT64 GetBlockNum(UINT32 InOrder) const
+    {
+        return (MaxSize / AlignSize) >> InOrder;
+    }
+
+    std::atomic<UINT64>& GetWord(UINT32 InOrder, UINT64 InBlockIndex) const
+    {
+        return FreeBits[OrderWordOffsets[InOrder] + InBlockIndex / WordBitNum];
+    }
+
+    static UINT64 GetBit(UINT64 InBlockIndex)
+    {
+        return 1ull << (InBlockIndex % WordBitNum);
+    }
+
+    void BeginTransit()
+    {
+        TransitState.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    void FinishTransit()
+    {
+        TransitState.fetch_add(TransitFinishIncrement, std::memory_order_seq_cst);
+    }
+
+    UINT64 AllocateBlock(UINT32 InOrder)
+    {
+        // 这一阶没有空闲块时从更高阶拆分, 左半块继续拆分, 右半块标记为空闲
+        for (UINT32 Order = InOrder; Order <= MaxOrder; ++Order)
+        {
+            if (FreeBlockNums[Order].load(std::memory_order_acquire) == 0) continue;
+
+            const bool bSplit = Order != InOrder;
+            UINT64 BlockIndex = ClaimFreeBlock(Order, bSplit);
+            if (BlockIndex == INVALID_SIZE_64) continue;
+
+            for (; Order > InOrder; --Order)
+            {
+                const UINT64 RightIndex = BlockIndex * 2 + 1;
+                GetWord(Order - 1, RightIndex).fetch_or(GetBit(RightIndex), std::memory_order_acq_rel);
+                FreeBlockNums[Order - 1].fetch_add(1, std::memory_order_release);
+                BlockIndex *= 2;
+            }
+            if (bSplit) FinishTransit();
+
+            return BlockIndex;
+        }
+        return INVALID_SIZE_64;
+    }
+
+    // bInSplit为true时取走的块要拆分, 成功时由调用者在放回右半块后FinishTransit()
+    UINT64 ClaimFreeBlock(UINT32 InOrder, bool bInSplit)
+    {
+        const UINT64 WordNum = (GetBlockNum(InOrder) + WordBitNum - 1) / WordBitNum;
+        const UINT64 StartWord = SearchHints[InOrder].load(std::memory_order_relaxed) % WordNum;
+
+        for (UINT64 ix = 0; ix < WordNum; ++ix)
+        {
+            const UINT64 WordIndex = (StartWord + ix) % WordNum;
+            std::atomic<UINT64>& Word = FreeBits[OrderWordOffsets[InOrder] + WordIndex];
+
+            UINT64 OldBits = Word.load(std::memory_order_relaxed);
+            while (OldBits != 0)
+            {
+                const UINT64 Bit = OldBits & (~OldBits + 1);    // 最低位的1
+                if (bInSplit) BeginTransit();
+                if (Word.compare_exchange_weak(OldBits, OldBits & ~Bit, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    FreeBlockNums[InOrder].fetch_sub(1, std::memory_order_relaxed);
+                    SearchHints[InOrder].store(WordIndex, std::memory_order_relaxed);
+                    return WordIndex * WordBitNum + std::countr_zero(Bit);
+                }
+                if (bInSplit) FinishTransit();
+            }
+        }
+        return INVALID_SIZE_64;
+    }
+
+    bool FreeBlock(UINT32 InOrder, UINT64 InBlockIndex)
+    {
+        UINT32 Order = InOrder;
+        UINT64 BlockIndex = InBlockIndex;
+        bool bInTransit = false;
+
+        while (true)
+        {
+            std::atomic<UINT64>& Word = GetWord(Order, BlockIndex);
+            const UINT64 Bit = GetBit(BlockIndex);
+            const UINT64 BuddyBit = Order < MaxOrder ? GetBit(BlockIndex ^ 1) : 0;
+
+            UINT64 OldBits = Word.load(std::memory_order_relaxed);
+            while (true)
+            {
+                // 重复释放
+                if (OldBits & Bit)
+                {
+                    if (bInTransit) FinishTransit();
+                    return Order != InOrder;
+                }
+
+                if (OldBits & BuddyBit)
+                {
+                    // 伙伴空闲, 取走伙伴, 合并后释放上一阶的块. 取走之前开始计数, 直到合并后的块放回为止
+                    if (!bInTransit) BeginTransit();
+                    bInTransit = true;
+                    if (Word.compare_exchange_weak(OldBits, OldBits & ~BuddyBit, std::memory_order_acq_rel, std::memory_order_relaxed))
+                    {
+                        FreeBlockNums[Order].fetch_sub(1, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                else if (Word.compare_exchange_weak(OldBits, OldBits | Bit, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    FreeBlockNums[Order].fetch_add(1, std::memory_order_release);
+                    if (bInTransit) FinishTransit();
+                    return true;
+                }
+            }
+
+            Order++;
+            BlockIndex >>= 1;
+        }
+    }
+
+private:
+    size_t MaxSize;
+    size_t AlignSize;
+    UINT32 MaxOrder = 0;
+
+    std::vector<UINT64> OrderWordOffsets;
+    UINT64 TotalWordNum = 0;
+    std::unique_ptr<std::atomic<UINT64>[]> FreeBits;
+    std::unique_ptr<std::atomic<UINT64>[]> FreeBlockNums;     // 只用来跳过没有空闲块的阶
+    std::unique_ptr<std::atomic<UINT64>[]> SearchHints;
+
+    std::atomic<UINT64> TransitState = 0;
+    std::atomic<UINT64> UsedSize = 0;
+    AllocatorStatsCounter Counter;
+};
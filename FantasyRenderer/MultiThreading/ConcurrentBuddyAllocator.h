@@ -1,5 +1,8 @@
 ﻿#pragma once
-#include "ConcurrentList.h"
+#include <memory>
+#include <mutex>
+
+#include "AllocatorStats.h"
 #include "../Utility/AlignUtil.h"
 
 
@@ -25,7 +28,7 @@ class ConcurrentBuddyAllocator
 
         Node* Next = nullptr;
         Node* Prev = nullptr;
-        std::mutex Mutex;
+        mutable std::mutex Mutex;
         std::shared_ptr<Block> Data;
     };
 
@@ -44,10 +47,20 @@ public:
     bool TryAllocate(size_t* OutAddress, size_t InSize)
     {
         std::unique_lock HeadLock(Head.Mutex);
-        if (Head.Next == nullptr) return false;
+        if (Head.Next == nullptr)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
 
         *OutAddress = Allocate(std::move(HeadLock), AlignPow2(InSize, AlignSize));
-        if (*OutAddress == INVALID_SIZE_64) return false;
+        if (*OutAddress == INVALID_SIZE_64)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
+        Counter.RecordAllocation();
+        Counter.RecordUsedSize(UsedSize.fetch_add(AlignPow2(InSize, AlignSize), std::memory_order_relaxed) + AlignPow2(InSize, AlignSize));
         return true;
     }
 
@@ -92,6 +105,8 @@ public:
             NewNode->Prev = CurrentNode;
             CurrentNode->Next = NewNode;
         }
+        Counter.RecordFree();
+        UsedSize.fetch_sub(InBlock.Size, std::memory_order_relaxed);
         return true;
     }
 
@@ -116,6 +131,29 @@ public:
         }
     }
 
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const
+    {
+        *OutStats = AllocatorStats{};
+        OutStats->Capacity = MaxSize;
+
+        const Node* CurrentNode = &Head;
+        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+
+        while (const Node* NextNode = CurrentNode->Next)
+        {
+            std::unique_lock NextNodeLock(NextNode->Mutex);
+            CurrentNodeLock.unlock();
+            OutStats->AddFreeBlock(NextNode->Data->Start, NextNode->Data->Size, bInCollectFreeRanges);
+
+            CurrentNode = NextNode;
+            CurrentNodeLock = std::move(NextNodeLock);
+        }
+
+        OutStats->UsedSize = UsedSize.load(std::memory_order_relaxed);
+        Counter.FillStats(OutStats);
+        OutStats->SortFreeRanges();
+    }
+
     void PrintAll()
     {
         Node* CurrentNode = &Head;
@@ -324,4 +362,7 @@ private:
     Node Head;
     size_t MaxSize;
     size_t AlignSize;
+
+    std::atomic<size_t> UsedSize = 0;
+    AllocatorStatsCounter Counter;
 };
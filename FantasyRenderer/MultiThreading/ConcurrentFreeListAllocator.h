@@ -2,6 +2,7 @@
 #include <memory>
 #include <mutex>
 
+#include "AllocatorStats.h"
 #include "../Utility/Macros.h"
 
 // 这个FreeList在allocate时只会分配一个T
@@ -23,7 +24,7 @@ class ConcurrentFreeListAllocator
         Node() = default;
         Node(const FreeRange& rhs) : Data(std::make_shared<FreeRange>(rhs)) {}
 
-        std::mutex Mutex;
+        mutable std::mutex Mutex;
         std::shared_ptr<FreeRange> Data;
         std::unique_ptr<Node> Next;
     };
@@ -31,9 +32,9 @@ class ConcurrentFreeListAllocator
 public:
     CLASS_NO_COPY(ConcurrentFreeListAllocator)
     
-    ConcurrentFreeListAllocator(size_t InCapacity)
+    ConcurrentFreeListAllocator(size_t InCapacity) : Capacity(InCapacity)
     {
-        FreeRange InitRange(0, InCapacity);
+        FreeRange InitRange(0, InCapacity - 1);     // 闭区间
         Head.Next = std::make_unique<Node>(InitRange);
         Head.Data = std::make_shared<FreeRange>(InitRange);
     }
@@ -43,9 +44,14 @@ public:
     bool TryAllocate(size_t* OutValue)
     {
         std::unique_lock<std::mutex> HeadLock(Head.Mutex);
-        if (Head.Next == nullptr) return false;
+        if (Head.Next == nullptr)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
         
         Allocate(std::move(HeadLock), OutValue);
+        Counter.RecordAllocation();
 
         return true;
     }
@@ -54,6 +60,7 @@ public:
     {
         size_t Output;
         Allocate(WaitForData(), &Output);
+        Counter.RecordAllocation();
 
         return Output;
     }
@@ -104,6 +111,7 @@ public:
         {
             PushFront(RangeToFree);
         }
+        Counter.RecordFree();
 
         return true;
     }
@@ -123,6 +131,32 @@ public:
         }
     }
 
+    // 区间两端都是闭的, 大小以元素个数为单位
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const
+    {
+        *OutStats = AllocatorStats{};
+        OutStats->Capacity = Capacity;
+
+        const Node* CurrentNode = &Head;
+        std::unique_lock<std::mutex> CurrentNodeLock(CurrentNode->Mutex);
+
+        while (const Node* NextNode = CurrentNode->Next.get())
+        {
+            std::unique_lock<std::mutex> NextNodeLock(NextNode->Mutex);
+            CurrentNodeLock.unlock();
+
+            const FreeRange& Range = *NextNode->Data;
+            if (Range.End >= Range.Begin) OutStats->AddFreeBlock(Range.Begin, Range.End - Range.Begin + 1, bInCollectFreeRanges);
+
+            CurrentNode = NextNode;
+            CurrentNodeLock = std::move(NextNodeLock);
+        }
+
+        OutStats->UsedSize = OutStats->FreeSize < Capacity ? Capacity - OutStats->FreeSize : 0;
+        Counter.FillStats(OutStats);
+        OutStats->SortFreeRanges();
+    }
+
 private:
     std::unique_lock<std::mutex> WaitForData()
     {
@@ -148,7 +182,10 @@ private:
             Head.Next = std::move(FirstNode->Next);
             FirstNodeLock.unlock();
         }
-        FirstFreeRange.Begin++;
+        else
+        {
+            FirstFreeRange.Begin++;     // 区间只剩一个时节点已被删除, 不能再访问
+        }
     }
 
     void PushFront(const FreeRange& InRange)
@@ -176,4 +213,7 @@ private:
 private:
     Node Head;  // 存储初始化的数据，实际上的用处就是一个空头
     std::condition_variable ConditionVariable;
+
+    size_t Capacity;
+    AllocatorStatsCounter Counter;
 };
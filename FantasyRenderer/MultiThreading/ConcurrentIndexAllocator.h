@@ -0,0 +1,304 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <windows.h>
+
+#include "AllocatorStats.h"
+#include "../Utility/AlignUtil.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 分配[0, Capacity)中单个下标的分配器, 用于描述符这类每次只分配一个的场景.
+ * 空闲下标放在一个无锁栈中(用数组下标做链表, 栈顶带版本号避免ABA).
+ * 每个线程对每个分配器有自己的缓存(Magazine, thread_local), 分配和释放优先在缓存中完成, 缓存空了从栈中批量取, 满了批量还回去一半.
+ * 缓存的槽位只由所属线程填入, 分配时所属线程和其他线程都用exchange取走槽位, 所以快路径上没有锁, 也只碰本线程的缓存行.
+ * 栈空时才加锁遍历其他线程的缓存取下标; 线程退出时缓存中的下标还回栈中.
+ */
+
+class ConcurrentIndexAllocator
+{
+    static constexpr UINT32 MagazineSize = 32;
+    static constexpr UINT32 BatchSize = MagazineSize / 2;
+
+    struct alignas(64) Magazine
+    {
+        Magazine() { for (auto& Slot : Slots) Slot.store(INVALID_SIZE_32, std::memory_order_relaxed); }
+
+        std::atomic<UINT32> Slots[MagazineSize];
+        UINT32 Count = 0;      // 只由所属线程读写, [0, Count)中的槽位可能已被其他线程取走, [Count, MagazineSize)一定为空
+    };
+
+    // 分配器和各线程共享, 分配器析构后Allocator为nullptr, 线程退出时就不再归还下标
+    struct MagazineRegistry
+    {
+        std::mutex Mutex;
+        ConcurrentIndexAllocator* Allocator = nullptr;
+        std::vector<std::shared_ptr<Magazine>> Magazines;
+    };
+
+    struct ThreadMagazines
+    {
+        struct Entry
+        {
+            std::shared_ptr<MagazineRegistry> Registry;
+            std::shared_ptr<Magazine> LocalMagazine;
+        };
+
+        ~ThreadMagazines()
+        {
+            for (const Entry& LocalEntry : Entries) ReleaseMagazine(LocalEntry);
+        }
+
+        std::vector<Entry> Entries;
+    };
+
+public:
+    CLASS_NO_COPY(ConcurrentIndexAllocator)
+
+    explicit ConcurrentIndexAllocator(UINT32 InCapacity)
+        : Capacity(InCapacity),
+          NextIndices(std::make_unique<std::atomic<UINT32>[]>(InCapacity)),
+          AllocatedFlags(std::make_unique<std::atomic<bool>[]>(InCapacity)),
+          Registry(std::make_shared<MagazineRegistry>())
+    {
+        Registry->Allocator = this;
+        Clear();
+    }
+
+    ~ConcurrentIndexAllocator() noexcept
+    {
+        std::lock_guard LockGuard(Registry->Mutex);
+        Registry->Allocator = nullptr;
+        Registry->Magazines.clear();
+    }
+
+public:
+    bool TryAllocate(size_t* OutIndex)
+    {
+        Magazine& LocalMagazine = GetLocalMagazine();
+
+        UINT32 Index = INVALID_SIZE_32;
+        while (LocalMagazine.Count > 0 && Index == INVALID_SIZE_32)
+        {
+            Index = LocalMagazine.Slots[--LocalMagazine.Count].exchange(INVALID_SIZE_32, std::memory_order_acquire);
+        }
+
+        if (Index == INVALID_SIZE_32)
+        {
+            // 缓存空了, 从栈中取一批, 第一个直接返回
+            Index = Pop();
+            for (UINT32 ix = 1; ix < BatchSize && Index != INVALID_SIZE_32; ++ix)
+            {
+                const UINT32 PoppedIndex = Pop();
+                if (PoppedIndex == INVALID_SIZE_32) break;
+                LocalMagazine.Slots[LocalMagazine.Count++].store(PoppedIndex, std::memory_order_release);
+            }
+        }
+
+        // 栈已经空了, 剩下的下标可能在其他线程的缓存中
+        if (Index == INVALID_SIZE_32) Index = StealFromMagazines(&LocalMagazine);
+        if (Index == INVALID_SIZE_32)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
+
+        AllocatedFlags[Index].store(true, std::memory_order_relaxed);
+        Counter.RecordAllocation();
+#if ALLOCATOR_STATS_ENABLE
+        Counter.RecordUsedSize(AllocatedNum.fetch_add(1, std::memory_order_relaxed) + 1);
+#endif
+        *OutIndex = Index;
+        return true;
+    }
+
+    bool TryFree(size_t InIndex)
+    {
+        if (InIndex >= Capacity) return false;
+
+        const UINT32 Index = static_cast<UINT32>(InIndex);
+        if (!AllocatedFlags[Index].exchange(false, std::memory_order_relaxed)) return false;
+#if ALLOCATOR_STATS_ENABLE
+        AllocatedNum.fetch_sub(1, std::memory_order_relaxed);
+#endif
+        Counter.RecordFree();
+
+        Magazine& LocalMagazine = GetLocalMagazine();
+        if (LocalMagazine.Count == MagazineSize)
+        {
+            // 还回去一半
+            ReturnToStack(LocalMagazine, BatchSize, MagazineSize);
+            LocalMagazine.Count = BatchSize;
+        }
+        LocalMagazine.Slots[LocalMagazine.Count++].store(Index, std::memory_order_release);
+        return true;
+    }
+
+    // 不能和分配, 释放同时调用
+    void Clear()
+    {
+        {
+            // 只清空槽位, 各线程的Count由所属线程在之后的分配中自然减到0
+            std::lock_guard LockGuard(Registry->Mutex);
+            for (const auto& OtherMagazine : Registry->Magazines)
+            {
+                for (auto& Slot : OtherMagazine->Slots) Slot.store(INVALID_SIZE_32, std::memory_order_relaxed);
+            }
+        }
+
+        for (UINT32 ix = 0; ix < Capacity; ++ix)
+        {
+            NextIndices[ix].store(ix + 1 < Capacity ? ix + 1 : INVALID_SIZE_32, std::memory_order_relaxed);
+            AllocatedFlags[ix].store(false, std::memory_order_relaxed);
+        }
+        Head.store(MakeHead(Capacity > 0 ? 0 : INVALID_SIZE_32, 0), std::memory_order_release);
+
+        AllocatedNum.store(0, std::memory_order_relaxed);
+        Counter.Reset();
+    }
+
+    // 大小以下标个数为单位, 连续的空闲下标算作一个空闲块
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const
+    {
+        *OutStats = AllocatorStats{};
+        OutStats->Capacity = Capacity;
+
+        UINT32 FreeBegin = INVALID_SIZE_32;
+        for (UINT32 ix = 0; ix <= Capacity; ++ix)
+        {
+            const bool bFree = ix < Capacity && !AllocatedFlags[ix].load(std::memory_order_relaxed);
+            if (!bFree && ix < Capacity) OutStats->UsedSize++;
+
+            if (bFree && FreeBegin == INVALID_SIZE_32)
+            {
+                FreeBegin = ix;
+            }
+            else if (!bFree && FreeBegin != INVALID_SIZE_32)
+            {
+                OutStats->AddFreeBlock(FreeBegin, ix - FreeBegin, bInCollectFreeRanges);
+                FreeBegin = INVALID_SIZE_32;
+            }
+        }
+        Counter.FillStats(OutStats);
+    }
+
+private:
+    static UINT64 MakeHead(UINT32 InIndex, UINT32 InTag)
+    {
+        return (static_cast<UINT64>(InTag) << 32) | InIndex;
+    }
+
+    Magazine& GetLocalMagazine()
+    {
+        for (const auto& LocalEntry : LocalMagazines.Entries)
+        {
+            if (LocalEntry.Registry == Registry) return *LocalEntry.LocalMagazine;
+        }
+
+        // 本线程第一次使用这个分配器, 顺便去掉已析构的分配器的缓存
+        std::erase_if(
+            LocalMagazines.Entries,
+            [](const ThreadMagazines::Entry& InEntry)
+            {
+                std::lock_guard LockGuard(InEntry.Registry->Mutex);
+                return InEntry.Registry->Allocator == nullptr;
+            }
+        );
+
+        auto NewMagazine = std::make_shared<Magazine>();
+        {
+            std::lock_guard LockGuard(Registry->Mutex);
+            Registry->Magazines.push_back(NewMagazine);
+        }
+        LocalMagazines.Entries.push_back({ Registry, NewMagazine });
+        return *NewMagazine;
+    }
+
+    // 线程退出时把缓存中的下标还回栈中
+    static void ReleaseMagazine(const ThreadMagazines::Entry& InEntry)
+    {
+        std::lock_guard LockGuard(InEntry.Registry->Mutex);
+        ConcurrentIndexAllocator* Allocator = InEntry.Registry->Allocator;
+        if (Allocator == nullptr) return;
+
+        Allocator->ReturnToStack(*InEntry.LocalMagazine, 0, InEntry.LocalMagazine->Count);
+        std::erase(InEntry.Registry->Magazines, InEntry.LocalMagazine);
+    }
+
+    // 取走[InBegin, InEnd)中还在的下标, 先串成链表, 一次CAS压栈
+    void ReturnToStack(Magazine& InMagazine, UINT32 InBegin, UINT32 InEnd)
+    {
+        UINT32 First = INVALID_SIZE_32;
+        UINT32 Last = INVALID_SIZE_32;
+        for (UINT32 ix = InBegin; ix < InEnd; ++ix)
+        {
+            const UINT32 Index = InMagazine.Slots[ix].exchange(INVALID_SIZE_32, std::memory_order_acquire);
+            if (Index == INVALID_SIZE_32) continue;
+
+            if (Last == INVALID_SIZE_32) First = Index;
+            else NextIndices[Last].store(Index, std::memory_order_relaxed);
+            Last = Index;
+        }
+        if (First != INVALID_SIZE_32) PushChain(First, Last);
+    }
+
+    UINT32 Pop()
+    {
+        UINT64 OldHead = Head.load(std::memory_order_acquire);
+        while (true)
+        {
+            const UINT32 Index = static_cast<UINT32>(OldHead);
+            if (Index == INVALID_SIZE_32) return INVALID_SIZE_32;
+
+            // Index可能已被别的线程弹出, 此时读到的Next是旧值, 但版本号变了, CAS会失败
+            const UINT32 Next = NextIndices[Index].load(std::memory_order_relaxed);
+            const UINT64 NewHead = MakeHead(Next, static_cast<UINT32>(OldHead >> 32) + 1);
+            if (Head.compare_exchange_weak(OldHead, NewHead, std::memory_order_acq_rel, std::memory_order_acquire)) return Index;
+        }
+    }
+
+    void PushChain(UINT32 InFirst, UINT32 InLast)
+    {
+        UINT64 OldHead = Head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            NextIndices[InLast].store(static_cast<UINT32>(OldHead), std::memory_order_relaxed);
+            const UINT64 NewHead = MakeHead(InFirst, static_cast<UINT32>(OldHead >> 32) + 1);
+            if (Head.compare_exchange_weak(OldHead, NewHead, std::memory_order_release, std::memory_order_relaxed)) return;
+        }
+    }
+
+    UINT32 StealFromMagazines(const Magazine* InLocalMagazine)
+    {
+        std::lock_guard LockGuard(Registry->Mutex);
+        for (const auto& OtherMagazine : Registry->Magazines)
+        {
+            if (OtherMagazine.get() == InLocalMagazine) continue;
+
+            for (auto& Slot : OtherMagazine->Slots)
+            {
+                if (Slot.load(std::memory_order_relaxed) == INVALID_SIZE_32) continue;
+
+                const UINT32 Index = Slot.exchange(INVALID_SIZE_32, std::memory_order_acquire);
+                if (Index != INVALID_SIZE_32) return Index;
+            }
+        }
+        return INVALID_SIZE_32;
+    }
+
+private:
+    UINT32 Capacity;
+
+    std::atomic<UINT64> Head;      // 高32位为版本号, 低32位为栈顶下标
+    std::unique_ptr<std::atomic<UINT32>[]> NextIndices;
+    std::unique_ptr<std::atomic<bool>[]> AllocatedFlags;
+
+    std::shared_ptr<MagazineRegistry> Registry;
+
+    std::atomic<UINT32> AllocatedNum = 0;      // 只用于统计峰值
+    AllocatorStatsCounter Counter;
+
+    inline static thread_local ThreadMagazines LocalMagazines;
+};
@@ -1,151 +1,248 @@
 #pragma once
-#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
+#include "EpochReclaimer.h"
 #include "../Utility/Macros.h"
 
+/*
+ * 无锁单向链表(Harris-Michael), 节点的回收交给EpochReclaimer.
+ * 删除分两步: 先在节点的Next指针最低位打上删除标记, 再把它从前驱上摘下; 摘下节点的线程负责Retire.
+ * ForEach()和FindFirstIf()只读, 跳过已标记的节点, 不会写任何共享数据.
+ * PushBack()需要从头走到尾, 链表以读为主, 长度不大, 所以没有维护尾指针.
+ * 返回的T*在元素被RemoveIf()删除之前一直有效.
+ */
+
 template <typename T>
 class ConcurrentList
 {
     struct Node
     {
-        std::mutex Mutex;
-        std::unique_ptr<T> Data;
-        std::unique_ptr<Node> Next;
+        template <typename... Args>
+        explicit Node(Args&&... Arguments) : Data(std::forward<Args>(Arguments)...) {}
+
+        std::atomic<Node*> Next = nullptr;
+        T Data;
     };
-    
+
+    static bool IsMarked(Node* InNode) { return (reinterpret_cast<uintptr_t>(InNode) & 1) != 0; }
+    static Node* Mark(Node* InNode) { return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(InNode) | 1); }
+    static Node* Unmark(Node* InNode) { return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(InNode) & ~static_cast<uintptr_t>(1)); }
+
 public:
     CLASS_NO_COPY(ConcurrentList)
-    
-    ConcurrentList() { Tail = &Head; }
-    ~ConcurrentList() { Clear(); }
+
+    ConcurrentList() = default;
+    ~ConcurrentList()
+    {
+        // 析构时不应再有其他线程访问, 剩下的节点直接释放
+        Node* CurrentNode = Unmark(Head.load(std::memory_order_acquire));
+        while (CurrentNode)
+        {
+            Node* NextNode = Unmark(CurrentNode->Next.load(std::memory_order_relaxed));
+            delete CurrentNode;
+            CurrentNode = NextNode;
+        }
+    }
 
 public:
     bool Empty() const
     {
-        std::lock_guard HeadLock(Head.Mutex);
-        return Head.Next != nullptr;
+        EpochGuard Guard;
+
+        Node* CurrentNode = Head.load(std::memory_order_acquire);
+        while (CurrentNode)
+        {
+            Node* NextNode = CurrentNode->Next.load(std::memory_order_acquire);
+            if (!IsMarked(NextNode)) return false;
+            CurrentNode = Unmark(NextNode);
+        }
+        return true;
     }
 
     void Clear()
     {
         RemoveIf([](const T*) { return true; });
-        Tail = &Head;
     }
 
     template <typename... Args>
     requires std::is_constructible_v<T, Args...>
     T* PushFront(Args&&... Arguments)
     {
-        std::unique_ptr<Node> NewNode = std::make_unique<Node>();
-        NewNode->Data = std::make_unique<T>(std::forward<Args>(Arguments)...);
-        
-        std::lock_guard HeadLock(Head.Mutex);
-        NewNode->Next = std::move(Head.Next);
+        Node* NewNode = new Node(std::forward<Args>(Arguments)...);
 
-        if (Head.Next.get() == nullptr)
+        Node* FirstNode = Head.load(std::memory_order_relaxed);
+        do
         {
-            std::lock_guard TailLock(TailMutex);
-            Tail = NewNode.get();
-        }
-        Head.Next = std::move(NewNode);
+            NewNode->Next.store(FirstNode, std::memory_order_relaxed);
+        } while (!Head.compare_exchange_weak(FirstNode, NewNode, std::memory_order_release, std::memory_order_relaxed));
 
-        return Head.Next->Data.get();
+        return &NewNode->Data;
     }
 
     template <typename... Args>
     requires std::is_constructible_v<T, Args...>
     T* PushBack(Args&&... Arguments)
     {
-        std::unique_ptr<Node> NewNode = std::make_unique<Node>();
-        NewNode->Data = std::make_unique<T>(std::forward<Args>(Arguments)...);
-        
-        std::lock_guard TailLock(TailMutex);
-        std::lock_guard HeadLock(Head.Mutex);
-        Tail->Next = std::move(NewNode);
-        Tail = Tail->Next.get();
-
-        return Tail->Data.get();
+        Node* NewNode = new Node(std::forward<Args>(Arguments)...);
+
+        EpochGuard Guard;
+        while (true)
+        {
+            std::atomic<Node*>* Prev = &Head;
+            Node* CurrentNode = Prev->load(std::memory_order_acquire);
+            bool bRestart = false;
+
+            while (!bRestart)
+            {
+                if (CurrentNode == nullptr)
+                {
+                    Node* Expected = nullptr;
+                    if (Prev->compare_exchange_strong(Expected, NewNode, std::memory_order_release, std::memory_order_acquire))
+                    {
+                        return &NewNode->Data;
+                    }
+
+                    // 有人在后面追加了节点就接着往后走, 前驱被标记删除了就从头再来
+                    if (IsMarked(Expected)) bRestart = true;
+                    else CurrentNode = Expected;
+                    continue;
+                }
+
+                Node* NextNode = CurrentNode->Next.load(std::memory_order_acquire);
+                if (IsMarked(NextNode))
+                {
+                    bRestart = !Unlink(Prev, CurrentNode, Unmark(NextNode));
+                    CurrentNode = Unmark(NextNode);
+                }
+                else
+                {
+                    Prev = &CurrentNode->Next;
+                    CurrentNode = NextNode;
+                }
+            }
+        }
     }
-    
+
     template <typename F>
     void ForEach(F Func)
     {
-        Node* CurrentNode = &Head;
-        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+        EpochGuard Guard;
 
-        while (Node* const NextNode = CurrentNode->Next.get())
+        Node* CurrentNode = Head.load(std::memory_order_acquire);
+        while (CurrentNode)
         {
-            std::unique_lock NextNodeLock(NextNode->Mutex);
-            CurrentNodeLock.unlock();
-
-            Func(NextNode->Data.get());
-
-            CurrentNode = NextNode;
-            CurrentNodeLock = std::move(NextNodeLock);
+            Node* NextNode = CurrentNode->Next.load(std::memory_order_acquire);
+            if (!IsMarked(NextNode)) Func(&CurrentNode->Data);
+            CurrentNode = Unmark(NextNode);
         }
     }
 
     template <typename F>
     T* FindFirstIf(F Func)
     {
-        Node* CurrentNode = &Head;
-        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+        EpochGuard Guard;
 
-        while (Node* const NextNode = CurrentNode->Next.get())
+        Node* CurrentNode = Head.load(std::memory_order_acquire);
+        while (CurrentNode)
         {
-            std::unique_lock NextNodeLock(NextNode->Mutex);
-            CurrentNodeLock.unlock();
-
-            if (Func(NextNode->Data.get()))
+            Node* NextNode = CurrentNode->Next.load(std::memory_order_acquire);
+            if (!IsMarked(NextNode) && Func(&CurrentNode->Data))
             {
-                return NextNode->Data.get();
+                return &CurrentNode->Data;
             }
-            CurrentNode = NextNode;
-            CurrentNodeLock = std::move(NextNodeLock);
+            CurrentNode = Unmark(NextNode);
         }
         return nullptr;
     }
 
+    // Func对每个元素至多调用一次, 返回是否删除了至少一个元素
     template <typename F>
     bool RemoveIf(F Func)
     {
-        bool Success = false;
-        
-        Node* CurrentNode = &Head;
-        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+        bool bSucceeded = false;
+        bool bAllUnlinked = true;
 
-        while (Node* const NextNode = CurrentNode->Next.get())
         {
-            std::unique_lock NextNodeLock(NextNode->Mutex);
+            EpochGuard Guard;
 
-            if (Func(NextNode->Data.get()))
+            std::atomic<Node*>* Prev = &Head;
+            Node* CurrentNode = Prev->load(std::memory_order_acquire);
+            while (CurrentNode)
             {
-                std::unique_ptr<Node> OldNextNode = std::move(CurrentNode->Next);
-                CurrentNode->Next = std::move(NextNode->Next);
-                NextNodeLock.unlock();
-
-                Success = true;
-            }
-            else
-            {
-                CurrentNodeLock.unlock();
+                Node* NextNode = CurrentNode->Next.load(std::memory_order_acquire);
+                if (IsMarked(NextNode))
+                {
+                    // 别的线程删除的节点, 不动前驱
+                    CurrentNode = Unmark(NextNode);
+                    continue;
+                }
+
+                if (!Func(&CurrentNode->Data))
+                {
+                    Prev = &CurrentNode->Next;
+                    CurrentNode = NextNode;
+                    continue;
+                }
+
+                // 打标记, 期间Next可能因为PushBack而改变, 此时重试; 已被别人标记则算别人删除的
+                while (!IsMarked(NextNode) && !CurrentNode->Next.compare_exchange_weak(NextNode, Mark(NextNode), std::memory_order_acq_rel, std::memory_order_acquire)) {}
+                if (IsMarked(NextNode))
+                {
+                    CurrentNode = Unmark(NextNode);
+                    continue;
+                }
+                bSucceeded = true;
+
+                if (!Unlink(Prev, CurrentNode, NextNode)) bAllUnlinked = false;
                 CurrentNode = NextNode;
-                CurrentNodeLock = std::move(NextNodeLock);
             }
         }
 
-        return Success;
+        if (!bAllUnlinked) Cleanup();
+        return bSucceeded;
     }
 
 private:
-    Node Head;      // Empty Head
-    Node* Tail;
-    std::mutex TailMutex;
-};
-
-
-
+    // 把已标记的InNode从前驱上摘下, 成功的线程负责回收
+    bool Unlink(std::atomic<Node*>* InPrev, Node* InNode, Node* InNextNode)
+    {
+        Node* Expected = InNode;
+        if (!InPrev->compare_exchange_strong(Expected, InNextNode, std::memory_order_acq_rel, std::memory_order_relaxed)) return false;
 
+        EpochReclaimer::Get().Retire(InNode);
+        return true;
+    }
 
+    // 从头遍历, 摘下所有已标记但还挂在链表上的节点
+    void Cleanup()
+    {
+        EpochGuard Guard;
 
+        std::atomic<Node*>* Prev = &Head;
+        Node* CurrentNode = Prev->load(std::memory_order_acquire);
+        while (CurrentNode)
+        {
+            Node* NextNode = CurrentNode->Next.load(std::memory_order_acquire);
+            if (!IsMarked(NextNode))
+            {
+                Prev = &CurrentNode->Next;
+                CurrentNode = NextNode;
+            }
+            else if (Unlink(Prev, CurrentNode, Unmark(NextNode)))
+            {
+                CurrentNode = Unmark(NextNode);
+            }
+            else
+            {
+                Prev = &Head;
+                CurrentNode = Prev->load(std::memory_order_acquire);
+            }
+        }
+    }
 
+private:
+    std::atomic<Node*> Head = nullptr;
+};
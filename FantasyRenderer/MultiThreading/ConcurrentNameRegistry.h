@@ -0,0 +1,200 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <windows.h>
+
+#include "../Utility/Macros.h"
+
+/*
+ * 按名字查找T*的开放寻址哈希表, 键为名字的64位FNV-1a哈希, 线性探测.
+ * 查找不加锁; 插入, 删除和扩容由一个互斥锁串行化.
+ * 扩容时旧表不会立即释放, 保证正在读旧表的线程不会访问到已释放的内存, 直到Clear()或析构.
+ * T需要有std::string类型的Name成员, 哈希相同时再比较名字.
+ */
+
+inline UINT64 HashName(std::string_view InName)
+{
+    UINT64 Hash = 14695981039346656037ull;
+    for (const char Char : InName)
+    {
+        Hash ^= static_cast<UINT8>(Char);
+        Hash *= 1099511628211ull;
+    }
+    return Hash;
+}
+
+template <typename T>
+class ConcurrentNameRegistry
+{
+    static constexpr UINT64 EmptyKey = 0;
+    static constexpr UINT64 RemovedKey = 1;
+    static constexpr UINT64 InitCapacity = 64;
+
+    struct Slot
+    {
+        std::atomic<UINT64> Key = EmptyKey;
+        std::atomic<T*> Value = nullptr;
+    };
+
+    struct Table
+    {
+        explicit Table(UINT64 InCapacity) : Capacity(InCapacity), Slots(std::make_unique<Slot[]>(InCapacity)) {}
+
+        UINT64 Capacity;
+        std::unique_ptr<Slot[]> Slots;
+    };
+
+public:
+    CLASS_NO_COPY(ConcurrentNameRegistry)
+
+    ConcurrentNameRegistry()
+    {
+        Tables.push_back(std::make_unique<Table>(InitCapacity));
+        CurrentTable.store(Tables.back().get(), std::memory_order_release);
+    }
+    ~ConcurrentNameRegistry() noexcept = default;
+
+public:
+    T* Find(std::string_view InName) const
+    {
+        const UINT64 Key = MakeKey(InName);
+        const Table* CurrTable = CurrentTable.load(std::memory_order_acquire);
+
+        const UINT64 Mask = CurrTable->Capacity - 1;
+        for (UINT64 ix = Key & Mask;; ix = (ix + 1) & Mask)
+        {
+            const Slot& CurrSlot = CurrTable->Slots[ix];
+            const UINT64 SlotKey = CurrSlot.Key.load(std::memory_order_acquire);
+            if (SlotKey == EmptyKey) return nullptr;
+            if (SlotKey == Key)
+            {
+                T* Value = CurrSlot.Value.load(std::memory_order_acquire);
+                if (Value != nullptr && Value->Name == InName) return Value;
+            }
+        }
+    }
+
+    // 同名的值已经存在时返回false
+    bool Insert(T* InValue)
+    {
+        std::lock_guard LockGuard(WriteMutex);
+
+        if (Find(InValue->Name) != nullptr) return false;
+
+        Table* CurrTable = CurrentTable.load(std::memory_order_relaxed);
+        if ((UsedSlotNum + 1) * 4 > CurrTable->Capacity * 3)
+        {
+            CurrTable = Rehash();
+        }
+
+        if (InsertToTable(CurrTable, MakeKey(InValue->Name), InValue)) UsedSlotNum++;
+        ValueNum++;
+        return true;
+    }
+
+    bool Remove(const T* InValue)
+    {
+        std::lock_guard LockGuard(WriteMutex);
+
+        const UINT64 Key = MakeKey(InValue->Name);
+        Table* CurrTable = CurrentTable.load(std::memory_order_relaxed);
+
+        const UINT64 Mask = CurrTable->Capacity - 1;
+        for (UINT64 ix = Key & Mask;; ix = (ix + 1) & Mask)
+        {
+            Slot& CurrSlot = CurrTable->Slots[ix];
+            const UINT64 SlotKey = CurrSlot.Key.load(std::memory_order_relaxed);
+            if (SlotKey == EmptyKey) return false;
+            if (SlotKey == Key && CurrSlot.Value.load(std::memory_order_relaxed) == InValue)
+            {
+                // 留下墓碑, 不打断其他键的探测序列
+                CurrSlot.Value.store(nullptr, std::memory_order_release);
+                CurrSlot.Key.store(RemovedKey, std::memory_order_release);
+                ValueNum--;
+                return true;
+            }
+        }
+    }
+
+    // 不能和查找同时调用
+    void Clear()
+    {
+        std::lock_guard LockGuard(WriteMutex);
+
+        Tables.clear();
+        Tables.push_back(std::make_unique<Table>(InitCapacity));
+        CurrentTable.store(Tables.back().get(), std::memory_order_release);
+        UsedSlotNum = 0;
+        ValueNum = 0;
+    }
+
+    UINT64 Size() const
+    {
+        std::lock_guard LockGuard(WriteMutex);
+        return ValueNum;
+    }
+
+private:
+    // 0和1保留给空槽和墓碑
+    static UINT64 MakeKey(std::string_view InName)
+    {
+        const UINT64 Hash = HashName(InName);
+        return Hash > RemovedKey ? Hash : Hash + 2;
+    }
+
+    // 返回是否占用了一个新的空槽
+    static bool InsertToTable(Table* InTable, UINT64 InKey, T* InValue)
+    {
+        const UINT64 Mask = InTable->Capacity - 1;
+        for (UINT64 ix = InKey & Mask;; ix = (ix + 1) & Mask)
+        {
+            Slot& CurrSlot = InTable->Slots[ix];
+            const UINT64 SlotKey = CurrSlot.Key.load(std::memory_order_relaxed);
+            if (SlotKey == EmptyKey || SlotKey == RemovedKey)
+            {
+                // 先写值再写键, 读到键的线程一定能读到值
+                CurrSlot.Value.store(InValue, std::memory_order_release);
+                CurrSlot.Key.store(InKey, std::memory_order_release);
+                return SlotKey == EmptyKey;
+            }
+        }
+    }
+
+    // 墓碑不会被复制, 新表容量保证装载率不超过一半
+    Table* Rehash()
+    {
+        const Table* OldTable = CurrentTable.load(std::memory_order_relaxed);
+
+        UINT64 NewCapacity = InitCapacity;
+        while (NewCapacity < (ValueNum + 1) * 2) NewCapacity *= 2;
+
+        auto NewTable = std::make_unique<Table>(NewCapacity);
+        UsedSlotNum = 0;
+        for (UINT64 ix = 0; ix < OldTable->Capacity; ++ix)
+        {
+            const Slot& OldSlot = OldTable->Slots[ix];
+            const UINT64 SlotKey = OldSlot.Key.load(std::memory_order_relaxed);
+            if (SlotKey != EmptyKey && SlotKey != RemovedKey)
+            {
+                InsertToTable(NewTable.get(), SlotKey, OldSlot.Value.load(std::memory_order_relaxed));
+                UsedSlotNum++;
+            }
+        }
+
+        Tables.push_back(std::move(NewTable));
+        CurrentTable.store(Tables.back().get(), std::memory_order_release);
+        return Tables.back().get();
+    }
+
+private:
+    std::atomic<Table*> CurrentTable = nullptr;
+
+    mutable std::mutex WriteMutex;
+    std::vector<std::unique_ptr<Table>> Tables;     // 包括已经替换掉的旧表
+    UINT64 UsedSlotNum = 0;     // 包括墓碑
+    UINT64 ValueNum = 0;
+};
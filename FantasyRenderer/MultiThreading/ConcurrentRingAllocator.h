@@ -1,18 +1,31 @@
 #pragma once
 #include <windows.h>
 #include <atomic>
-#include <thread>
-#include <vector>
+#include <deque>
+#include <mutex>
 
+#include "AllocatorStats.h"
+#include "../Utility/AlignUtil.h"
 #include "../Utility/Exception.h"
 #include "../Utility/Macros.h"
 
-// For GPU descriptor allocate.
+/*
+ * For GPU descriptor and constant buffer allocate.
+ * Head和Tail只增不减, 对Capacity取模得到实际位置, Tail - Head即为已使用的大小.
+ * 分配时用CAS推进Tail, 多个线程同时分配也不会拿到重叠的区间. 分配的区间总是连续的, 放不下时跳过环尾剩余的部分.
+ * 每帧结束时调用MarkFrame()记录当前的Tail, 该帧在GPU上完成后调用RetireFrames()把Head推进到记录的位置.
+ */
 class ConcurrentRingAllocator
 {
+    struct FrameMark
+    {
+        UINT64 FrameTag;
+        size_t Tail;
+    };
+
 public:
     CLASS_NO_COPY(ConcurrentRingAllocator)
-    
+
     explicit ConcurrentRingAllocator(size_t InCapacity)
         : Capacity(InCapacity)
     {
@@ -23,52 +36,109 @@ public:
 public:
     bool TryAllocate(size_t* OutValue, size_t InSize = 1)
     {
-        const size_t CurrentHead = Head.load(std::memory_order_acquire);
-        const size_t CurrentTail = Tail.load(std::memory_order_acquire);
+        if (InSize == 0) return false;
+        if (InSize > Capacity)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
 
-        const size_t AvailableSize = GetAvailableSize(CurrentHead, CurrentTail);
-        if (AvailableSize < InSize) return false;
+        size_t CurrentTail = Tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            const size_t Offset = CurrentTail % Capacity;
+            const size_t Padding = Offset + InSize > Capacity ? Capacity - Offset : 0;
+            const size_t NewTail = CurrentTail + Padding + InSize;
+            const size_t CurrentHead = Head.load(std::memory_order_acquire);
+            if (NewTail > CurrentHead + Capacity)
+            {
+                Counter.RecordFailure();
+                return false;
+            }
 
-        const size_t NewTail = (CurrentTail + InSize) % Capacity; 
-        *OutValue = CurrentTail;
+            if (Tail.compare_exchange_weak(CurrentTail, NewTail, std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                Counter.RecordAllocation();
+                Counter.RecordUsedSize(NewTail - CurrentHead);
 
-        Tail.store(NewTail, std::memory_order_release);
-        
-        return true;
+                *OutValue = (CurrentTail + Padding) % Capacity;
+                return true;
+            }
+        }
     }
-    
-    bool TryFree(size_t InSize)
-    {
-        const size_t CurrentHead = Head.load(std::memory_order_acquire);
-        const size_t CurrentTail = Tail.load(std::memory_order_acquire);
 
-        const size_t UsedSize = Capacity - GetAvailableSize(CurrentHead, CurrentTail);
-        if (InSize > UsedSize) return false;
+    // 记录到此为止的分配都属于InFrameTag这一帧
+    void MarkFrame(UINT64 InFrameTag)
+    {
+        std::lock_guard LockGuard(MarksMutex);
+        ThrowIfFalse(FrameMarks.empty() || FrameMarks.back().FrameTag <= InFrameTag, "Frame tags must be marked in increasing order.");
+        FrameMarks.push_back(FrameMark{ InFrameTag, Tail.load(std::memory_order_acquire) });
+    }
 
-        const size_t NewHead = (CurrentHead + InSize) % Capacity;
+    // 释放FrameTag不大于InCompletedFrameTag的帧的所有分配
+    void RetireFrames(UINT64 InCompletedFrameTag)
+    {
+        std::lock_guard LockGuard(MarksMutex);
 
-        Head.store(NewHead, std::memory_order_release);
+        size_t NewHead = INVALID_SIZE_64;
+        while (!FrameMarks.empty() && FrameMarks.front().FrameTag <= InCompletedFrameTag)
+        {
+            NewHead = FrameMarks.front().Tail;
+            FrameMarks.pop_front();
+            Counter.RecordFree();
+        }
+        if (NewHead != INVALID_SIZE_64) Head.store(NewHead, std::memory_order_release);
+    }
 
-        return true;
+    size_t GetUsedSize() const
+    {
+        return Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire);
     }
-    
+
     void Clear()
     {
+        std::lock_guard LockGuard(MarksMutex);
+        FrameMarks.clear();
         Head.store(0, std::memory_order_release);
         Tail.store(0, std::memory_order_release);
+        Counter.Reset();
     }
 
-private:
-    size_t GetAvailableSize(size_t Head, size_t Tail) const
+    // 整帧一起回收, 所以FreeNum记录的是回收的帧数. 空闲部分最多被环尾分成两段
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const
     {
-        if (Head < Tail) return Capacity - (Tail - Head + 1);
-        else if (Head > Tail) return Head - Tail - 1;
-        else return Capacity;
+        *OutStats = AllocatorStats{};
+
+        const size_t CurrentHead = Head.load(std::memory_order_acquire);
+        const size_t CurrentTail = Tail.load(std::memory_order_acquire);
+        const size_t Used = CurrentTail > CurrentHead ? CurrentTail - CurrentHead : 0;
+
+        OutStats->Capacity = Capacity;
+        OutStats->UsedSize = Used;
+        Counter.FillStats(OutStats);
+
+        const size_t FreeBegin = CurrentTail % Capacity;
+        const size_t FreeSize = Capacity - Used;
+        if (FreeBegin + FreeSize > Capacity)
+        {
+            OutStats->AddFreeBlock(FreeBegin, Capacity - FreeBegin, bInCollectFreeRanges);
+            OutStats->AddFreeBlock(0, FreeBegin + FreeSize - Capacity, bInCollectFreeRanges);
+        }
+        else
+        {
+            OutStats->AddFreeBlock(FreeBegin, FreeSize, bInCollectFreeRanges);
+        }
+        OutStats->SortFreeRanges();
     }
 
 private:
-    std::atomic<size_t> Head = 0;   
-    std::atomic<size_t> Tail = 0;
+    alignas(64) std::atomic<size_t> Head = 0;
+    alignas(64) std::atomic<size_t> Tail = 0;
 
     const size_t Capacity;
+
+    std::mutex MarksMutex;
+    std::deque<FrameMark> FrameMarks;
+
+    AllocatorStatsCounter Counter;
 };
@@ -70,6 +70,32 @@ public:
         }
     }
 
+    // 各个大小级别的统计换算成字节后合在一起. 每个级别各自覆盖整个TotalSize, 区间互相重叠, 所以不输出FreeRanges
+    void GetStats(AllocatorStats* OutStats) const
+    {
+        *OutStats = AllocatorStats{};
+        for (UINT32 ix = 0; ix < FreeLists.size(); ++ix)
+        {
+            const size_t CurrentBlockSize = BlockMinSize << ix;
+
+            AllocatorStats ListStats;
+            FreeLists[ix]->GetStats(&ListStats, true);
+
+            AllocatorStats BlockStats;
+            BlockStats.Capacity = ListStats.Capacity * CurrentBlockSize;
+            BlockStats.UsedSize = ListStats.UsedSize * CurrentBlockSize;
+            BlockStats.PeakUsedSize = ListStats.PeakUsedSize * CurrentBlockSize;
+            BlockStats.AllocationNum = ListStats.AllocationNum;
+            BlockStats.FreeNum = ListStats.FreeNum;
+            BlockStats.FailedAllocationNum = ListStats.FailedAllocationNum;
+            for (const AllocatorFreeRange& Range : ListStats.FreeRanges)
+            {
+                BlockStats.AddFreeBlock(Range.Offset * CurrentBlockSize, Range.Size * CurrentBlockSize, false);
+            }
+            OutStats->Merge(BlockStats);
+        }
+    }
+
     constexpr UINT32 GetBlockIndex(size_t InSize) const
     {
         if (InSize == 0 || InSize > BlockMaxSize) assert(false && "Beyond Texture Max Size");
@@ -0,0 +1,341 @@
+﻿#pragma once
+#include <bit>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <windows.h>
+
+#include "AllocatorStats.h"
+#include "../Utility/AlignUtil.h"
+#include "../Utility/Macros.h"
+
+/*
+ * TLSF(Two-Level Segregated Fit)偏移分配器, 只管理[0, TotalSize)这段偏移, 不涉及实际内存.
+ * 空闲块按大小分到 一级(2的幂) * 二级(每级再线性分成SecondLevelNum份) 的链表中, 两级各用一个位图记录哪些链表非空,
+ * 分配和释放都是O(1), 释放时与物理上相邻的空闲块合并.
+ * 每次操作都很短, 所以直接用一个互斥锁.
+ */
+
+class ConcurrentTLSFAllocator
+{
+    static constexpr UINT32 SecondLevelLog2 = 5;
+    static constexpr UINT32 SecondLevelNum = 1 << SecondLevelLog2;
+    static constexpr UINT32 FirstLevelNum = 64 - SecondLevelLog2 + 1;
+    static constexpr size_t SmallBlockSize = 1ull << SecondLevelLog2;     // 小于它的块全部放在第0级, 二级线性对应大小
+
+    struct Block
+    {
+        size_t Offset = 0;
+        size_t Size = 0;
+        UINT32 PrevPhysical = INVALID_SIZE_32;
+        UINT32 NextPhysical = INVALID_SIZE_32;
+        UINT32 PrevFree = INVALID_SIZE_32;
+        UINT32 NextFree = INVALID_SIZE_32;
+        bool bFree = false;
+    };
+
+public:
+    CLASS_NO_COPY(ConcurrentTLSFAllocator)
+
+    explicit ConcurrentTLSFAllocator(size_t InTotalSize) : TotalSize(InTotalSize)
+    {
+        Clear();
+    }
+    ~ConcurrentTLSFAllocator() noexcept = default;
+
+public:
+    // InAlignment必须为2的幂
+    bool TryAllocate(size_t* OutAddress, size_t InSize, size_t InAlignment = 1)
+    {
+        if (InSize == 0 || !std::has_single_bit(InAlignment)) return false;
+
+        std::lock_guard LockGuard(Mutex);
+
+        // 对齐时最多浪费InAlignment - 1, 多找这么多保证对齐后还放得下
+        UINT32 UsedIndex = INVALID_SIZE_32;
+        if (InSize <= TotalSize && InAlignment - 1 <= TotalSize - InSize) UsedIndex = FindFreeBlock(InSize + InAlignment - 1);
+        if (UsedIndex == INVALID_SIZE_32)
+        {
+            Counter.RecordFailure();
+            return false;
+        }
+        RemoveFreeBlock(UsedIndex);
+
+        // 对齐产生的前部空隙作为一个空闲块留下, 前一个物理块一定不是空闲的(否则已经合并), 不需要再合并
+        const size_t AlignedOffset = Align(Blocks[UsedIndex].Offset, InAlignment);
+        if (AlignedOffset > Blocks[UsedIndex].Offset)
+        {
+            const UINT32 GapIndex = UsedIndex;
+            UsedIndex = SplitBlock(GapIndex, AlignedOffset - Blocks[GapIndex].Offset);
+            InsertFreeBlock(GapIndex);
+        }
+
+        if (Blocks[UsedIndex].Size > InSize)
+        {
+            const UINT32 RemainIndex = SplitBlock(UsedIndex, InSize);
+            InsertFreeBlock(RemainIndex);
+        }
+
+        Blocks[UsedIndex].bFree = false;
+        UsedBlocks[Blocks[UsedIndex].Offset] = UsedIndex;
+        UsedSize += Blocks[UsedIndex].Size;
+        Counter.RecordAllocation();
+        Counter.RecordUsedSize(UsedSize);
+
+        *OutAddress = Blocks[UsedIndex].Offset;
+        return true;
+    }
+
+    bool TryFree(size_t InAddress)
+    {
+        std::lock_guard LockGuard(Mutex);
+
+        const auto Iter = UsedBlocks.find(InAddress);
+        if (Iter == UsedBlocks.end()) return false;
+
+        UINT32 BlockIndex = Iter->second;
+        UsedBlocks.erase(Iter);
+        UsedSize -= Blocks[BlockIndex].Size;
+        Counter.RecordFree();
+
+        const UINT32 PrevIndex = Blocks[BlockIndex].PrevPhysical;
+        if (PrevIndex != INVALID_SIZE_32 && Blocks[PrevIndex].bFree)
+        {
+            RemoveFreeBlock(PrevIndex);
+            BlockIndex = MergeBlock(PrevIndex, BlockIndex);
+        }
+
+        const UINT32 NextIndex = Blocks[BlockIndex].NextPhysical;
+        if (NextIndex != INVALID_SIZE_32 && Blocks[NextIndex].bFree)
+        {
+            RemoveFreeBlock(NextIndex);
+            BlockIndex = MergeBlock(BlockIndex, NextIndex);
+        }
+
+        InsertFreeBlock(BlockIndex);
+        return true;
+    }
+
+    void Clear()
+    {
+        std::lock_guard LockGuard(Mutex);
+
+        Blocks.clear();
+        RecycledBlocks.clear();
+        UsedBlocks.clear();
+        UsedSize = 0;
+        Counter.Reset();
+
+        FirstLevelBitmap = 0;
+        for (UINT32 ix = 0; ix < FirstLevelNum; ++ix)
+        {
+            SecondLevelBitmaps[ix] = 0;
+            for (UINT32 jx = 0; jx < SecondLevelNum; ++jx) FreeHeads[ix][jx] = INVALID_SIZE_32;
+        }
+
+        if (TotalSize > 0)
+        {
+            const UINT32 BlockIndex = CreateBlock();
+            Blocks[BlockIndex].Size = TotalSize;
+            InsertFreeBlock(BlockIndex);
+        }
+    }
+
+    size_t GetUsedSize() const
+    {
+        std::lock_guard LockGuard(Mutex);
+        return UsedSize;
+    }
+
+    size_t GetLargestFreeBlockSize() const
+    {
+        std::lock_guard LockGuard(Mutex);
+        if (FirstLevelBitmap == 0) return 0;
+
+        const UINT32 FirstLevel = 63 - std::countl_zero(FirstLevelBitmap);
+        const UINT32 SecondLevel = 31 - std::countl_zero(SecondLevelBitmaps[FirstLevel]);
+
+        size_t LargestSize = 0;
+        for (UINT32 BlockIndex = FreeHeads[FirstLevel][SecondLevel]; BlockIndex != INVALID_SIZE_32; BlockIndex = Blocks[BlockIndex].NextFree)
+        {
+            if (Blocks[BlockIndex].Size > LargestSize) LargestSize = Blocks[BlockIndex].Size;
+        }
+        return LargestSize;
+    }
+
+    void GetStats(AllocatorStats* OutStats, bool bInCollectFreeRanges = false) const
+    {
+        std::lock_guard LockGuard(Mutex);
+
+        *OutStats = AllocatorStats{};
+        OutStats->Capacity = TotalSize;
+        OutStats->UsedSize = UsedSize;
+        Counter.FillStats(OutStats);
+
+        for (UINT32 ix = 0; ix < FirstLevelNum; ++ix)
+        {
+            if ((FirstLevelBitmap & (1ull << ix)) == 0) continue;
+            for (UINT32 jx = 0; jx < SecondLevelNum; ++jx)
+            {
+                for (UINT32 BlockIndex = FreeHeads[ix][jx]; BlockIndex != INVALID_SIZE_32; BlockIndex = Blocks[BlockIndex].NextFree)
+                {
+                    OutStats->AddFreeBlock(Blocks[BlockIndex].Offset, Blocks[BlockIndex].Size, bInCollectFreeRanges);
+                }
+            }
+        }
+        OutStats->SortFreeRanges();
+    }
+
+    // 外部碎片率, 1 - 最大空闲块 / 总空闲大小, 全部空闲或全部占用时为0
+    float GetFragmentation() const
+    {
+        const size_t FreeSize = TotalSize - GetUsedSize();
+        if (FreeSize == 0) return 0.0f;
+        return 1.0f - static_cast<float>(GetLargestFreeBlockSize()) / static_cast<float>(FreeSize);
+    }
+
+private:
+    static void MapSize(size_t InSize, UINT32* OutFirstLevel, UINT32* OutSecondLevel)
+    {
+        if (InSize < SmallBlockSize)
+        {
+            *OutFirstLevel = 0;
+            *OutSecondLevel = static_cast<UINT32>(InSize);
+        }
+        else
+        {
+            const UINT32 Log2Size = 63 - std::countl_zero(static_cast<UINT64>(InSize));
+            *OutSecondLevel = static_cast<UINT32>(InSize >> (Log2Size - SecondLevelLog2)) ^ SecondLevelNum;
+            *OutFirstLevel = Log2Size - SecondLevelLog2 + 1;
+        }
+    }
+
+    // 向上取到下一个二级区间的起点, 这样找到的链表中任何一个块都足够大
+    UINT32 FindFreeBlock(size_t InSize) const
+    {
+        size_t SearchSize = InSize;
+        if (SearchSize >= SmallBlockSize)
+        {
+            const UINT32 Log2Size = 63 - std::countl_zero(static_cast<UINT64>(SearchSize));
+            SearchSize += (1ull << (Log2Size - SecondLevelLog2)) - 1;
+        }
+        UINT32 FirstLevel, SecondLevel;
+        MapSize(SearchSize, &FirstLevel, &SecondLevel);
+        if (FirstLevel >= FirstLevelNum) return INVALID_SIZE_32;
+
+        UINT32 SecondLevelMap = SecondLevelBitmaps[FirstLevel] & (~0u << SecondLevel);
+        if (SecondLevelMap == 0)
+        {
+            const UINT64 FirstLevelMap = FirstLevel + 1 < 64 ? FirstLevelBitmap & (~0ull << (FirstLevel + 1)) : 0;
+            if (FirstLevelMap == 0) return INVALID_SIZE_32;
+
+            FirstLevel = std::countr_zero(FirstLevelMap);
+            SecondLevelMap = SecondLevelBitmaps[FirstLevel];
+        }
+        SecondLevel = std::countr_zero(SecondLevelMap);
+
+        return FreeHeads[FirstLevel][SecondLevel];
+    }
+
+    void InsertFreeBlock(UINT32 InBlockIndex)
+    {
+        UINT32 FirstLevel, SecondLevel;
+        MapSize(Blocks[InBlockIndex].Size, &FirstLevel, &SecondLevel);
+
+        Block& CurrBlock = Blocks[InBlockIndex];
+        CurrBlock.bFree = true;
+        CurrBlock.PrevFree = INVALID_SIZE_32;
+        CurrBlock.NextFree = FreeHeads[FirstLevel][SecondLevel];
+        if (CurrBlock.NextFree != INVALID_SIZE_32) Blocks[CurrBlock.NextFree].PrevFree = InBlockIndex;
+
+        FreeHeads[FirstLevel][SecondLevel] = InBlockIndex;
+        FirstLevelBitmap |= 1ull << FirstLevel;
+        SecondLevelBitmaps[FirstLevel] |= 1u << SecondLevel;
+    }
+
+    void RemoveFreeBlock(UINT32 InBlockIndex)
+    {
+        UINT32 FirstLevel, SecondLevel;
+        MapSize(Blocks[InBlockIndex].Size, &FirstLevel, &SecondLevel);
+
+        Block& CurrBlock = Blocks[InBlockIndex];
+        if (CurrBlock.PrevFree != INVALID_SIZE_32) Blocks[CurrBlock.PrevFree].NextFree = CurrBlock.NextFree;
+        else FreeHeads[FirstLevel][SecondLevel] = CurrBlock.NextFree;
+        if (CurrBlock.NextFree != INVALID_SIZE_32) Blocks[CurrBlock.NextFree].PrevFree = CurrBlock.PrevFree;
+
+        if (FreeHeads[FirstLevel][SecondLevel] == INVALID_SIZE_32)
+        {
+            SecondLevelBitmaps[FirstLevel] &= ~(1u << SecondLevel);
+            if (SecondLevelBitmaps[FirstLevel] == 0) FirstLevelBitmap &= ~(1ull << FirstLevel);
+        }
+
+        CurrBlock.bFree = false;
+        CurrBlock.PrevFree = INVALID_SIZE_32;
+        CurrBlock.NextFree = INVALID_SIZE_32;
+    }
+
+    // 把InBlockIndex截成InSize大小, 剩余部分成为紧跟其后的新块, 返回新块
+    UINT32 SplitBlock(UINT32 InBlockIndex, size_t InSize)
+    {
+        const UINT32 RemainIndex = CreateBlock();
+        Block& CurrBlock = Blocks[InBlockIndex];
+        Block& RemainBlock = Blocks[RemainIndex];
+
+        RemainBlock.Offset = CurrBlock.Offset + InSize;
+        RemainBlock.Size = CurrBlock.Size - InSize;
+        RemainBlock.PrevPhysical = InBlockIndex;
+        RemainBlock.NextPhysical = CurrBlock.NextPhysical;
+        if (RemainBlock.NextPhysical != INVALID_SIZE_32) Blocks[RemainBlock.NextPhysical].PrevPhysical = RemainIndex;
+
+        CurrBlock.Size = InSize;
+        CurrBlock.NextPhysical = RemainIndex;
+        return RemainIndex;
+    }
+
+    // InNextIndex并入InBlockIndex, 返回合并后的块
+    UINT32 MergeBlock(UINT32 InBlockIndex, UINT32 InNextIndex)
+    {
+        Block& CurrBlock = Blocks[InBlockIndex];
+        const Block& NextBlock = Blocks[InNextIndex];
+
+        CurrBlock.Size += NextBlock.Size;
+        CurrBlock.NextPhysical = NextBlock.NextPhysical;
+        if (CurrBlock.NextPhysical != INVALID_SIZE_32) Blocks[CurrBlock.NextPhysical].PrevPhysical = InBlockIndex;
+
+        RecycleBlock(InNextIndex);
+        return InBlockIndex;
+    }
+
+    UINT32 CreateBlock()
+    {
+        if (!RecycledBlocks.empty())
+        {
+            const UINT32 BlockIndex = RecycledBlocks.back();
+            RecycledBlocks.pop_back();
+            Blocks[BlockIndex] = Block{};
+            return BlockIndex;
+        }
+        Blocks.emplace_back();
+        return static_cast<UINT32>(Blocks.size() - 1);
+    }
+
+    void RecycleBlock(UINT32 InBlockIndex)
+    {
+        RecycledBlocks.push_back(InBlockIndex);
+    }
+
+private:
+    size_t TotalSize;
+    size_t UsedSize = 0;
+
+    mutable std::mutex Mutex;
+    std::vector<Block> Blocks;
+    std::vector<UINT32> RecycledBlocks;
+    std::unordered_map<size_t, UINT32> UsedBlocks;     // Offset -> Block
+
+    UINT64 FirstLevelBitmap = 0;
+    UINT32 SecondLevelBitmaps[FirstLevelNum] = {};
+    UINT32 FreeHeads[FirstLevelNum][SecondLevelNum];
+
+    AllocatorStatsCounter Counter;
+};
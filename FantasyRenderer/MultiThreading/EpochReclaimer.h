@@ -0,0 +1,206 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <windows.h>
+
+#include "../Utility/Exception.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 基于epoch的内存回收, 给无锁容器用: 读者不加锁遍历, 写者摘下的节点推迟到所有可能还在读它的线程离开后再释放.
+ * 读者用EpochGuard包住对共享节点的访问, 进入时登记当前的全局epoch, 离开时清除登记.
+ * 写者先把节点从容器中摘下, 再调用Retire(), 节点记下此时的全局epoch r; 只有当全局epoch推进到r + 2时才会释放,
+ * 而全局epoch只有在所有处于EpochGuard中的线程都已登记为当前epoch时才能推进一步, 所以摘下前就进入的读者一定都已离开.
+ * 全进程共用一个实例, 每个线程第一次进入时占用一个槽位, 线程退出时归还.
+ * EpochGuard可以嵌套; 持有期间不要阻塞等待其他线程, 否则会让回收一直推迟.
+ */
+
+class EpochReclaimer
+{
+    static constexpr UINT32 MaxThreadNum = 256;
+    static constexpr UINT64 InactiveEpoch = ~0ull;
+    static constexpr UINT64 CollectThreshold = 64;     // 待回收的节点攒到这么多时, Retire()顺便尝试回收
+
+    struct alignas(64) ThreadSlot
+    {
+        std::atomic<UINT64> Epoch = InactiveEpoch;
+        std::atomic<bool> bUsed = false;
+    };
+
+    struct RetiredObject
+    {
+        void* Object;
+        void (*Deleter)(void*);
+        UINT64 Epoch;
+    };
+
+    struct ThreadRecord
+    {
+        ~ThreadRecord()
+        {
+            if (SlotIndex != INVALID_SLOT) Get().ReleaseSlot(SlotIndex);
+        }
+
+        static constexpr UINT32 INVALID_SLOT = ~0u;
+
+        UINT32 SlotIndex = INVALID_SLOT;
+        UINT32 Depth = 0;
+    };
+
+public:
+    CLASS_NO_COPY(EpochReclaimer)
+
+    ~EpochReclaimer()
+    {
+        // 进程退出, 已经不会有读者了
+        for (const RetiredObject& Retired : RetiredObjects) Retired.Deleter(Retired.Object);
+    }
+
+    static EpochReclaimer& Get()
+    {
+        static EpochReclaimer Instance;
+        return Instance;
+    }
+
+public:
+    void Enter()
+    {
+        ThreadRecord& Record = GetThreadRecord();
+        if (Record.Depth++ > 0) return;
+
+        ThreadSlot& Slot = Slots[Record.SlotIndex];
+
+        // 登记后再确认一次全局epoch没变, 保证推进epoch的线程要么看到登记, 要么在登记前就已推进完
+        UINT64 Epoch = GlobalEpoch.load(std::memory_order_seq_cst);
+        while (true)
+        {
+            Slot.Epoch.store(Epoch, std::memory_order_seq_cst);
+            const UINT64 CurrentEpoch = GlobalEpoch.load(std::memory_order_seq_cst);
+            if (CurrentEpoch == Epoch) break;
+            Epoch = CurrentEpoch;
+        }
+    }
+
+    void Leave()
+    {
+        ThreadRecord& Record = GetThreadRecord();
+        if (--Record.Depth > 0) return;
+
+        Slots[Record.SlotIndex].Epoch.store(InactiveEpoch, std::memory_order_release);
+    }
+
+    // InObject必须已经从容器中摘下, 新的读者不可能再访问到它
+    void Retire(void* InObject, void (*InDeleter)(void*))
+    {
+        const UINT64 Epoch = GlobalEpoch.load(std::memory_order_seq_cst);
+
+        bool bShouldCollect;
+        {
+            std::lock_guard LockGuard(Mutex);
+            RetiredObjects.push_back(RetiredObject{ InObject, InDeleter, Epoch });
+            bShouldCollect = RetiredObjects.size() >= CollectThreshold;
+        }
+        if (bShouldCollect) Collect();
+    }
+
+    template <typename T>
+    void Retire(T* InObject)
+    {
+        Retire(InObject, [](void* InPtr) { delete static_cast<T*>(InPtr); });
+    }
+
+    // 尝试推进全局epoch, 并释放已经没有读者的节点
+    void Collect()
+    {
+        TryAdvanceEpoch();
+
+        const UINT64 Epoch = GlobalEpoch.load(std::memory_order_seq_cst);
+
+        std::vector<RetiredObject> ObjectsToDelete;
+        {
+            std::lock_guard LockGuard(Mutex);
+            for (UINT64 ix = 0; ix < RetiredObjects.size();)
+            {
+                if (RetiredObjects[ix].Epoch + 2 <= Epoch)
+                {
+                    ObjectsToDelete.push_back(RetiredObjects[ix]);
+                    RetiredObjects[ix] = RetiredObjects.back();
+                    RetiredObjects.pop_back();
+                }
+                else
+                {
+                    ix++;
+                }
+            }
+        }
+
+        // 析构可能很重, 也可能再次Retire(), 放在锁外
+        for (const RetiredObject& Retired : ObjectsToDelete) Retired.Deleter(Retired.Object);
+    }
+
+private:
+    EpochReclaimer() = default;
+
+    bool TryAdvanceEpoch()
+    {
+        UINT64 Epoch = GlobalEpoch.load(std::memory_order_seq_cst);
+
+        const UINT32 SlotNum = UsedSlotNum.load(std::memory_order_acquire);
+        for (UINT32 ix = 0; ix < SlotNum; ++ix)
+        {
+            const UINT64 SlotEpoch = Slots[ix].Epoch.load(std::memory_order_seq_cst);
+            if (SlotEpoch != InactiveEpoch && SlotEpoch != Epoch) return false;
+        }
+        return GlobalEpoch.compare_exchange_strong(Epoch, Epoch + 1, std::memory_order_seq_cst);
+    }
+
+    ThreadRecord& GetThreadRecord()
+    {
+        thread_local ThreadRecord Record;
+        if (Record.SlotIndex == ThreadRecord::INVALID_SLOT) Record.SlotIndex = AcquireSlot();
+        return Record;
+    }
+
+    UINT32 AcquireSlot()
+    {
+        for (UINT32 ix = 0; ix < MaxThreadNum; ++ix)
+        {
+            bool bUsed = false;
+            if (!Slots[ix].bUsed.load(std::memory_order_relaxed) && Slots[ix].bUsed.compare_exchange_strong(bUsed, true, std::memory_order_acq_rel))
+            {
+                // 扫描时只需要看到最高的被用过的槽位
+                UINT32 SlotNum = UsedSlotNum.load(std::memory_order_relaxed);
+                while (SlotNum < ix + 1 && !UsedSlotNum.compare_exchange_weak(SlotNum, ix + 1, std::memory_order_release)) {}
+                return ix;
+            }
+        }
+        ThrowIfFalse(false, "Too many threads use EpochReclaimer.");
+        return ThreadRecord::INVALID_SLOT;
+    }
+
+    void ReleaseSlot(UINT32 InSlotIndex)
+    {
+        Slots[InSlotIndex].Epoch.store(InactiveEpoch, std::memory_order_release);
+        Slots[InSlotIndex].bUsed.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<UINT64> GlobalEpoch = 0;
+
+    ThreadSlot Slots[MaxThreadNum];
+    std::atomic<UINT32> UsedSlotNum = 0;
+
+    std::mutex Mutex;
+    std::vector<RetiredObject> RetiredObjects;
+};
+
+
+class EpochGuard
+{
+public:
+    CLASS_NO_COPY(EpochGuard)
+
+    EpochGuard() { EpochReclaimer::Get().Enter(); }
+    ~EpochGuard() { EpochReclaimer::Get().Leave(); }
+};
@@ -0,0 +1,145 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <windows.h>
+
+#include "../Utility/AlignUtil.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 一帧内的临时内存, 只分配不释放, 整帧用完后Reset()一次性回收.
+ * 分配时在当前内存块上原子地推进偏移, 多个线程可以同时分配; 当前块用完时加锁换到下一块.
+ * Reset()后保留所有内存块, 所以每帧分配的总量稳定后不会再向系统申请内存, GetHeapAllocationNum()可以用来确认这一点.
+ */
+
+class FrameArena
+{
+    struct Chunk
+    {
+        explicit Chunk(size_t InSize) : Data(std::make_unique<std::byte[]>(InSize)), Size(InSize) {}
+
+        std::unique_ptr<std::byte[]> Data;
+        size_t Size;
+        std::atomic<size_t> Offset = 0;
+    };
+
+public:
+    CLASS_NO_COPY(FrameArena)
+
+    explicit FrameArena(size_t InChunkSize = 64 * 1024) : ChunkSize(InChunkSize)
+    {
+        Chunks.push_back(std::make_unique<Chunk>(ChunkSize));
+        CurrentChunk.store(Chunks[0].get(), std::memory_order_release);
+    }
+    ~FrameArena() noexcept = default;
+
+public:
+    void* Allocate(size_t InSize, size_t InAlignment = alignof(std::max_align_t))
+    {
+        AllocationNum.fetch_add(1, std::memory_order_relaxed);
+
+        // 多申请InAlignment - 1字节, 对齐后一定放得下
+        const size_t ReserveSize = InSize + InAlignment - 1;
+        while (true)
+        {
+            Chunk* CurrChunk = CurrentChunk.load(std::memory_order_acquire);
+            const size_t Offset = CurrChunk->Offset.fetch_add(ReserveSize, std::memory_order_relaxed);
+            if (Offset + ReserveSize <= CurrChunk->Size)
+            {
+                const size_t Address = reinterpret_cast<size_t>(CurrChunk->Data.get() + Offset);
+                return reinterpret_cast<void*>(Align(Address, InAlignment));
+            }
+            MoveToNextChunk(CurrChunk, ReserveSize);
+        }
+    }
+
+    // 不会调用析构函数, 所以只用于可平凡析构的类型
+    template <typename T, typename... Args>
+    T* New(Args&&... Arguments)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never calls destructors.");
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(Arguments)...);
+    }
+
+    // 不能和Allocate()同时调用
+    void Reset()
+    {
+        for (const auto& CurrChunk : Chunks) CurrChunk->Offset.store(0, std::memory_order_relaxed);
+        CurrentChunkIndex = 0;
+        CurrentChunk.store(Chunks[0].get(), std::memory_order_release);
+
+        AllocationNum.store(0, std::memory_order_relaxed);
+        HeapAllocationNum.store(0, std::memory_order_relaxed);
+    }
+
+    // 自上次Reset()以来的分配次数
+    UINT32 GetAllocationNum() const { return AllocationNum.load(std::memory_order_relaxed); }
+
+    // 自上次Reset()以来向系统申请内存块的次数
+    UINT32 GetHeapAllocationNum() const { return HeapAllocationNum.load(std::memory_order_relaxed); }
+
+private:
+    void MoveToNextChunk(const Chunk* InFullChunk, size_t InReserveSize)
+    {
+        std::lock_guard LockGuard(ChunksMutex);
+
+        // 其他线程已经换过了
+        if (CurrentChunk.load(std::memory_order_relaxed) != InFullChunk) return;
+
+        // 先复用上一帧留下的块, 跳过放不下的
+        while (++CurrentChunkIndex < Chunks.size())
+        {
+            if (Chunks[CurrentChunkIndex]->Size >= InReserveSize)
+            {
+                CurrentChunk.store(Chunks[CurrentChunkIndex].get(), std::memory_order_release);
+                return;
+            }
+        }
+
+        Chunks.push_back(std::make_unique<Chunk>(InReserveSize > ChunkSize ? InReserveSize : ChunkSize));
+        CurrentChunkIndex = Chunks.size() - 1;
+        CurrentChunk.store(Chunks.back().get(), std::memory_order_release);
+        HeapAllocationNum.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    const size_t ChunkSize;
+
+    std::atomic<Chunk*> CurrentChunk = nullptr;
+    std::atomic<UINT32> AllocationNum = 0;
+    std::atomic<UINT32> HeapAllocationNum = 0;
+
+    std::mutex ChunksMutex;
+    std::vector<std::unique_ptr<Chunk>> Chunks;
+    size_t CurrentChunkIndex = 0;
+};
+
+
+// 让std::pmr容器从FrameArena中分配, 释放为空操作
+class FrameArenaResource : public std::pmr::memory_resource
+{
+public:
+    explicit FrameArenaResource(FrameArena* InArena) : Arena(InArena) {}
+
+private:
+    void* do_allocate(size_t InSize, size_t InAlignment) override
+    {
+        return Arena->Allocate(InSize, InAlignment);
+    }
+
+    void do_deallocate(void* InPointer, size_t InSize, size_t InAlignment) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& InOther) const noexcept override
+    {
+        return this == &InOther;
+    }
+
+private:
+    FrameArena* Arena;
+};
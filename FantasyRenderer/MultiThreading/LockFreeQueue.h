@@ -8,7 +8,8 @@
 #include "../Utility/Macros.h"
 
 /*
- * This class has not been used.
+ * Chase-Lev work stealing deque.
+ * 只有拥有者线程可以调用Push()和Pop(), 在Top端后进先出; 其他线程只能调用Steal(), 从Bottom端先进先出.
  */
 
 template <typename T>
@@ -20,7 +21,7 @@ class LockFreeQueue
     public:
         CLASS_NO_COPY(Array)
 
-        explicit Array(UINT64 InCapacity)
+        explicit Array(INT64 InCapacity)
             : Capacity(InCapacity),
               IndexMask(InCapacity - 1),
               Data(new std::atomic<T>[InCapacity])
@@ -31,26 +32,25 @@ class LockFreeQueue
         }
 
     public:
-        UINT64 GetCapacity() const
+        INT64 GetCapacity() const
         {
             return Capacity;
         }
 
-        void SetIndexElement(UINT64 Index, T InValue)
+        void SetIndexElement(INT64 Index, T InValue)
         {
             Data[Index & IndexMask].store(InValue, std::memory_order_relaxed);
         }
-        
-        T GetIndexElement(UINT64 Index)
+
+        T GetIndexElement(INT64 Index) const
         {
             return Data[Index & IndexMask].load(std::memory_order_relaxed);
         }
 
-        // 会改变本身的存储地址
-        Array* Resize(UINT64 InBottom, UINT64 InTop)
+        Array* Resize(INT64 InBottom, INT64 InTop) const
         {
             Array* NewArray = new Array(Capacity * 2);
-            for (UINT64 ix = InBottom; ix != InTop; ++ix)
+            for (INT64 ix = InBottom; ix != InTop; ++ix)
             {
                 NewArray->SetIndexElement(ix, GetIndexElement(ix));
             }
@@ -59,17 +59,17 @@ class LockFreeQueue
 
 
     private:
-        UINT64 Capacity;
-        UINT64 IndexMask;   // 有了掩码，数组就成了环
+        INT64 Capacity;
+        INT64 IndexMask;   // 有了掩码，数组就成了环
         std::atomic<T>* Data;
     };
-    
+
 public:
     CLASS_NO_COPY(LockFreeQueue)
 
-    LockFreeQueue(UINT64 InCapacity = 512)
+    LockFreeQueue(INT64 InCapacity = 512)
     {
-        assert(InCapacity > 0);
+        assert(InCapacity > 0 && (InCapacity & (InCapacity - 1)) == 0);
 
         Top.store(0, std::memory_order_relaxed);
         Bottom.store(0, std::memory_order_relaxed);
@@ -88,20 +88,27 @@ public:
 public:
     bool Empty() const
     {
-        const UINT64 BottomTemp = Bottom.load(std::memory_order_relaxed);
-        const UINT64 TopTemp = Top.load(std::memory_order_relaxed);
-        return BottomTemp <= TopTemp;
+        const INT64 TopTemp = Top.load(std::memory_order_relaxed);
+        const INT64 BottomTemp = Bottom.load(std::memory_order_relaxed);
+        return TopTemp <= BottomTemp;
+    }
+
+    size_t Size() const
+    {
+        const INT64 TopTemp = Top.load(std::memory_order_relaxed);
+        const INT64 BottomTemp = Bottom.load(std::memory_order_relaxed);
+        return TopTemp > BottomTemp ? static_cast<size_t>(TopTemp - BottomTemp) : 0;
     }
 
     void Push(T InValue)
     {
-        const UINT64 BottomTemp = Bottom.load(std::memory_order_acquire);
-        const UINT64 TopTemp = Top.load(std::memory_order_relaxed);
+        const INT64 TopTemp = Top.load(std::memory_order_relaxed);
+        const INT64 BottomTemp = Bottom.load(std::memory_order_acquire);
         Array* ArrayTemp = Arrays.load(std::memory_order_relaxed);
 
-        if (ArrayTemp->GetCapacity() < TopTemp - BottomTemp)
+        if (ArrayTemp->GetCapacity() - 1 < TopTemp - BottomTemp)
         {
-            Resize(ArrayTemp, BottomTemp, TopTemp);
+            ArrayTemp = Resize(ArrayTemp, BottomTemp, TopTemp);
         }
 
         ArrayTemp->SetIndexElement(TopTemp, InValue);
@@ -112,21 +119,22 @@ public:
 
     T Pop()
     {
+        const INT64 TopTemp = Top.load(std::memory_order_relaxed) - 1;
         Array* ArrayTemp = Arrays.load(std::memory_order_relaxed);
-            
-        UINT64 TopTemp = Top.load(std::memory_order_relaxed) - 1;
+
         Top.store(TopTemp, std::memory_order_relaxed);
         std::atomic_thread_fence(std::memory_order_seq_cst);
-            
-        UINT64 BottomTemp = Bottom.load(std::memory_order_relaxed);
+
+        INT64 BottomTemp = Bottom.load(std::memory_order_relaxed);
         T Output = nullptr;
 
-        if (TopTemp >= BottomTemp)
+        if (BottomTemp <= TopTemp)
         {
             Output = ArrayTemp->GetIndexElement(TopTemp);
 
-            if (TopTemp == BottomTemp)
+            if (BottomTemp == TopTemp)
             {
+                // 只剩最后一个元素, 需要和Steal()竞争
                 if (!Bottom.compare_exchange_strong(BottomTemp, BottomTemp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
                 {
                     // 如果刚刚被steal了
@@ -139,22 +147,22 @@ public:
         {
             Top.store(TopTemp + 1, std::memory_order_relaxed);
         }
-            
+
         return Output;
     }
 
     T Steal()
     {
-        UINT64 BottomTemp = Bottom.load(std::memory_order_acquire);
+        INT64 BottomTemp = Bottom.load(std::memory_order_acquire);
         std::atomic_thread_fence(std::memory_order_seq_cst);
-        UINT64 TopTemp = Top.load(std::memory_order_acquire);
+        const INT64 TopTemp = Top.load(std::memory_order_acquire);
 
         T Output = nullptr;
 
-        if (TopTemp > BottomTemp)
+        if (BottomTemp < TopTemp)
         {
-            Array* ArrayTemp = Arrays.load(std::memory_order_consume);
-            Output = ArrayTemp->GetIndexElement(TopTemp);
+            const Array* ArrayTemp = Arrays.load(std::memory_order_acquire);
+            Output = ArrayTemp->GetIndexElement(BottomTemp);
 
             if (!Bottom.compare_exchange_strong(BottomTemp, BottomTemp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
             {
@@ -162,22 +170,23 @@ public:
                 return nullptr;
             }
         }
-            
+
         return Output;
     }
 
 private:
-    void Resize(Array* InArray, UINT64 InBottom, UINT64 InTop)
+    Array* Resize(Array* InArray, INT64 InBottom, INT64 InTop)
     {
-        Array* NewArray = InArray->Resize(InBottom, InTop);     // 改变了InArray本身的存储地址，atomic需要重新store一次
+        // 旧数组可能还在被Steal()读取, 所以只能等到析构时再释放
+        Array* NewArray = InArray->Resize(InBottom, InTop);
         GarbageBin.push_back(InArray);
-        std::swap(NewArray, InArray);
-        Arrays.store(InArray, std::memory_order_release);
+        Arrays.store(NewArray, std::memory_order_release);
+        return NewArray;
     }
-    
+
 private:
-    std::atomic<UINT64> Top;
-    std::atomic<UINT64> Bottom;
+    std::atomic<INT64> Top;
+    std::atomic<INT64> Bottom;
     std::atomic<Array*> Arrays;
     std::vector<Array*> GarbageBin;
 };
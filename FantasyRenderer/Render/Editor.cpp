@@ -39,6 +39,37 @@ void Editor::AddEditFunciton(std::function<void()>&& InFunction)
     }
 }
 
+void Editor::ShowAllocatorStats(const D3D12ResourceAllocator* InAllocator)
+{
+    ImGui::Begin("Allocator Stats");
+
+    auto ShowHeapStats = [InAllocator](const char* InName, D3D12_HEAP_TYPE InHeapType)
+    {
+        if (!ImGui::CollapsingHeader(InName, ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+        AllocatorStats Stats;
+        InAllocator->GetStats(InHeapType, &Stats);
+
+        constexpr float MB = 1024.0f * 1024.0f;
+        const float UsedRatio = Stats.Capacity > 0 ? static_cast<float>(Stats.UsedSize) / static_cast<float>(Stats.Capacity) : 0.0f;
+        ImGui::ProgressBar(UsedRatio, ImVec2(-1.0f, 0.0f));
+        ImGui::Text("Used: %.2f / %.2f MB, Peak: %.2f MB", Stats.UsedSize / MB, Stats.Capacity / MB, Stats.PeakUsedSize / MB);
+        ImGui::Text("Largest free block: %.2f MB, Fragmentation: %.2f", Stats.LargestFreeBlockSize / MB, Stats.GetFragmentation());
+        ImGui::Text("Allocations: %llu, Frees: %llu, Failures: %llu", Stats.AllocationNum, Stats.FreeNum, Stats.FailedAllocationNum);
+
+        float Histogram[AllocatorStats::HistogramBucketNum];
+        for (UINT32 ix = 0; ix < AllocatorStats::HistogramBucketNum; ++ix) Histogram[ix] = static_cast<float>(Stats.FreeBlockHistogram[ix]);
+        ImGui::PlotHistogram("Free blocks (log2 size)", Histogram, AllocatorStats::HistogramBucketNum, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+    };
+
+    ShowHeapStats("Default Heap", D3D12_HEAP_TYPE_DEFAULT);
+    ShowHeapStats("Upload Heap", D3D12_HEAP_TYPE_UPLOAD);
+
+    if (ImGui::Button("Dump To Json")) InAllocator->DumpStats("AllocatorStats.json");
+
+    ImGui::End();
+}
+
 void Editor::ResetEditFunction()
 {
     {
@@ -18,6 +18,9 @@ public:
     // Use it in RenderGraph Execute function
     static void AddEditFunciton(std::function<void()>&& InFunction);
     static void ResetEditFunction(); 
+
+    // 各堆类型的已用大小, 峰值, 碎片和空闲块直方图
+    static void ShowAllocatorStats(const D3D12ResourceAllocator* InAllocator);
 private:
     inline static std::mutex Mutex;
 
@@ -38,21 +38,22 @@ void Renderer::Update(UINT32 InThreadIndex)
     DirectX::XMStoreFloat4x4(&CameraConstantData.Proj, DirectX::XMMatrixTranspose(Proj));
     DirectX::XMStoreFloat4x4(&CameraConstantData.ViewProj, XMMatrixMultiply(View, Proj));
 
-    LightConstants LightConstantData;
+    // LightConstants有10KB左右, 放在帧内存上而不是栈上
+    LightConstants* LightConstantData = RenderGraphImpl->GetFrameArena(InThreadIndex)->New<LightConstants>();
 
     DirectLight* DirectLightData = LightManagerImpl.GetDirectLightData();
-    LightConstantData.DirectLightNum = LightManagerImpl.GetDirectLightNum();
-    for (UINT32 ix = 0; ix < LightConstantData.DirectLightNum; ++ix) LightConstantData.DirectLights[ix] = DirectLightData[ix];
+    LightConstantData->DirectLightNum = LightManagerImpl.GetDirectLightNum();
+    for (UINT32 ix = 0; ix < LightConstantData->DirectLightNum; ++ix) LightConstantData->DirectLights[ix] = DirectLightData[ix];
 
     PointLight* PointLightData = LightManagerImpl.GetPointLightData();
-    LightConstantData.PointLightNum = LightManagerImpl.GetPointLightNum();
-    for (UINT32 ix = 0; ix < LightConstantData.PointLightNum; ++ix) LightConstantData.PointLights[ix] = PointLightData[ix];
+    LightConstantData->PointLightNum = LightManagerImpl.GetPointLightNum();
+    for (UINT32 ix = 0; ix < LightConstantData->PointLightNum; ++ix) LightConstantData->PointLights[ix] = PointLightData[ix];
 
     SpotLight* SpotLightData = LightManagerImpl.GetSpotLightData();
-    LightConstantData.SpotLightNum = LightManagerImpl.GetSpotLightNum();
-    for (UINT32 ix = 0; ix < LightConstantData.SpotLightNum; ++ix) LightConstantData.SpotLights[ix] = SpotLightData[ix];
+    LightConstantData->SpotLightNum = LightManagerImpl.GetSpotLightNum();
+    for (UINT32 ix = 0; ix < LightConstantData->SpotLightNum; ++ix) LightConstantData->SpotLights[ix] = SpotLightData[ix];
     
-    RenderGraphImpl->UpdateConstants(InThreadIndex, &CameraConstantData, &LightConstantData);
+    RenderGraphImpl->UpdateConstants(InThreadIndex, &CameraConstantData, LightConstantData);
 }
 
 
@@ -115,6 +116,7 @@ void Renderer::SetupEditorPass()
     Desc.Height = Window::GetHeight();
     Desc.Width = Window::GetWidth();
     Desc.Type = ERenderGraphPassType::None;
+    Desc.bHasSideEffects = true;
     
     RenderGraphImpl->AddPass<EditorPassConstants>(
         Desc,
@@ -123,6 +125,7 @@ void Renderer::SetupEditorPass()
         },
         [this](const EditorPassConstants& InData, RenderGraphBuilder* InBuilder, D3D12CommandList* InCmdList)
         {
+              Editor::ShowAllocatorStats(RenderGraphImpl->GetDevice()->GetResourceAllocator());
               EditorImpl.CallEditFuncitons();
         }
     );
@@ -140,6 +143,7 @@ void Renderer::CopyToBackBufferPass()
     RenderGraphPassDesc PassDesc{};
     PassDesc.Name = "CopyToBackBuffer";
     PassDesc.Type = ERenderGraphPassType::Copy;
+    PassDesc.bHasSideEffects = true;    // 写swap chain的back buffer, 它不在图中
     RenderGraphImpl->AddPass<CopyBackBufferPassData>(
         PassDesc,
         [=](CopyBackBufferPassData& OutData, RenderGraphBuilder* InBuilder)
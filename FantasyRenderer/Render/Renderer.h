@@ -48,5 +48,5 @@ private:
     
     bool RenderFinish = false;
     bool ThreadActive[RenderThreadNum] = { false };
-    TaskExecutor ThreadExecutor;
+    TaskExecutor ThreadExecutor{ ThreadPoolDesc{ .ThreadNum = RenderThreadNum, .Name = "RenderThread" } };   // 每个渲染循环独占一个线程
 };
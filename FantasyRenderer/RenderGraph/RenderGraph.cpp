@@ -17,11 +17,15 @@ RenderGraph::RenderGraph()
 RenderGraph::~RenderGraph() noexcept
 {
     ReleaseCommandLists();
+    ReleaseTransientRanges();
 }
 
 void RenderGraph::Tick()
 {
     FrameIndex++;
+
+    // 被剔除的Pass不会执行, 但仍持有它声明的资源, 不能让资源池回收
+    for (RenderGraphResource* Resource : CulledPassResources) Resource->LastUsedFrame = FrameIndex;
     ResourcePool->Tick(FrameIndex);
 }
 
@@ -39,62 +43,161 @@ void RenderGraph::Setup()
     }
 }
 
+static RenderGraphResourceDesc GetCoreResourceDesc(D3D12Device* InDevice, const RenderGraphBuffer* InBuffer)
+{
+    const D3D12BufferDesc* BufferDesc = InBuffer->Desc ? InBuffer->Desc : InBuffer->Buffer->GetDesc();
+
+    RenderGraphResourceDesc Desc;
+    Desc.Name = InBuffer->Name;
+    Desc.Kind = ERenderGraphResourceKind::Buffer;
+    Desc.bImported = InBuffer->Desc == nullptr;
+    Desc.bOutput = InBuffer->bOutput;
+    Desc.InitialState = ToRenderGraphResourceState(BufferDesc->State);
+
+    // 只有Default Buffer放在临时堆中, Upload Buffer和只在创建时上传一次数据的资源仍单独分配
+    if (BufferDesc->Type == ED3D12BufferType::Default && InBuffer->Data == nullptr)
+    {
+        Desc.Size = Align(BufferDesc->Size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        Desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    }
+    return Desc;
+}
+
+static RenderGraphResourceDesc GetCoreResourceDesc(D3D12Device* InDevice, const RenderGraphTexture* InTexture)
+{
+    const D3D12TextureDesc* TextureDesc = InTexture->Desc ? InTexture->Desc : InTexture->Texture->GetDesc();
+
+    RenderGraphResourceDesc Desc;
+    Desc.Name = InTexture->Name;
+    Desc.Kind = ERenderGraphResourceKind::Texture;
+    Desc.bImported = InTexture->Desc == nullptr;
+    Desc.bOutput = InTexture->bOutput;
+    Desc.InitialState = ToRenderGraphResourceState(TextureDesc->State);
+
+    if (InTexture->Data == nullptr)
+    {
+        const D3D12_RESOURCE_ALLOCATION_INFO AllocationInfo = D3D12Texture::GetAllocationInfo(InDevice, *TextureDesc);
+        Desc.Size = AllocationInfo.SizeInBytes;
+        Desc.Alignment = AllocationInfo.Alignment;
+    }
+    return Desc;
+}
+
+static ED3D12ResourceLocationType GetTransientLocationType(ERenderGraphResourceKind InKind)
+{
+    return InKind == ERenderGraphResourceKind::Texture ? ED3D12ResourceLocationType::Texture : ED3D12ResourceLocationType::DefaultBuffer;
+}
+
 void RenderGraph::Compile()
 {
+    // 把各Pass的读写转成RenderGraphCore的描述, 依赖, 资源的生命周期和临时资源的放置由它计算
+    Core.Clear();
+
+    std::unordered_map<RenderGraphResource*, UINT32> ResourceIndices;
+    std::vector<RenderGraphResource*> CoreResources;
+    auto GetResourceIndex = [this, &ResourceIndices, &CoreResources](auto* InResource)
+    {
+        const auto [Iterator, bInserted] = ResourceIndices.try_emplace(InResource, static_cast<UINT32>(CoreResources.size()));
+        if (bInserted)
+        {
+            Core.AddResource(GetCoreResourceDesc(Device.get(), InResource));
+            CoreResources.push_back(InResource);
+        }
+        return Iterator->second;
+    };
+
+    for (auto& Pass : Passes)
+    {
+        RenderGraphPass* PassPtr = Pass.get();
+        const UINT32 PassIndex = Core.AddPass(PassPtr->Desc.Name, PassPtr->Desc.Type);
+        if (PassPtr->Desc.bHasSideEffects) Core.MarkSideEffect(PassIndex);
+
+        for (auto Buffer : PassPtr->ReadBuffers) Core.ReadResource(PassIndex, GetResourceIndex(Buffer), ToRenderGraphResourceState(PassPtr->ResourceStateMap[Buffer]));
+        for (auto Buffer : PassPtr->WriteBuffers) Core.WriteResource(PassIndex, GetResourceIndex(Buffer), ToRenderGraphResourceState(PassPtr->ResourceStateMap[Buffer]));
+        for (auto Texture : PassPtr->ReadTextures) Core.ReadResource(PassIndex, GetResourceIndex(Texture), ToRenderGraphResourceState(PassPtr->ResourceStateMap[Texture]));
+        for (auto Texture : PassPtr->WriteTextures) Core.WriteResource(PassIndex, GetResourceIndex(Texture), ToRenderGraphResourceState(PassPtr->ResourceStateMap[Texture]));
+    }
+    Core.Compile();
+
+    // 被剔除的Pass不建立任务, 也不占用命令列表
     std::vector<Task> Tasks(Passes.size());
-    for (UINT32 ix = 0; ix < Tasks.size(); ++ix)
+    for (const UINT32 PassIndex : Core.GetExecutionOrder())
     {
-        Tasks[ix] = ExecuteFlow.Emplace(Passes[ix].get(), &RenderGraphPass::Execute);
+        Tasks[PassIndex] = ExecuteFlow.Emplace(Passes[PassIndex].get(), &RenderGraphPass::Execute);
+        Tasks[PassIndex].SetName(Passes[PassIndex]->Desc.Name);
     }
-    
-    for (UINT32 i = 0; i < Passes.size(); ++i)
+    for (const UINT32 PassIndex : Core.GetExecutionOrder())
+    {
+        for (const UINT32 SuccessorIndex : Core.GetPassSuccessors(PassIndex)) Tasks[PassIndex].Precede(Tasks[SuccessorIndex]);
+    }
+    ExecuteFlow.Compile();
+
+    const UINT32 ExecutedPassNum = static_cast<UINT32>(Core.GetExecutionOrder().size());
+    for (auto& Resource : FrameResources)
+    {
+        while (Resource->CmdLists.size() > ExecutedPassNum)
+        {
+            delete Resource->CmdLists.back();
+            Resource->CmdLists.pop_back();
+        }
+    }
+
+    // 按编译出的大小为每种临时资源预留一段区间, 临时资源放在区间内规划好的偏移上
+    ReleaseTransientRanges();
+    D3D12ResourceAllocator* ResourceAllocator = Device->GetResourceAllocator();
+    for (UINT32 ix = 0; ix < static_cast<UINT32>(ERenderGraphResourceKind::Num); ++ix)
+    {
+        const ERenderGraphResourceKind Kind = static_cast<ERenderGraphResourceKind>(ix);
+        const UINT64 HeapSize = Core.GetTransientHeapSize(Kind);
+        if (HeapSize == 0) continue;
+
+        // 资源在区间内的偏移只按各自的对齐规划, 区间按其中最大的对齐(如MSAA纹理的4MB)预留, 堆中的绝对偏移才是对齐的
+        const UINT64 HeapAlignment = Core.GetTransientHeapAlignment(Kind);
+        const UINT64 RangeAlignment = HeapAlignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ? HeapAlignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        ThrowIfFalse(
+            ResourceAllocator->TryAllocateRange(GetTransientLocationType(Kind), HeapSize, RangeAlignment, &TransientRangeOffsets[ix]),
+            "Transient resource memory allocate failed."
+        );
+        TransientRangeSizes[ix] = HeapSize;
+    }
+
+    CulledPassResources.clear();
+    for (UINT32 ix = 0; ix < CoreResources.size(); ++ix)
     {
-        RenderGraphPass* CurrentPass = Passes[i].get();
+        if (Core.GetResourceFirstPass(ix) == RENDER_GRAPH_INVALID_INDEX) CulledPassResources.push_back(CoreResources[ix]);
 
-        // Get resource last used pass
-        for (auto Buffer : CurrentPass->ReadBuffers) Buffer->LastUsedPass = CurrentPass;
-        for (auto Buffer : CurrentPass->WriteBuffers) Buffer->LastUsedPass = CurrentPass;
-        for (auto Texture : CurrentPass->ReadTextures) Texture->LastUsedPass = CurrentPass;
-        for (auto Texture : CurrentPass->WriteTextures) Texture->LastUsedPass = CurrentPass;
+        // 临时资源以编译时确定的状态创建
+        if (!Core.GetResource(ix).bImported) CoreResources[ix]->SetInitialState(ToD3D12ResourceState(Core.GetResource(ix).InitialState));
 
-        // Set task flow
-        for (UINT32 j = i + 1; j < Passes.size(); ++j)
+        const UINT64 HeapOffset = Core.GetResourceHeapOffset(ix);
+        if (HeapOffset == INVALID_SIZE_64) continue;
+
+        CoreResources[ix]->PlacedOffset = TransientRangeOffsets[static_cast<UINT32>(Core.GetResource(ix).Kind)] + HeapOffset;
+    }
+
+    auto ToPassBarrier = [&CoreResources](const RenderGraphTransitionBarrier& InBarrier)
+    {
+        return RenderGraphPassBarrier{
+            CoreResources[InBarrier.ResourceIndex],
+            ToD3D12ResourceStates(InBarrier.StateBefore),
+            ToD3D12ResourceStates(InBarrier.StateAfter),
+            ToD3D12BarrierFlags(InBarrier.Split)
+        };
+    };
+    for (UINT32 ix = 0; ix < Passes.size(); ++ix)
+    {
+        Passes[ix]->AliasingBarriers.clear();
+        for (const RenderGraphAliasingBarrier& Barrier : Core.GetPassAliasingBarriers(ix))
         {
-            const RenderGraphPass* OtherPass = Passes[j].get();
-
-            const auto Iterator1 = std::ranges::find_if(
-                std::begin(OtherPass->ReadTextures),
-                std::end(OtherPass->ReadTextures),
-                [CurrentPass](RenderGraphTexture* ReadTexture)
-                {
-                    for (const auto& WriteTexture : CurrentPass->WriteTextures)
-                    {
-                        if (WriteTexture == ReadTexture) return true;
-                    }
-                    return false;
-                }
-            );
-
-            if (Iterator1 != std::end(OtherPass->ReadTextures)) { Tasks[i].Precede(Tasks[j]); continue; }
-
-            const auto Iterator2 = std::ranges::find_if(
-                std::begin(OtherPass->ReadBuffers),
-                std::end(OtherPass->ReadBuffers),
-                [CurrentPass](RenderGraphBuffer* ReadBuffer)
-                {
-                    for (const auto& WriteBuffer : CurrentPass->WriteBuffers)
-                    {
-                        if (WriteBuffer == ReadBuffer) return true;
-                    }
-                    return false;
-                }
-            );
-
-            if (Iterator2 != std::end(OtherPass->ReadBuffers)) { Tasks[i].Precede(Tasks[j]); }
+            RenderGraphResource* ResourceBefore = Barrier.ResourceBefore == RENDER_GRAPH_INVALID_INDEX ? nullptr : CoreResources[Barrier.ResourceBefore];
+            Passes[ix]->AliasingBarriers[CoreResources[Barrier.ResourceAfter]] = ResourceBefore;
         }
+
+        Passes[ix]->BeginBarriers.clear();
+        Passes[ix]->EndBarriers.clear();
+        for (const RenderGraphTransitionBarrier& Barrier : Core.GetPassBeginBarriers(ix)) Passes[ix]->BeginBarriers.push_back(ToPassBarrier(Barrier));
+        for (const RenderGraphTransitionBarrier& Barrier : Core.GetPassEndBarriers(ix)) Passes[ix]->EndBarriers.push_back(ToPassBarrier(Barrier));
     }
-    
-    SetResourcesLastPass();
 }
 
 void RenderGraph::Execute(UINT32 InThreadIndex)
@@ -120,15 +223,18 @@ void RenderGraph::Render(UINT32 InThreadIndex)
 {
     Tick();
     ThreadIndex = InThreadIndex;  // 以便在执行过程中用到ThreadFrameIndex
+    FrameResources[ThreadIndex]->FrameIndex = FrameIndex;
     
-    for (UINT32 ix = 0; ix < Passes.size(); ++ix)
+    // 屏障是按执行顺序规划的, 命令列表也按这个顺序提交, 与Pass实际在哪个线程上先录制完无关
+    const std::vector<UINT32>& ExecutionOrder = Core.GetExecutionOrder();
+    FrameResources[ThreadIndex]->CmdLists.resize(ExecutionOrder.size());     // 去掉上一帧额外提交的命令列表
+    for (UINT32 ix = 0; ix < ExecutionOrder.size(); ++ix)
     {
-        Passes[ix]->SetCmdList(FrameResources[ThreadIndex]->CmdLists[ix]);
+        Passes[ExecutionOrder[ix]]->SetCmdList(FrameResources[ThreadIndex]->CmdLists[ix]);
     }
-    FrameResources[ThreadIndex]->CmdLists.clear();
     
     Executor.Run(ExecuteFlow);
-    Device->FinishFrameAllocation();
+    Device->FinishFrameAllocation(FrameResources[InThreadIndex]->FrameIndex);
 }
 
 
@@ -144,7 +250,8 @@ void RenderGraph::Submit(UINT32 InThreadIndex)
 void RenderGraph::WaitForGPU(UINT32 InThreadIndex)
 {
     Device->WaitForGPU(Fence.get(), FrameResources[InThreadIndex]->FenceValue);
-    Device->ClearFrameResource();
+    Device->ClearFrameResource(FrameResources[InThreadIndex]->FrameIndex);
+    FrameResources[InThreadIndex]->Arena.Reset();
 }
 
 
@@ -155,30 +262,17 @@ void RenderGraph::UpdateConstants(UINT32 InThreadIndex, const CameraConstants* I
     FrameResourceData->LightConstantBuffer->UpdateMappedData(InLightConstants);
 }
 
-void RenderGraph::SetResourcesLastPass()
+void RenderGraph::ReleaseTransientRanges()
 {
-    for (auto& Pass : Passes)
+    D3D12ResourceAllocator* ResourceAllocator = Device->GetResourceAllocator();
+    for (UINT32 ix = 0; ix < static_cast<UINT32>(ERenderGraphResourceKind::Num); ++ix)
     {
-        RenderGraphPass* PassPtr = Pass.get();
-            
-        ResourcePool->Buffers.ForEach(
-            [PassPtr](RenderGraphBuffer* InBuffer)
-            {
-                if (InBuffer->LastUsedPass == PassPtr)
-                {
-                    PassPtr->ResourcesToDestroy.push_back(InBuffer);
-                }
-            }
-        );
-        ResourcePool->Textures.ForEach(
-            [PassPtr](RenderGraphTexture* InTexture)
-            {
-                if (InTexture->LastUsedPass == PassPtr)
-                {
-                    PassPtr->ResourcesToDestroy.push_back(InTexture);
-                }
-            }
-        );
+        if (TransientRangeOffsets[ix] == INVALID_SIZE_64) continue;
+
+        const ERenderGraphResourceKind Kind = static_cast<ERenderGraphResourceKind>(ix);
+        while (!ResourceAllocator->TryFreeRange(GetTransientLocationType(Kind), TransientRangeOffsets[ix], TransientRangeSizes[ix]));
+        TransientRangeOffsets[ix] = INVALID_SIZE_64;
+        TransientRangeSizes[ix] = 0;
     }
 }
 
@@ -2,6 +2,7 @@
 #include <memory>
 
 #include "RenderGraphBuilder.h"
+#include "../MultiThreading/FrameArena.h"
 #include "../MultiThreading/ThreadCtrl.h"
 
 struct FrameResource
@@ -12,12 +13,18 @@ struct FrameResource
     {}
     
     UINT64 FenceValue = 0;
+    UINT64 FrameIndex = 0;
     
     std::mutex CmdListsMutex;
-    std::vector<D3D12CommandList*> CmdLists;
+    std::mutex AllocationMutex;
+    std::vector<D3D12CommandList*> CmdLists;        // 前面的按Pass的执行顺序排列
     std::unique_ptr<D3D12ConstantBuffer<CameraConstants>> CameraConstantBuffer;
     std::unique_ptr<D3D12ConstantBuffer<LightConstants>> LightConstantBuffer;
 
+    // 该帧的临时CPU数据, WaitForGPU()后整体回收
+    FrameArena Arena;
+    FrameArenaResource ArenaResource{ &Arena };
+
 };
 
 class RenderGraph
@@ -48,6 +55,7 @@ public:
 public:
     UINT64 GetFrameIndex() const { return FrameIndex; }
     D3D12Device* GetDevice() const { return Device.get(); }
+    FrameArena* GetFrameArena(UINT32 InThreadIndex) const { return &FrameResources[InThreadIndex]->Arena; }
     
 private:
     void Tick();
@@ -56,18 +64,24 @@ private:
     void Submit(UINT32 InThreadIndex);
     void WaitForGPU(UINT32 InThreadIndex);
 
-    void SetResourcesLastPass();
     void ReleaseCommandLists();
+    void ReleaseTransientRanges();
     
 private:
     UINT64 FrameIndex = 0;
     
     std::unique_ptr<D3D12Device> Device;
     std::vector<std::unique_ptr<RenderGraphPass>> Passes;
+    RenderGraphCore Core;     // 依赖, 资源的生命周期和临时资源的放置由它计算
+    std::vector<RenderGraphResource*> CulledPassResources;     // 只被剔除的Pass使用, 不会创建, 每帧Tick()时标记为使用过
     std::unique_ptr<RenderGraphResourcePool> ResourcePool;
 
+    // 为临时资源在纹理堆和Default Buffer堆中预留的区间
+    UINT64 TransientRangeOffsets[static_cast<UINT32>(ERenderGraphResourceKind::Num)] = { INVALID_SIZE_64, INVALID_SIZE_64 };
+    UINT64 TransientRangeSizes[static_cast<UINT32>(ERenderGraphResourceKind::Num)] = {};
+
     TaskFlow ExecuteFlow;
-    TaskExecutor Executor;
+    TaskExecutor Executor{ ThreadPoolDesc{ .Name = "RenderGraphWorker" } };
     
     std::unique_ptr<D3D12Fence> Fence;
     UINT64 FenceValue = 0;
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "RenderGraphCore.h"
+
+/*
+ * RenderGraphCore执行时调用的后端接口. D3D12后端创建真实的资源并录制命令,
+ * RenderGraphNullBackend只把调用记录下来.
+ * 资源和Pass都用它们在RenderGraphCore中的下标标识.
+ */
+
+class RenderGraphBackendDevice
+{
+public:
+    virtual ~RenderGraphBackendDevice() = default;
+
+    // 每次执行开始时为每种需要的临时资源创建一个堆
+    virtual void CreateTransientHeap(ERenderGraphResourceKind InKind, uint64_t InSize) = 0;
+
+    // InHeapOffset为资源在对应种类临时堆中的偏移, 为INVALID_SIZE_64时单独分配
+    virtual void CreateResource(uint32_t InResourceIndex, const RenderGraphResourceDesc& InDesc, uint64_t InHeapOffset) = 0;
+    virtual void ReleaseResource(uint32_t InResourceIndex) = 0;
+};
+
+class RenderGraphCommandRecorder
+{
+public:
+    virtual ~RenderGraphCommandRecorder() = default;
+
+    virtual void BeginPass(uint32_t InPassIndex, const RenderGraphPassNode& InPass) = 0;
+    virtual void EndPass(uint32_t InPassIndex) = 0;
+
+    // 屏障先缓存, FlushBarriers()时作为一批提交. 每个Pass开始和结束时各Flush一次
+    virtual void TransitionBarrier(const RenderGraphTransitionBarrier& InBarrier) = 0;
+    virtual void AliasingBarrier(uint32_t InResourceIndexBefore, uint32_t InResourceIndexAfter) = 0;
+    virtual void FlushBarriers() = 0;
+};
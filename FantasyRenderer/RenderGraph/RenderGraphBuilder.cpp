@@ -4,15 +4,13 @@
 
 RenderGraphBuffer* RenderGraphBuilder::ImportBuffer(const char* InName, D3D12Buffer* InBuffer, bool NeedDescriptor) const
 {
-    RenderGraphBuffer* Iterator = Graph->ResourcePool->Buffers.FindFirstIf(
-        [&InName](const RenderGraphBuffer* InBuffer) { return InName == InBuffer->Name; }
-    );
+    RenderGraphBuffer* Iterator = Graph->ResourcePool->FindBuffer(InName);
 
     if (Iterator == nullptr)
     {
         if (NeedDescriptor) InBuffer->CreateOwnCPUDescriptor();
         
-        RenderGraphBuffer* Buffer = Graph->ResourcePool->Buffers.PushBack(InName, InBuffer);
+        RenderGraphBuffer* Buffer = Graph->ResourcePool->AddBuffer(InName, InBuffer);
         Buffer->Buffer->SetName(StringToWString(InName).c_str());
         Pass->ResourceStateMap[Buffer] = Buffer->Buffer->GetDesc()->State;
         Pass->ReadBuffers.push_back(Buffer);
@@ -23,15 +21,13 @@ RenderGraphBuffer* RenderGraphBuilder::ImportBuffer(const char* InName, D3D12Buf
 
 RenderGraphTexture* RenderGraphBuilder::ImportTexture(const char* InName, D3D12Texture* InTexture, bool NeedDescriptor) const
 {
-    RenderGraphTexture* Iterator = Graph->ResourcePool->Textures.FindFirstIf(
-        [&InName](const RenderGraphTexture* InTexture) { return InName == InTexture->Name; }
-    );
+    RenderGraphTexture* Iterator = Graph->ResourcePool->FindTexture(InName);
 
     if (Iterator == nullptr)
     {
         if (NeedDescriptor) InTexture->CreateOwnCPUDescriptor();
 
-        RenderGraphTexture* Texture = Graph->ResourcePool->Textures.PushBack(InName, InTexture);
+        RenderGraphTexture* Texture = Graph->ResourcePool->AddTexture(InName, InTexture);
         Texture->Texture->SetName(StringToWString(InName).c_str());
         Pass->ResourceStateMap[Texture] = Texture->Texture->GetDesc()->State;
         Pass->ReadTextures.push_back(Texture);
@@ -43,9 +39,7 @@ RenderGraphTexture* RenderGraphBuilder::ImportTexture(const char* InName, D3D12T
 
 RenderGraphBuffer* RenderGraphBuilder::TransitionReadBuffer(const char* InName, ED3D12ResourceState InState) const
 {
-    RenderGraphBuffer* Buffer = Graph->ResourcePool->Buffers.FindFirstIf(
-        [&InName](const RenderGraphBuffer* InBuffer) { return InName == InBuffer->Name; }
-    );
+    RenderGraphBuffer* Buffer = Graph->ResourcePool->FindBuffer(InName);
     
     ThrowIfFalse(Buffer != nullptr, "No such buffer name.");
 
@@ -57,9 +51,7 @@ RenderGraphBuffer* RenderGraphBuilder::TransitionReadBuffer(const char* InName,
 
 RenderGraphTexture* RenderGraphBuilder::TransitionReadTexture(const char* InName, ED3D12ResourceState InState) const
 {
-    RenderGraphTexture* Texture = Graph->ResourcePool->Textures.FindFirstIf(
-        [&InName](const RenderGraphTexture* InTexture) { return InName == InTexture->Name; }
-    );
+    RenderGraphTexture* Texture = Graph->ResourcePool->FindTexture(InName);
     
     ThrowIfFalse(Texture != nullptr, "No such Texture name.");
 
@@ -71,9 +63,7 @@ RenderGraphTexture* RenderGraphBuilder::TransitionReadTexture(const char* InName
 
 RenderGraphBuffer* RenderGraphBuilder::TransitionWriteBuffer(const char* InName, ED3D12ResourceState InState) const
 {
-    RenderGraphBuffer* Buffer = Graph->ResourcePool->Buffers.FindFirstIf(
-        [&InName](const RenderGraphBuffer* InBuffer) { return InName == InBuffer->Name; }
-    );
+    RenderGraphBuffer* Buffer = Graph->ResourcePool->FindBuffer(InName);
     
     ThrowIfFalse(Buffer != nullptr, "No such buffer name.");
 
@@ -85,9 +75,7 @@ RenderGraphBuffer* RenderGraphBuilder::TransitionWriteBuffer(const char* InName,
 
 RenderGraphTexture* RenderGraphBuilder::TransitionWriteTexture(const char* InName, ED3D12ResourceState InState) const
 {
-    RenderGraphTexture* Texture = Graph->ResourcePool->Textures.FindFirstIf(
-        [&InName](const RenderGraphTexture* InTexture) { return InName == InTexture->Name; }
-    );
+    RenderGraphTexture* Texture = Graph->ResourcePool->FindTexture(InName);
     
     ThrowIfFalse(Texture != nullptr, "No such Texture name.");
 
@@ -100,7 +88,7 @@ RenderGraphTexture* RenderGraphBuilder::TransitionWriteTexture(const char* InNam
 RenderGraphBuffer* RenderGraphBuilder::DeclareReadBuffer(const char* InName, const D3D12BufferDesc& InDesc, void* InData/* = nullptr*/) const
 {
     D3D12BufferDesc* Desc = new D3D12BufferDesc(InDesc);
-    RenderGraphBuffer* Buffer = Graph->ResourcePool->Buffers.PushBack(InName, Desc, InData);
+    RenderGraphBuffer* Buffer = Graph->ResourcePool->AddBuffer(InName, Desc, InData);
     Pass->ResourceStateMap[Buffer] = Desc->State;
     Pass->ReadBuffers.push_back(Buffer);
     return Buffer;
@@ -109,7 +97,7 @@ RenderGraphBuffer* RenderGraphBuilder::DeclareReadBuffer(const char* InName, con
 RenderGraphBuffer* RenderGraphBuilder::DeclareWriteBuffer(const char* InName, const D3D12BufferDesc& InDesc) const
 {
     D3D12BufferDesc* Desc = new D3D12BufferDesc(InDesc);
-    RenderGraphBuffer* Buffer = Graph->ResourcePool->Buffers.PushBack(InName, Desc);
+    RenderGraphBuffer* Buffer = Graph->ResourcePool->AddBuffer(InName, Desc);
     Pass->ResourceStateMap[Buffer] = Desc->State;
     Pass->WriteBuffers.push_back(Buffer);
     return Buffer;
@@ -118,7 +106,7 @@ RenderGraphBuffer* RenderGraphBuilder::DeclareWriteBuffer(const char* InName, co
 RenderGraphTexture* RenderGraphBuilder::DeclareReadTexture(const char* InName, const D3D12TextureDesc& InDesc, void* InData/* = nullptr*/) const
 {
     D3D12TextureDesc* Desc = new D3D12TextureDesc(InDesc);
-    RenderGraphTexture* Texture = Graph->ResourcePool->Textures.PushBack(InName, Desc, InData);
+    RenderGraphTexture* Texture = Graph->ResourcePool->AddTexture(InName, Desc, InData);
     Pass->ResourceStateMap[Texture] = Desc->State;
     Pass->ReadTextures.push_back(Texture);
     return Texture;
@@ -127,7 +115,7 @@ RenderGraphTexture* RenderGraphBuilder::DeclareReadTexture(const char* InName, c
 RenderGraphTexture* RenderGraphBuilder::DeclareWriteTexture(const char* InName, const D3D12TextureDesc& InDesc) const
 {
     D3D12TextureDesc* Desc = new D3D12TextureDesc(InDesc);
-    RenderGraphTexture* Texture = Graph->ResourcePool->Textures.PushBack(InName, Desc);
+    RenderGraphTexture* Texture = Graph->ResourcePool->AddTexture(InName, Desc);
     Pass->ResourceStateMap[Texture] = Desc->State;
     Pass->WriteTextures.push_back(Texture);
     return Texture;
@@ -28,6 +28,9 @@ public:
     RenderGraphTexture* DeclareReadTexture(const char* InName, const D3D12TextureDesc& InDesc, void* InData = nullptr) const;
     RenderGraphTexture* DeclareWriteTexture(const char* InName, const D3D12TextureDesc& InDesc) const;
 
+    // 标记为图的输出, 写它的Pass及其依赖不会在编译时被剔除
+    void MarkOutput(RenderGraphResource* InResource) const { InResource->bOutput = true; }
+
     void AllocateBuffer(RenderGraphBuffer* InBuffer, D3D12CommandList* InCmdList) const;
     void AllocateTexture(RenderGraphTexture* InTexture, D3D12CommandList* InCmdList) const;
 
@@ -0,0 +1,575 @@
+﻿#include "RenderGraphCore.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "RenderGraphBackend.h"
+
+// 不依赖Exception.h(需要windows.h), 核心可以在没有Windows头文件的平台上编译和测试
+static void ThrowIfFalse(bool bInCondition, const char* InReason)
+{
+    if (!bInCondition) throw std::runtime_error(InReason);
+}
+
+
+uint32_t RenderGraphCore::AddResource(const RenderGraphResourceDesc& InDesc)
+{
+    Resources.push_back(InDesc);
+    bCompiled = false;
+    return static_cast<uint32_t>(Resources.size() - 1);
+}
+
+uint32_t RenderGraphCore::AddPass(const std::string& InName, ERenderGraphPassType InType, RenderGraphExecuteFunction InExecuteFunc/* = nullptr*/)
+{
+    RenderGraphPassNode& Pass = Passes.emplace_back();
+    Pass.Name = InName;
+    Pass.Type = InType;
+    Pass.ExecuteFunc = std::move(InExecuteFunc);
+    bCompiled = false;
+    return static_cast<uint32_t>(Passes.size() - 1);
+}
+
+void RenderGraphCore::ReadResource(uint32_t InPassIndex, uint32_t InResourceIndex, ERenderGraphResourceState InState)
+{
+    AddAccess(InPassIndex, InResourceIndex, ERenderGraphAccess::Read, InState);
+}
+
+void RenderGraphCore::WriteResource(uint32_t InPassIndex, uint32_t InResourceIndex, ERenderGraphResourceState InState)
+{
+    AddAccess(InPassIndex, InResourceIndex, ERenderGraphAccess::Write, InState);
+}
+
+void RenderGraphCore::MarkOutput(uint32_t InResourceIndex)
+{
+    ThrowIfFalse(InResourceIndex < Resources.size(), "Invalid render graph resource index.");
+    Resources[InResourceIndex].bOutput = true;
+    bCompiled = false;
+}
+
+void RenderGraphCore::MarkSideEffect(uint32_t InPassIndex)
+{
+    ThrowIfFalse(InPassIndex < Passes.size(), "Invalid render graph pass index.");
+    Passes[InPassIndex].bHasSideEffects = true;
+    bCompiled = false;
+}
+
+void RenderGraphCore::AddAccess(uint32_t InPassIndex, uint32_t InResourceIndex, ERenderGraphAccess InAccess, ERenderGraphResourceState InState)
+{
+    ThrowIfFalse(InPassIndex < Passes.size(), "Invalid render graph pass index.");
+    ThrowIfFalse(InResourceIndex < Resources.size(), "Invalid render graph resource index.");
+
+    Passes[InPassIndex].Accesses.push_back(RenderGraphResourceAccess{ InResourceIndex, InAccess, InState });
+    bCompiled = false;
+}
+
+void RenderGraphCore::Clear()
+{
+    Passes.clear();
+    Resources.clear();
+
+    bCompiled = false;
+    PassCulled.clear();
+    ExecutionOrder.clear();
+    PassSuccessors.clear();
+    RedundantEdgeNum = 0;
+    ResourceFirstPass.clear();
+    ResourceLastPass.clear();
+    PassReleasedResources.clear();
+    ResourceHeapOffsets.clear();
+    for (uint64_t& HeapSize : TransientHeapSizes) HeapSize = 0;
+    for (uint64_t& HeapAlignment : TransientHeapAlignments) HeapAlignment = 0;
+    PassAliasingBarriers.clear();
+    PassBeginBarriers.clear();
+    PassEndBarriers.clear();
+}
+
+void RenderGraphCore::Compile()
+{
+    CullPasses();
+
+    // 剩下的Pass按添加的顺序执行, 依赖总是从前面的Pass指向后面的Pass
+    ExecutionOrder.clear();
+    for (uint32_t ix = 0; ix < Passes.size(); ++ix)
+    {
+        if (!PassCulled[ix]) ExecutionOrder.push_back(ix);
+    }
+
+    BuildDependencies();
+    ComputeResourceLifetimes();
+    PlanTransientMemory();
+    PlanBarriers();
+    ReduceDependencies();     // 包括共用内存带来的依赖
+
+    bCompiled = true;
+}
+
+void RenderGraphCore::CullPasses()
+{
+    // 引用计数: Pass为它写的资源数, 资源为读它的Pass数, 输出和有副作用的Pass各多一个引用.
+    // 从没有引用的资源往回走, 写它的Pass引用减为0时被剔除, 它读的资源的引用随之减少
+    std::vector<uint32_t> PassRefCounts(Passes.size(), 0);
+    std::vector<uint32_t> ResourceRefCounts(Resources.size(), 0);
+    std::vector<std::vector<uint32_t>> ResourceWriters(Resources.size());
+    std::vector<std::vector<uint32_t>> PassReadResources(Passes.size());     // 不包括同一Pass也写的资源, 读改写不会让Pass自己保持存活
+
+    std::vector<uint32_t> LastWriterPass(Resources.size(), RENDER_GRAPH_INVALID_INDEX);
+    std::vector<uint32_t> LastReaderPass(Resources.size(), RENDER_GRAPH_INVALID_INDEX);
+    for (uint32_t PassIndex = 0; PassIndex < Passes.size(); ++PassIndex)
+    {
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            if (Access.Access != ERenderGraphAccess::Write || LastWriterPass[Access.ResourceIndex] == PassIndex) continue;
+
+            LastWriterPass[Access.ResourceIndex] = PassIndex;
+            ResourceWriters[Access.ResourceIndex].push_back(PassIndex);
+            PassRefCounts[PassIndex]++;
+        }
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            if (Access.Access != ERenderGraphAccess::Read || LastWriterPass[Access.ResourceIndex] == PassIndex || LastReaderPass[Access.ResourceIndex] == PassIndex) continue;
+
+            LastReaderPass[Access.ResourceIndex] = PassIndex;
+            PassReadResources[PassIndex].push_back(Access.ResourceIndex);
+            ResourceRefCounts[Access.ResourceIndex]++;
+        }
+        if (Passes[PassIndex].bHasSideEffects) PassRefCounts[PassIndex]++;
+    }
+
+    std::vector<uint32_t> UnreferencedResources;
+    for (uint32_t ix = 0; ix < Resources.size(); ++ix)
+    {
+        if (Resources[ix].bOutput) ResourceRefCounts[ix]++;
+        if (ResourceRefCounts[ix] == 0) UnreferencedResources.push_back(ix);
+    }
+
+    PassCulled.assign(Passes.size(), false);
+    auto CullPass = [&](uint32_t InPassIndex)
+    {
+        PassCulled[InPassIndex] = true;
+        for (const uint32_t ResourceIndex : PassReadResources[InPassIndex])
+        {
+            if (--ResourceRefCounts[ResourceIndex] == 0) UnreferencedResources.push_back(ResourceIndex);
+        }
+    };
+
+    // 既不写资源也没有副作用的Pass
+    for (uint32_t ix = 0; ix < Passes.size(); ++ix)
+    {
+        if (PassRefCounts[ix] == 0) CullPass(ix);
+    }
+
+    while (!UnreferencedResources.empty())
+    {
+        const uint32_t ResourceIndex = UnreferencedResources.back();
+        UnreferencedResources.pop_back();
+
+        for (const uint32_t WriterIndex : ResourceWriters[ResourceIndex])
+        {
+            if (--PassRefCounts[WriterIndex] == 0) CullPass(WriterIndex);
+        }
+    }
+}
+
+void RenderGraphCore::BuildDependencies()
+{
+    PassSuccessors.assign(Passes.size(), {});
+
+    // 每个资源只记录当前版本: 最后写它的Pass和之后读它的Pass. 每次访问只和当前版本连边, 总共只遍历一遍所有访问
+    std::vector<uint32_t> LastWriterPass(Resources.size(), RENDER_GRAPH_INVALID_INDEX);
+    std::vector<std::vector<uint32_t>> CurrentReaders(Resources.size());
+    std::vector<uint32_t> LastSuccessorPass(Passes.size(), RENDER_GRAPH_INVALID_INDEX);
+
+    for (const uint32_t PassIndex : ExecutionOrder)
+    {
+        // 同一对Pass只连一条边
+        auto AddEdge = [this, PassIndex, &LastSuccessorPass](uint32_t InPredecessor)
+        {
+            if (InPredecessor == RENDER_GRAPH_INVALID_INDEX || InPredecessor == PassIndex || LastSuccessorPass[InPredecessor] == PassIndex) return;
+
+            LastSuccessorPass[InPredecessor] = PassIndex;
+            PassSuccessors[InPredecessor].push_back(PassIndex);
+        };
+
+        // 读后读不需要依赖
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            if (Access.Access != ERenderGraphAccess::Read) continue;
+
+            AddEdge(LastWriterPass[Access.ResourceIndex]);      // 写后读
+            std::vector<uint32_t>& Readers = CurrentReaders[Access.ResourceIndex];
+            if (Readers.empty() || Readers.back() != PassIndex) Readers.push_back(PassIndex);
+        }
+
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            if (Access.Access != ERenderGraphAccess::Write) continue;
+
+            // 读后写: 等当前版本的读者都结束. 没有读者时为写后写, 有读者时它们已经依赖于上一个写者
+            std::vector<uint32_t>& Readers = CurrentReaders[Access.ResourceIndex];
+            bool bHasOtherReader = false;
+            for (const uint32_t ReaderIndex : Readers)
+            {
+                if (ReaderIndex == PassIndex) continue;
+
+                AddEdge(ReaderIndex);
+                bHasOtherReader = true;
+            }
+            if (!bHasOtherReader) AddEdge(LastWriterPass[Access.ResourceIndex]);
+
+            Readers.clear();
+            LastWriterPass[Access.ResourceIndex] = PassIndex;
+        }
+    }
+}
+
+void RenderGraphCore::ReduceDependencies()
+{
+    // 传递规约: A->C在已有A->B->...->C时是多余的. 逆序求出每个Pass能到达的Pass集合(位图),
+    // 再按执行顺序从近到远检查每个后继, 已经能经由更近的后继到达的就去掉
+    const uint32_t PassNum = static_cast<uint32_t>(ExecutionOrder.size());
+    const uint32_t WordNum = (PassNum + 63) / 64;
+
+    std::vector<uint32_t> PassOrders(Passes.size());
+    for (uint32_t ix = 0; ix < PassNum; ++ix) PassOrders[ExecutionOrder[ix]] = ix;
+
+    std::vector<uint64_t> Reachable(static_cast<size_t>(PassNum) * WordNum, 0);
+    RedundantEdgeNum = 0;
+
+    for (uint32_t Order = PassNum; Order-- > 0;)
+    {
+        std::vector<uint32_t>& Successors = PassSuccessors[ExecutionOrder[Order]];
+        std::ranges::sort(Successors, [&PassOrders](uint32_t InPassA, uint32_t InPassB) { return PassOrders[InPassA] < PassOrders[InPassB]; });
+
+        uint64_t* PassReachable = Reachable.data() + static_cast<size_t>(Order) * WordNum;
+        uint32_t KeptNum = 0;
+        for (const uint32_t SuccessorIndex : Successors)
+        {
+            const uint32_t SuccessorOrder = PassOrders[SuccessorIndex];
+            if (PassReachable[SuccessorOrder / 64] & (1ull << (SuccessorOrder % 64)))
+            {
+                RedundantEdgeNum++;
+                continue;
+            }
+
+            Successors[KeptNum++] = SuccessorIndex;
+            PassReachable[SuccessorOrder / 64] |= 1ull << (SuccessorOrder % 64);
+
+            const uint64_t* SuccessorReachable = Reachable.data() + static_cast<size_t>(SuccessorOrder) * WordNum;
+            for (uint32_t ix = SuccessorOrder / 64; ix < WordNum; ++ix) PassReachable[ix] |= SuccessorReachable[ix];
+        }
+        Successors.resize(KeptNum);
+    }
+}
+
+void RenderGraphCore::ComputeResourceLifetimes()
+{
+    ResourceFirstPass.assign(Resources.size(), RENDER_GRAPH_INVALID_INDEX);
+    ResourceLastPass.assign(Resources.size(), RENDER_GRAPH_INVALID_INDEX);
+    PassReleasedResources.assign(Passes.size(), {});
+
+    for (const uint32_t PassIndex : ExecutionOrder)
+    {
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            if (ResourceFirstPass[Access.ResourceIndex] == RENDER_GRAPH_INVALID_INDEX) ResourceFirstPass[Access.ResourceIndex] = PassIndex;
+            ResourceLastPass[Access.ResourceIndex] = PassIndex;
+        }
+    }
+
+    for (uint32_t ix = 0; ix < Resources.size(); ++ix)
+    {
+        if (!Resources[ix].bImported && ResourceLastPass[ix] != RENDER_GRAPH_INVALID_INDEX)
+        {
+            PassReleasedResources[ResourceLastPass[ix]].push_back(ix);
+        }
+    }
+}
+
+bool RenderGraphCore::IsTransientResource(uint32_t InResourceIndex) const
+{
+    return !Resources[InResourceIndex].bImported && ResourceFirstPass[InResourceIndex] != RENDER_GRAPH_INVALID_INDEX;
+}
+
+void RenderGraphCore::PlanTransientMemory()
+{
+    ResourceHeapOffsets.assign(Resources.size(), INVALID_SIZE_64);
+    PassAliasingBarriers.assign(Passes.size(), {});
+
+    // 生命周期用Pass在ExecutionOrder中的位置表示, 两个资源的生命周期不重叠时可以共用内存
+    std::vector<uint32_t> PassOrders(Passes.size());
+    for (uint32_t ix = 0; ix < ExecutionOrder.size(); ++ix) PassOrders[ExecutionOrder[ix]] = ix;
+
+    auto IsLifetimeOverlapped = [this, &PassOrders](uint32_t InResourceA, uint32_t InResourceB)
+    {
+        return PassOrders[ResourceFirstPass[InResourceA]] <= PassOrders[ResourceLastPass[InResourceB]] &&
+               PassOrders[ResourceFirstPass[InResourceB]] <= PassOrders[ResourceLastPass[InResourceA]];
+    };
+    auto IsMemoryOverlapped = [this](uint32_t InResourceA, uint32_t InResourceB)
+    {
+        return ResourceHeapOffsets[InResourceA] < ResourceHeapOffsets[InResourceB] + Resources[InResourceB].Size &&
+               ResourceHeapOffsets[InResourceB] < ResourceHeapOffsets[InResourceA] + Resources[InResourceA].Size;
+    };
+
+    std::vector<std::vector<uint32_t>> ResourceUsers(Resources.size());
+    for (const uint32_t PassIndex : ExecutionOrder)
+    {
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            std::vector<uint32_t>& Users = ResourceUsers[Access.ResourceIndex];
+            if (Users.empty() || Users.back() != PassIndex) Users.push_back(PassIndex);
+        }
+    }
+
+    for (uint32_t KindIndex = 0; KindIndex < static_cast<uint32_t>(ERenderGraphResourceKind::Num); ++KindIndex)
+    {
+        std::vector<uint32_t> TransientResources;
+        for (uint32_t ix = 0; ix < Resources.size(); ++ix)
+        {
+            if (IsTransientResource(ix) && Resources[ix].Size > 0 && static_cast<uint32_t>(Resources[ix].Kind) == KindIndex)
+            {
+                TransientResources.push_back(ix);
+            }
+        }
+
+        // 先放大的资源, 小的资源更容易填进剩下的空隙
+        std::ranges::sort(
+            TransientResources,
+            [this, &PassOrders](uint32_t InResourceA, uint32_t InResourceB)
+            {
+                if (Resources[InResourceA].Size != Resources[InResourceB].Size) return Resources[InResourceA].Size > Resources[InResourceB].Size;
+                if (ResourceFirstPass[InResourceA] != ResourceFirstPass[InResourceB]) return PassOrders[ResourceFirstPass[InResourceA]] < PassOrders[ResourceFirstPass[InResourceB]];
+                return InResourceA < InResourceB;
+            }
+        );
+
+        uint64_t HeapSize = 0;
+        uint64_t HeapAlignment = 0;
+        std::vector<uint32_t> PlacedResources;
+        std::vector<std::pair<uint64_t, uint64_t>> OccupiedRanges;
+        for (const uint32_t ResourceIndex : TransientResources)
+        {
+            const RenderGraphResourceDesc& Desc = Resources[ResourceIndex];
+
+            OccupiedRanges.clear();
+            for (const uint32_t PlacedIndex : PlacedResources)
+            {
+                if (IsLifetimeOverlapped(ResourceIndex, PlacedIndex))
+                {
+                    OccupiedRanges.emplace_back(ResourceHeapOffsets[PlacedIndex], ResourceHeapOffsets[PlacedIndex] + Resources[PlacedIndex].Size);
+                }
+            }
+            std::ranges::sort(OccupiedRanges);
+
+            // Best-fit: 在生命周期重叠的资源之间找能放下它的最小空隙, 都放不下时放在它们之后
+            uint64_t BestOffset = INVALID_SIZE_64;
+            uint64_t BestGapSize = INVALID_SIZE_64;
+            uint64_t GapBegin = 0;
+            for (const auto& [RangeBegin, RangeEnd] : OccupiedRanges)
+            {
+                const uint64_t Offset = Align(GapBegin, Desc.Alignment);
+                if (Offset + Desc.Size <= RangeBegin && RangeBegin - GapBegin < BestGapSize)
+                {
+                    BestOffset = Offset;
+                    BestGapSize = RangeBegin - GapBegin;
+                }
+                if (RangeEnd > GapBegin) GapBegin = RangeEnd;
+            }
+            if (BestOffset == INVALID_SIZE_64) BestOffset = Align(GapBegin, Desc.Alignment);
+
+            ResourceHeapOffsets[ResourceIndex] = BestOffset;
+            if (BestOffset + Desc.Size > HeapSize) HeapSize = BestOffset + Desc.Size;
+            if (Desc.Alignment > HeapAlignment) HeapAlignment = Desc.Alignment;
+            PlacedResources.push_back(ResourceIndex);
+        }
+        TransientHeapSizes[KindIndex] = HeapSize;
+        TransientHeapAlignments[KindIndex] = HeapAlignment;
+
+        // 与其他资源共用内存时, 在首次使用前加别名屏障. 后端可能跨帧保留放置的资源, 所以同一块内存上第一个使用的资源也需要;
+        // 本帧之前只有一个资源用过这块内存时指明它
+        for (const uint32_t ResourceIndex : PlacedResources)
+        {
+            bool bOverlapped = false;
+            uint32_t PrevResource = RENDER_GRAPH_INVALID_INDEX;
+            uint32_t PrevResourceNum = 0;
+            for (const uint32_t OtherIndex : PlacedResources)
+            {
+                if (OtherIndex == ResourceIndex || !IsMemoryOverlapped(ResourceIndex, OtherIndex)) continue;
+
+                bOverlapped = true;
+                if (PassOrders[ResourceLastPass[OtherIndex]] < PassOrders[ResourceFirstPass[ResourceIndex]])
+                {
+                    PrevResource = OtherIndex;
+                    PrevResourceNum++;
+
+                    // 没有依赖的Pass可能并行执行, 之前使用这块内存的Pass都要在它之前完成
+                    const uint32_t FirstPass = ResourceFirstPass[ResourceIndex];
+                    for (const uint32_t UserIndex : ResourceUsers[OtherIndex])
+                    {
+                        std::vector<uint32_t>& Successors = PassSuccessors[UserIndex];
+                        if (std::ranges::find(Successors, FirstPass) == Successors.end()) Successors.push_back(FirstPass);
+                    }
+                }
+            }
+            if (!bOverlapped) continue;
+
+            PassAliasingBarriers[ResourceFirstPass[ResourceIndex]].push_back(
+                RenderGraphAliasingBarrier{ PrevResourceNum == 1 ? PrevResource : RENDER_GRAPH_INVALID_INDEX, ResourceIndex }
+            );
+        }
+    }
+}
+
+void RenderGraphCore::PlanBarriers()
+{
+    PassBeginBarriers.assign(Passes.size(), {});
+    PassEndBarriers.assign(Passes.size(), {});
+
+    std::vector<uint32_t> PassOrders(Passes.size());
+    for (uint32_t ix = 0; ix < ExecutionOrder.size(); ++ix) PassOrders[ExecutionOrder[ix]] = ix;
+
+    // 每个资源按执行顺序分成若干段, 段内状态不变: 写资源的Pass单独成段, 相邻的只读Pass合并成一段, 状态取它们的组合
+    struct StateSegment
+    {
+        uint32_t FirstPass;
+        uint32_t LastPass;
+        RenderGraphResourceStates States;
+        bool bReadOnly;
+    };
+    std::vector<std::vector<StateSegment>> ResourceSegments(Resources.size());
+
+    std::vector<RenderGraphResourceStates> PassStates(Resources.size(), 0);
+    std::vector<bool> PassWritten(Resources.size(), false);
+    std::vector<uint32_t> UsedResources;
+    for (const uint32_t PassIndex : ExecutionOrder)
+    {
+        // 同一Pass多次访问一个资源时, 有写则取最后一次写的状态, 否则合并所有读的状态
+        UsedResources.clear();
+        for (const RenderGraphResourceAccess& Access : Passes[PassIndex].Accesses)
+        {
+            const uint32_t ResourceIndex = Access.ResourceIndex;
+            if (PassStates[ResourceIndex] == 0) UsedResources.push_back(ResourceIndex);
+
+            if (Access.Access == ERenderGraphAccess::Write || !IsReadOnlyState(Access.State))
+            {
+                PassStates[ResourceIndex] = ToResourceStates(Access.State);
+                PassWritten[ResourceIndex] = true;
+            }
+            else if (!PassWritten[ResourceIndex])
+            {
+                PassStates[ResourceIndex] |= ToResourceStates(Access.State);
+            }
+        }
+
+        for (const uint32_t ResourceIndex : UsedResources)
+        {
+            const bool bReadOnly = !PassWritten[ResourceIndex];
+            std::vector<StateSegment>& Segments = ResourceSegments[ResourceIndex];
+            if (bReadOnly && !Segments.empty() && Segments.back().bReadOnly)
+            {
+                Segments.back().LastPass = PassIndex;
+                Segments.back().States |= PassStates[ResourceIndex];
+            }
+            else
+            {
+                Segments.push_back(StateSegment{ PassIndex, PassIndex, PassStates[ResourceIndex], bReadOnly });
+            }
+            PassStates[ResourceIndex] = 0;
+            PassWritten[ResourceIndex] = false;
+        }
+    }
+
+    for (uint32_t ResourceIndex = 0; ResourceIndex < Resources.size(); ++ResourceIndex)
+    {
+        const std::vector<StateSegment>& Segments = ResourceSegments[ResourceIndex];
+        if (Segments.empty()) continue;
+
+        // 临时资源直接以一帧结束时的状态创建, 状态首尾相接, 下一帧开始时不需要转换回来
+        RenderGraphResourceDesc& Desc = Resources[ResourceIndex];
+        const RenderGraphResourceStates FinalStates = Segments.back().States;
+        if (IsTransientResource(ResourceIndex) && std::has_single_bit(FinalStates))
+        {
+            Desc.InitialState = static_cast<ERenderGraphResourceState>(std::countr_zero(FinalStates));
+        }
+
+        const RenderGraphResourceStates InitialStates = ToResourceStates(Desc.InitialState);
+        RenderGraphResourceStates CurrentStates = InitialStates;
+        uint32_t LastPass = RENDER_GRAPH_INVALID_INDEX;
+        for (const StateSegment& Segment : Segments)
+        {
+            if (Segment.States != CurrentStates)
+            {
+                // 中间隔着不使用该资源的Pass时拆成开始和结束两半, 让转换和中间的Pass重叠
+                if (LastPass != RENDER_GRAPH_INVALID_INDEX && PassOrders[Segment.FirstPass] > PassOrders[LastPass] + 1)
+                {
+                    PassEndBarriers[LastPass].push_back(RenderGraphTransitionBarrier{ ResourceIndex, CurrentStates, Segment.States, ERenderGraphBarrierSplit::Begin });
+                    PassBeginBarriers[Segment.FirstPass].push_back(RenderGraphTransitionBarrier{ ResourceIndex, CurrentStates, Segment.States, ERenderGraphBarrierSplit::End });
+                }
+                else
+                {
+                    PassBeginBarriers[Segment.FirstPass].push_back(RenderGraphTransitionBarrier{ ResourceIndex, CurrentStates, Segment.States });
+                }
+            }
+            CurrentStates = Segment.States;
+            LastPass = Segment.LastPass;
+        }
+
+        // 导入的资源和结束时是组合状态的临时资源, 在最后使用它的Pass结束时转换回初始状态
+        if (CurrentStates != InitialStates)
+        {
+            PassEndBarriers[LastPass].push_back(RenderGraphTransitionBarrier{ ResourceIndex, CurrentStates, InitialStates });
+        }
+    }
+}
+
+void RenderGraphCore::Execute(RenderGraphBackendDevice* InDevice, RenderGraphCommandRecorder* InRecorder) const
+{
+    ThrowIfFalse(bCompiled, "Render graph must be compiled before execute.");
+    ThrowIfFalse(InDevice != nullptr && InRecorder != nullptr, "Try to use nullptr RenderGraphBackendDevice | RenderGraphCommandRecorder.");
+
+    for (uint32_t ix = 0; ix < static_cast<uint32_t>(ERenderGraphResourceKind::Num); ++ix)
+    {
+        if (TransientHeapSizes[ix] > 0) InDevice->CreateTransientHeap(static_cast<ERenderGraphResourceKind>(ix), TransientHeapSizes[ix]);
+    }
+
+    std::vector<bool> ResourcesCreated(Resources.size(), false);
+
+    for (const uint32_t PassIndex : ExecutionOrder)
+    {
+        const RenderGraphPassNode& Pass = Passes[PassIndex];
+        InRecorder->BeginPass(PassIndex, Pass);
+
+        for (const RenderGraphResourceAccess& Access : Pass.Accesses)
+        {
+            const uint32_t ResourceIndex = Access.ResourceIndex;
+            if (IsTransientResource(ResourceIndex) && !ResourcesCreated[ResourceIndex])
+            {
+                ResourcesCreated[ResourceIndex] = true;
+                InDevice->CreateResource(ResourceIndex, Resources[ResourceIndex], ResourceHeapOffsets[ResourceIndex]);
+            }
+        }
+        for (const RenderGraphAliasingBarrier& Barrier : PassAliasingBarriers[PassIndex])
+        {
+            InRecorder->AliasingBarrier(Barrier.ResourceBefore, Barrier.ResourceAfter);
+        }
+        for (const RenderGraphTransitionBarrier& Barrier : PassBeginBarriers[PassIndex])
+        {
+            InRecorder->TransitionBarrier(Barrier);
+        }
+        InRecorder->FlushBarriers();
+
+        if (Pass.ExecuteFunc) Pass.ExecuteFunc(InRecorder);
+
+        for (const RenderGraphTransitionBarrier& Barrier : PassEndBarriers[PassIndex])
+        {
+            InRecorder->TransitionBarrier(Barrier);
+        }
+        InRecorder->FlushBarriers();
+        InRecorder->EndPass(PassIndex);
+
+        for (const uint32_t ResourceIndex : PassReleasedResources[PassIndex])
+        {
+            InDevice->ReleaseResource(ResourceIndex);
+        }
+    }
+}
@@ -0,0 +1,231 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../Utility/AlignUtil.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 与图形API无关的RenderGraph核心: 只描述Pass对资源的读写, 负责剔除, 依赖, 资源生命周期等编译逻辑,
+ * 执行时通过RenderGraphBackendDevice和RenderGraphCommandRecorder把资源创建和屏障交给后端(见RenderGraphBackend.h).
+ * D3D12的RenderGraph在Compile()时把自己的Pass转成这里的描述, 再用编译结果建立TaskFlow, 放置临时资源;
+ * 没有GPU时可以直接用RenderGraphNullBackend跑完整的编译和执行流程, 用于测试和性能分析.
+ */
+
+enum class ERenderGraphPassType
+{
+    None,
+    Graphics,
+    Compute,
+    Copy
+};
+
+// Buffer和Texture放在不同的堆中, 临时资源的内存按种类分别规划
+enum class ERenderGraphResourceKind
+{
+    Buffer,
+    Texture,
+
+    Num
+};
+
+// 与ED3D12ResourceState一一对应
+enum class ERenderGraphResourceState : uint32_t
+{
+    Common,
+    CopySrc,
+    CopyDst,
+    DepthRead,
+    DepthWrite,
+    GenericRead,
+    PixelShader,
+    NonPixelShader,
+    AllShader,
+    VertexBuffer,
+    ConstantBuffer,
+    IndexBuffer,
+    Present,
+    RenderTarget,
+    UnorderedAccess
+};
+
+enum class ERenderGraphAccess
+{
+    Read,
+    Write
+};
+
+inline constexpr uint32_t RENDER_GRAPH_INVALID_INDEX = ~0u;
+
+// 状态的组合, 每个ERenderGraphResourceState占一位. 连续只读的Pass要求的状态会合并成一个组合, 只需转换一次
+using RenderGraphResourceStates = uint32_t;
+
+constexpr RenderGraphResourceStates ToResourceStates(ERenderGraphResourceState InState)
+{
+    return 1u << static_cast<uint32_t>(InState);
+}
+
+constexpr bool IsReadOnlyState(ERenderGraphResourceState InState)
+{
+    switch (InState)
+    {
+    case ERenderGraphResourceState::CopySrc:
+    case ERenderGraphResourceState::DepthRead:
+    case ERenderGraphResourceState::GenericRead:
+    case ERenderGraphResourceState::PixelShader:
+    case ERenderGraphResourceState::NonPixelShader:
+    case ERenderGraphResourceState::AllShader:
+    case ERenderGraphResourceState::VertexBuffer:
+    case ERenderGraphResourceState::ConstantBuffer:
+    case ERenderGraphResourceState::IndexBuffer:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+struct RenderGraphResourceDesc
+{
+    std::string Name;
+    ERenderGraphResourceKind Kind = ERenderGraphResourceKind::Buffer;
+    uint64_t Size = 0;          // 在堆中实际占用的大小, 为0时表示未知, 不放在临时堆中, 也不参与别名
+    uint64_t Alignment = 0;     // 在堆中的对齐
+    // 导入的资源在一帧开始和结束时的状态. 临时资源创建时的状态, Compile()时改为它在一帧结束时的状态, 这样每帧都不需要再转换回来
+    ERenderGraphResourceState InitialState = ERenderGraphResourceState::Common;
+    bool bImported = false;     // 外部导入的资源不由RenderGraph创建和释放
+    bool bOutput = false;       // 图的输出(如back buffer), 写它的Pass不会被剔除
+};
+
+struct RenderGraphResourceAccess
+{
+    uint32_t ResourceIndex;
+    ERenderGraphAccess Access;
+    ERenderGraphResourceState State;
+};
+
+// 在ResourceAfter首次使用前执行, ResourceBefore为RENDER_GRAPH_INVALID_INDEX时表示任意与之共用内存的资源
+struct RenderGraphAliasingBarrier
+{
+    uint32_t ResourceBefore;
+    uint32_t ResourceAfter;
+};
+
+enum class ERenderGraphBarrierSplit
+{
+    None,
+    Begin,      // 在上一个使用资源的Pass结束时开始转换
+    End         // 在下一个使用资源的Pass开始时完成转换, 中间的Pass可以和转换重叠
+};
+
+struct RenderGraphTransitionBarrier
+{
+    uint32_t ResourceIndex;
+    RenderGraphResourceStates StateBefore;
+    RenderGraphResourceStates StateAfter;
+    ERenderGraphBarrierSplit Split = ERenderGraphBarrierSplit::None;
+};
+
+class RenderGraphCommandRecorder;
+using RenderGraphExecuteFunction = std::function<void(RenderGraphCommandRecorder*)>;
+
+struct RenderGraphPassNode
+{
+    std::string Name;
+    ERenderGraphPassType Type = ERenderGraphPassType::Graphics;
+    std::vector<RenderGraphResourceAccess> Accesses;
+    RenderGraphExecuteFunction ExecuteFunc;
+    bool bHasSideEffects = false;   // 有图之外的作用(如写swap chain, 回读, UI), 即使输出没有被使用也不会被剔除
+};
+
+
+class RenderGraphBackendDevice;
+
+class RenderGraphCore
+{
+public:
+    CLASS_NO_COPY(RenderGraphCore)
+
+    RenderGraphCore() = default;
+    ~RenderGraphCore() = default;
+
+public:
+    uint32_t AddResource(const RenderGraphResourceDesc& InDesc);
+    uint32_t AddPass(const std::string& InName, ERenderGraphPassType InType, RenderGraphExecuteFunction InExecuteFunc = nullptr);
+
+    void ReadResource(uint32_t InPassIndex, uint32_t InResourceIndex, ERenderGraphResourceState InState);
+    void WriteResource(uint32_t InPassIndex, uint32_t InResourceIndex, ERenderGraphResourceState InState);
+
+    // 编译时从输出和有副作用的Pass往回找, 对它们没有贡献的Pass和临时资源会被剔除, 不会创建和执行
+    void MarkOutput(uint32_t InResourceIndex);
+    void MarkSideEffect(uint32_t InPassIndex);
+
+    void Clear();
+    void Compile();
+
+    // 按编译出的顺序在当前线程上依次执行, 临时资源只在一次Execute()内有效
+    void Execute(RenderGraphBackendDevice* InDevice, RenderGraphCommandRecorder* InRecorder) const;
+
+public:
+    uint32_t GetPassNum() const { return static_cast<uint32_t>(Passes.size()); }
+    uint32_t GetResourceNum() const { return static_cast<uint32_t>(Resources.size()); }
+    const RenderGraphPassNode& GetPass(uint32_t InPassIndex) const { return Passes[InPassIndex]; }
+    const RenderGraphResourceDesc& GetResource(uint32_t InResourceIndex) const { return Resources[InResourceIndex]; }
+
+    // 只包括没有被剔除的Pass
+    const std::vector<uint32_t>& GetExecutionOrder() const { return ExecutionOrder; }
+    bool IsPassCulled(uint32_t InPassIndex) const { return PassCulled[InPassIndex]; }
+    uint32_t GetCulledPassNum() const { return static_cast<uint32_t>(Passes.size() - ExecutionOrder.size()); }
+    // 包括写后读, 读后写, 写后写和临时资源共用内存带来的依赖, 已去掉能经由其他依赖传递得到的边
+    const std::vector<uint32_t>& GetPassSuccessors(uint32_t InPassIndex) const { return PassSuccessors[InPassIndex]; }
+    uint64_t GetRedundantEdgeNum() const { return RedundantEdgeNum; }
+    // 没有被任何执行的Pass使用时为RENDER_GRAPH_INVALID_INDEX
+    uint32_t GetResourceFirstPass(uint32_t InResourceIndex) const { return ResourceFirstPass[InResourceIndex]; }
+    uint32_t GetResourceLastPass(uint32_t InResourceIndex) const { return ResourceLastPass[InResourceIndex]; }
+
+    // 临时资源在对应种类的临时堆中的偏移, 不在临时堆中的资源为INVALID_SIZE_64
+    uint64_t GetResourceHeapOffset(uint32_t InResourceIndex) const { return ResourceHeapOffsets[InResourceIndex]; }
+    uint64_t GetTransientHeapSize(ERenderGraphResourceKind InKind) const { return TransientHeapSizes[static_cast<uint32_t>(InKind)]; }
+    // 临时堆中资源的最大对齐, 偏移都是相对堆的起点对齐的, 堆本身至少要按它对齐. 没有临时资源时为0
+    uint64_t GetTransientHeapAlignment(ERenderGraphResourceKind InKind) const { return TransientHeapAlignments[static_cast<uint32_t>(InKind)]; }
+    const std::vector<RenderGraphAliasingBarrier>& GetPassAliasingBarriers(uint32_t InPassIndex) const { return PassAliasingBarriers[InPassIndex]; }
+
+    // 按执行顺序算出的状态转换, 每个Pass开始和结束时各一批, 执行时不需要再记录资源的当前状态
+    const std::vector<RenderGraphTransitionBarrier>& GetPassBeginBarriers(uint32_t InPassIndex) const { return PassBeginBarriers[InPassIndex]; }
+    const std::vector<RenderGraphTransitionBarrier>& GetPassEndBarriers(uint32_t InPassIndex) const { return PassEndBarriers[InPassIndex]; }
+
+private:
+    void AddAccess(uint32_t InPassIndex, uint32_t InResourceIndex, ERenderGraphAccess InAccess, ERenderGraphResourceState InState);
+
+    void CullPasses();
+    void BuildDependencies();
+    void ReduceDependencies();
+    void ComputeResourceLifetimes();
+    void PlanTransientMemory();
+    void PlanBarriers();
+
+    bool IsTransientResource(uint32_t InResourceIndex) const;
+
+private:
+    std::vector<RenderGraphPassNode> Passes;
+    std::vector<RenderGraphResourceDesc> Resources;
+
+    // Compile()的结果
+    bool bCompiled = false;
+    std::vector<bool> PassCulled;
+    std::vector<uint32_t> ExecutionOrder;
+    std::vector<std::vector<uint32_t>> PassSuccessors;
+    uint64_t RedundantEdgeNum = 0;
+    std::vector<uint32_t> ResourceFirstPass;
+    std::vector<uint32_t> ResourceLastPass;
+    std::vector<std::vector<uint32_t>> PassReleasedResources;     // 在该Pass之后不再使用的临时资源
+
+    std::vector<uint64_t> ResourceHeapOffsets;
+    uint64_t TransientHeapSizes[static_cast<uint32_t>(ERenderGraphResourceKind::Num)] = {};
+    uint64_t TransientHeapAlignments[static_cast<uint32_t>(ERenderGraphResourceKind::Num)] = {};
+    std::vector<std::vector<RenderGraphAliasingBarrier>> PassAliasingBarriers;
+    std::vector<std::vector<RenderGraphTransitionBarrier>> PassBeginBarriers;
+    std::vector<std::vector<RenderGraphTransitionBarrier>> PassEndBarriers;
+};
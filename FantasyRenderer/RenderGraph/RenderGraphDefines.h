@@ -4,6 +4,7 @@
 #include <functional>
 #include <unordered_set>
 
+#include "RenderGraphCore.h"
 #include "../D3D12/D3D12Interface.h"
 #include "../TaskFlow/TaskExecutor.h"
 #include "../Model/LightManager.h"
@@ -14,14 +15,6 @@ class RenderGraphPass;
 struct FrameResource;
 
 
-enum class ERenderGraphPassType
-{
-    None,
-    Graphics,
-    Compute,
-    Copy
-};
-
 enum class ERenderGraphResourceType
 {
     Invalid,
@@ -33,6 +26,41 @@ enum class ERenderGraphResourceType
 inline constexpr UINT32 MaxLightNum = 64;
 
 
+static_assert(static_cast<UINT32>(ERenderGraphResourceState::UnorderedAccess) == static_cast<UINT32>(ED3D12ResourceState::UnorderedAccess));
+
+constexpr ERenderGraphResourceState ToRenderGraphResourceState(ED3D12ResourceState InState)
+{
+    return static_cast<ERenderGraphResourceState>(InState);
+}
+
+constexpr ED3D12ResourceState ToD3D12ResourceState(ERenderGraphResourceState InState)
+{
+    return static_cast<ED3D12ResourceState>(InState);
+}
+
+// RenderGraphCore合并出的状态组合
+inline D3D12_RESOURCE_STATES ToD3D12ResourceStates(RenderGraphResourceStates InStates)
+{
+    D3D12_RESOURCE_STATES States = D3D12_RESOURCE_STATE_COMMON;
+    for (UINT32 ix = 0; ix <= static_cast<UINT32>(ED3D12ResourceState::UnorderedAccess); ++ix)
+    {
+        if (InStates & (1u << ix)) States |= ConvertToD3D12ResourceStates(static_cast<ED3D12ResourceState>(ix));
+    }
+    return States;
+}
+
+constexpr D3D12_RESOURCE_BARRIER_FLAGS ToD3D12BarrierFlags(ERenderGraphBarrierSplit InSplit)
+{
+    switch (InSplit)
+    {
+    case ERenderGraphBarrierSplit::Begin: return D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+    case ERenderGraphBarrierSplit::End: return D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+    default:
+        return D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    }
+}
+
+
 struct CameraConstants
 {
     DirectX::XMFLOAT4X4 View = Identity4x4Matrix();
@@ -0,0 +1,158 @@
+﻿#include "RenderGraphNullBackend.h"
+
+#include <sstream>
+
+static const char* GetResourceStateName(ERenderGraphResourceState InState)
+{
+    switch (InState)
+    {
+    case ERenderGraphResourceState::Common: return "Common";
+    case ERenderGraphResourceState::CopySrc: return "CopySrc";
+    case ERenderGraphResourceState::CopyDst: return "CopyDst";
+    case ERenderGraphResourceState::DepthRead: return "DepthRead";
+    case ERenderGraphResourceState::DepthWrite: return "DepthWrite";
+    case ERenderGraphResourceState::GenericRead: return "GenericRead";
+    case ERenderGraphResourceState::PixelShader: return "PixelShader";
+    case ERenderGraphResourceState::NonPixelShader: return "NonPixelShader";
+    case ERenderGraphResourceState::AllShader: return "AllShader";
+    case ERenderGraphResourceState::VertexBuffer: return "VertexBuffer";
+    case ERenderGraphResourceState::ConstantBuffer: return "ConstantBuffer";
+    case ERenderGraphResourceState::IndexBuffer: return "IndexBuffer";
+    case ERenderGraphResourceState::Present: return "Present";
+    case ERenderGraphResourceState::RenderTarget: return "RenderTarget";
+    case ERenderGraphResourceState::UnorderedAccess: return "UnorderedAccess";
+    }
+    return "Unknown";
+}
+
+static std::string GetResourceStatesName(RenderGraphResourceStates InStates)
+{
+    std::string Name;
+    for (uint32_t ix = 0; ix <= static_cast<uint32_t>(ERenderGraphResourceState::UnorderedAccess); ++ix)
+    {
+        if ((InStates & (1u << ix)) == 0) continue;
+
+        if (!Name.empty()) Name += "|";
+        Name += GetResourceStateName(static_cast<ERenderGraphResourceState>(ix));
+    }
+    return Name;
+}
+
+
+void RenderGraphNullBackend::CreateTransientHeap(ERenderGraphResourceKind InKind, uint64_t InSize)
+{
+    AllocatedMemory += InSize;
+    Record(ERenderGraphBackendEventType::CreateTransientHeap, static_cast<uint32_t>(InKind), RENDER_GRAPH_INVALID_INDEX, InSize);
+}
+
+void RenderGraphNullBackend::CreateResource(uint32_t InResourceIndex, const RenderGraphResourceDesc& InDesc, uint64_t InHeapOffset)
+{
+    CreatedResourceNum++;
+    if (InHeapOffset == INVALID_SIZE_64) AllocatedMemory += InDesc.Size;
+    Record(ERenderGraphBackendEventType::CreateResource, InResourceIndex, RENDER_GRAPH_INVALID_INDEX, InHeapOffset);
+}
+
+void RenderGraphNullBackend::ReleaseResource(uint32_t InResourceIndex)
+{
+    Record(ERenderGraphBackendEventType::ReleaseResource, InResourceIndex);
+}
+
+void RenderGraphNullBackend::BeginPass(uint32_t InPassIndex, const RenderGraphPassNode&)
+{
+    Record(ERenderGraphBackendEventType::BeginPass, InPassIndex);
+}
+
+void RenderGraphNullBackend::EndPass(uint32_t InPassIndex)
+{
+    Record(ERenderGraphBackendEventType::EndPass, InPassIndex);
+}
+
+void RenderGraphNullBackend::TransitionBarrier(const RenderGraphTransitionBarrier& InBarrier)
+{
+    if (InBarrier.Split != ERenderGraphBarrierSplit::End) TransitionBarrierNum++;
+    if (InBarrier.Split == ERenderGraphBarrierSplit::Begin) SplitBarrierNum++;
+    PendingBarrierNum++;
+    Record(ERenderGraphBackendEventType::TransitionBarrier, InBarrier.ResourceIndex, RENDER_GRAPH_INVALID_INDEX, 0, &InBarrier);
+}
+
+void RenderGraphNullBackend::AliasingBarrier(uint32_t InResourceIndexBefore, uint32_t InResourceIndexAfter)
+{
+    AliasingBarrierNum++;
+    PendingBarrierNum++;
+    Record(ERenderGraphBackendEventType::AliasingBarrier, InResourceIndexBefore, InResourceIndexAfter);
+}
+
+void RenderGraphNullBackend::FlushBarriers()
+{
+    if (PendingBarrierNum == 0) return;
+
+    BarrierBatchNum++;
+    Record(ERenderGraphBackendEventType::FlushBarriers, RENDER_GRAPH_INVALID_INDEX, RENDER_GRAPH_INVALID_INDEX, PendingBarrierNum);
+    PendingBarrierNum = 0;
+}
+
+void RenderGraphNullBackend::Reset()
+{
+    Events.clear();
+    TransitionBarrierNum = 0;
+    SplitBarrierNum = 0;
+    BarrierBatchNum = 0;
+    PendingBarrierNum = 0;
+    AliasingBarrierNum = 0;
+    CreatedResourceNum = 0;
+    AllocatedMemory = 0;
+}
+
+void RenderGraphNullBackend::Record(ERenderGraphBackendEventType InType, uint32_t InIndex, uint32_t InOtherIndex, uint64_t InValue, const RenderGraphTransitionBarrier* InBarrier)
+{
+    if (!bRecordEvents) return;
+
+    RenderGraphBackendEvent& Event = Events.emplace_back(RenderGraphBackendEvent{ InType, InIndex, InOtherIndex, InValue, 0, 0, ERenderGraphBarrierSplit::None });
+    if (InBarrier)
+    {
+        Event.StateBefore = InBarrier->StateBefore;
+        Event.StateAfter = InBarrier->StateAfter;
+        Event.Split = InBarrier->Split;
+    }
+}
+
+std::string RenderGraphNullBackend::DumpEvents(const RenderGraphCore& InGraph) const
+{
+    std::ostringstream Output;
+    for (const RenderGraphBackendEvent& Event : Events)
+    {
+        switch (Event.Type)
+        {
+        case ERenderGraphBackendEventType::CreateTransientHeap:
+            Output << "Create " << (Event.Index == static_cast<uint32_t>(ERenderGraphResourceKind::Buffer) ? "buffer" : "texture") << " heap (" << Event.Value << " bytes)\n";
+            break;
+        case ERenderGraphBackendEventType::CreateResource:
+            Output << "    Create " << InGraph.GetResource(Event.Index).Name << " (" << InGraph.GetResource(Event.Index).Size << " bytes)";
+            if (Event.Value != INVALID_SIZE_64) Output << " at offset " << Event.Value;
+            Output << "\n";
+            break;
+        case ERenderGraphBackendEventType::ReleaseResource:
+            Output << "    Release " << InGraph.GetResource(Event.Index).Name << "\n";
+            break;
+        case ERenderGraphBackendEventType::BeginPass:
+            Output << "Pass " << InGraph.GetPass(Event.Index).Name << "\n";
+            break;
+        case ERenderGraphBackendEventType::EndPass:
+            break;
+        case ERenderGraphBackendEventType::TransitionBarrier:
+            Output << "    Transition " << InGraph.GetResource(Event.Index).Name << ": "
+                   << GetResourceStatesName(Event.StateBefore) << " -> " << GetResourceStatesName(Event.StateAfter);
+            if (Event.Split == ERenderGraphBarrierSplit::Begin) Output << " (begin)";
+            else if (Event.Split == ERenderGraphBarrierSplit::End) Output << " (end)";
+            Output << "\n";
+            break;
+        case ERenderGraphBackendEventType::AliasingBarrier:
+            Output << "    Aliasing " << (Event.Index == RENDER_GRAPH_INVALID_INDEX ? "(any)" : InGraph.GetResource(Event.Index).Name) << " -> " << InGraph.GetResource(Event.OtherIndex).Name << "\n";
+            break;
+        case ERenderGraphBackendEventType::FlushBarriers:
+            Output << "    Flush " << Event.Value << " barriers\n";
+            break;
+        }
+    }
+    return Output.str();
+}
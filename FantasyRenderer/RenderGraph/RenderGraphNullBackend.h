@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+
+#include "RenderGraphBackend.h"
+
+/*
+ * 不调用任何图形API的后端, 把RenderGraphCore执行时的资源创建, 别名和屏障按顺序记录下来,
+ * 用于在没有GPU的环境下检查编译结果和测量编译, 执行的开销.
+ */
+
+enum class ERenderGraphBackendEventType
+{
+    CreateTransientHeap,
+    CreateResource,
+    ReleaseResource,
+    BeginPass,
+    EndPass,
+    TransitionBarrier,
+    AliasingBarrier,
+    FlushBarriers
+};
+
+struct RenderGraphBackendEvent
+{
+    ERenderGraphBackendEventType Type;
+    uint32_t Index;           // Pass或资源的下标
+    uint32_t OtherIndex;      // AliasingBarrier时为之后的资源
+    uint64_t Value;           // CreateTransientHeap时为堆的大小, CreateResource时为在堆中的偏移, FlushBarriers时为这一批屏障的数量
+    RenderGraphResourceStates StateBefore;
+    RenderGraphResourceStates StateAfter;
+    ERenderGraphBarrierSplit Split;
+};
+
+class RenderGraphNullBackend : public RenderGraphBackendDevice, public RenderGraphCommandRecorder
+{
+public:
+    CLASS_NO_COPY(RenderGraphNullBackend)
+
+    RenderGraphNullBackend() = default;
+    ~RenderGraphNullBackend() override = default;
+
+public:
+    void CreateTransientHeap(ERenderGraphResourceKind InKind, uint64_t InSize) override;
+    void CreateResource(uint32_t InResourceIndex, const RenderGraphResourceDesc& InDesc, uint64_t InHeapOffset) override;
+    void ReleaseResource(uint32_t InResourceIndex) override;
+
+    void BeginPass(uint32_t InPassIndex, const RenderGraphPassNode& InPass) override;
+    void EndPass(uint32_t InPassIndex) override;
+
+    void TransitionBarrier(const RenderGraphTransitionBarrier& InBarrier) override;
+    void AliasingBarrier(uint32_t InResourceIndexBefore, uint32_t InResourceIndexAfter) override;
+    void FlushBarriers() override;
+
+public:
+    void Reset();
+
+    // 关闭后只统计数量, 不保存事件, 测量性能时使用
+    void SetRecordEvents(bool bInRecordEvents) { bRecordEvents = bInRecordEvents; }
+
+    const std::vector<RenderGraphBackendEvent>& GetEvents() const { return Events; }
+    // 拆开的转换只在开始的一半计数
+    uint32_t GetTransitionBarrierNum() const { return TransitionBarrierNum; }
+    uint32_t GetSplitBarrierNum() const { return SplitBarrierNum; }
+    uint32_t GetBarrierBatchNum() const { return BarrierBatchNum; }
+    uint32_t GetAliasingBarrierNum() const { return AliasingBarrierNum; }
+    uint32_t GetCreatedResourceNum() const { return CreatedResourceNum; }
+    uint64_t GetAllocatedMemory() const { return AllocatedMemory; }
+
+    // 每个事件一行, 用RenderGraphCore中的名字显示Pass和资源
+    std::string DumpEvents(const RenderGraphCore& InGraph) const;
+
+private:
+    void Record(ERenderGraphBackendEventType InType, uint32_t InIndex, uint32_t InOtherIndex = RENDER_GRAPH_INVALID_INDEX, uint64_t InValue = 0, const RenderGraphTransitionBarrier* InBarrier = nullptr);
+
+private:
+    bool bRecordEvents = true;
+    std::vector<RenderGraphBackendEvent> Events;
+
+    uint32_t TransitionBarrierNum = 0;
+    uint32_t SplitBarrierNum = 0;
+    uint32_t BarrierBatchNum = 0;
+    uint32_t PendingBarrierNum = 0;
+    uint32_t AliasingBarrierNum = 0;
+    uint32_t CreatedResourceNum = 0;
+    uint64_t AllocatedMemory = 0;     // 临时堆和单独分配的资源大小之和, 即需要的显存
+};
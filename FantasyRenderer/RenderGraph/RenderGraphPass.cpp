@@ -20,10 +20,20 @@ RenderGraphPass::~RenderGraphPass() noexcept
 
 void RenderGraphPass::ResourceAllocationAndTransition()
 {
-    auto AllocateAndTransitionBuffer = [this](RenderGraphBuffer* InBuffer)
+    // 别名屏障要在资源的状态转换之前
+    auto CreateAliasingBarrier = [this](RenderGraphResource* InResource)
+    {
+        const auto Iterator = AliasingBarriers.find(InResource);
+        if (Iterator == AliasingBarriers.end()) return;
+
+        ID3D12Resource* ResourceBefore = Iterator->second ? Iterator->second->GetNative() : nullptr;
+        CmdList->CreateAliasingBarrier(ResourceBefore, InResource->GetNative());
+    };
+
+    auto AllocateBuffer = [this, &CreateAliasingBarrier](RenderGraphBuffer* InBuffer)
     {
         Builder->AllocateBuffer(InBuffer, CmdList);
-        CmdList->CreateBufferTransitionBarrier(InBuffer->Buffer.get(), ResourceStateMap[InBuffer]);
+        CreateAliasingBarrier(InBuffer);
         InBuffer->LastUsedFrame = Builder->GetFrameIndex();
 
         const D3D12Descriptor CPUDescriptor = InBuffer->Buffer->GetCPUDescriptor();
@@ -35,12 +45,12 @@ void RenderGraphPass::ResourceAllocationAndTransition()
         }
     };
 
-    auto AllocateAndTransitionTexture = [this](RenderGraphTexture* InTexture)
+    auto AllocateTexture = [this, &CreateAliasingBarrier](RenderGraphTexture* InTexture)
     {
         const ED3D12ResourceState ResourceState = ResourceStateMap[InTexture];
         
         Builder->AllocateTexture(InTexture, CmdList);
-        CmdList->CreateTextureTransitionBarrier(InTexture->Texture.get(), ResourceState);
+        CreateAliasingBarrier(InTexture);
         InTexture->LastUsedFrame = Builder->GetFrameIndex();
 
         const D3D12Descriptor CPUDescriptor = InTexture->Texture->GetCPUDescriptor();
@@ -50,11 +60,11 @@ void RenderGraphPass::ResourceAllocationAndTransition()
             switch (ResourceState)
             {
             case ED3D12ResourceState::RenderTarget:
-                if (DescriptorType != ED3D12DescriptorType::RTV) InTexture->Texture->CreateOwnCPUDescriptor(); break;
+                if (DescriptorType != ED3D12DescriptorType::RTV) InTexture->Texture->CreateOwnCPUDescriptor(ResourceState); break;
             case ED3D12ResourceState::DepthWrite:
-                if (DescriptorType != ED3D12DescriptorType::DSV) InTexture->Texture->CreateOwnCPUDescriptor(); break;
+                if (DescriptorType != ED3D12DescriptorType::DSV) InTexture->Texture->CreateOwnCPUDescriptor(ResourceState); break;
             case ED3D12ResourceState::PixelShader:
-                if (DescriptorType != ED3D12DescriptorType::CBV_SRV_UAV) InTexture->Texture->CreateOwnCPUDescriptor();
+                if (DescriptorType != ED3D12DescriptorType::CBV_SRV_UAV) InTexture->Texture->CreateOwnCPUDescriptor(ResourceState);
                 
                 {
                     D3D12Device* Device = CmdList->GetDevice();
@@ -69,17 +79,28 @@ void RenderGraphPass::ResourceAllocationAndTransition()
 
     
     {
-        FrameResource* FrameResourceData = Builder->GetFrameResource();
-        std::lock_guard LockGuard(FrameResourceData->CmdListsMutex);
-        FrameResourceData->CmdLists.push_back(CmdList);     // 为了防止并行时资源状态转换的混乱, 需锁住并抢占一个位置
-
-        std::ranges::for_each(std::begin(ReadBuffers), std::end(ReadBuffers), AllocateAndTransitionBuffer);
-        std::ranges::for_each(std::begin(WriteBuffers), std::end(WriteBuffers), AllocateAndTransitionBuffer);
-        std::ranges::for_each(std::begin(ReadTextures), std::end(ReadTextures), AllocateAndTransitionTexture);
-        std::ranges::for_each(std::begin(WriteTextures), std::end(WriteTextures), AllocateAndTransitionTexture);
+        // 资源的创建和描述符的分配不是线程安全的. 状态转换已在编译时确定, 命令列表的提交顺序也已固定, 不需要再锁住
+        std::lock_guard LockGuard(Builder->GetFrameResource()->AllocationMutex);
+
+        std::ranges::for_each(std::begin(ReadBuffers), std::end(ReadBuffers), AllocateBuffer);
+        std::ranges::for_each(std::begin(WriteBuffers), std::end(WriteBuffers), AllocateBuffer);
+        std::ranges::for_each(std::begin(ReadTextures), std::end(ReadTextures), AllocateTexture);
+        std::ranges::for_each(std::begin(WriteTextures), std::end(WriteTextures), AllocateTexture);
+    }
+
+    for (const RenderGraphPassBarrier& Barrier : BeginBarriers)
+    {
+        CmdList->CreateTransitionBarrier(Barrier.Resource->GetNative(), Barrier.StateBefore, Barrier.StateAfter, Barrier.Flags);
+    }
+    CmdList->FlushBarriers();
+}
+
+void RenderGraphPass::ResourceEndTransition()
+{
+    for (const RenderGraphPassBarrier& Barrier : EndBarriers)
+    {
+        CmdList->CreateTransitionBarrier(Barrier.Resource->GetNative(), Barrier.StateBefore, Barrier.StateAfter, Barrier.Flags);
     }
-    
-    
     CmdList->FlushBarriers();
 }
 
@@ -89,18 +110,18 @@ void RenderGraphPass::BeginRenderPass()
     {
         CmdList->SetViewport(Desc.Width, Desc.Height);
     
-        D3D12RenderPassDesc RenderPassDesc{};
+        D3D12RenderPassDesc RenderPassDesc(&Builder->GetFrameResource()->ArenaResource);
 
-        for (const RenderGraphTexture* Texture : WriteTextures)
+        for (RenderGraphTexture* Texture : WriteTextures)
         {
-            D3D12TextureDesc* Desc = Texture->Texture->GetDesc();
+            const ED3D12ResourceState State = ResourceStateMap[Texture];
         
-            if (Desc->State == ED3D12ResourceState::RenderTarget)
+            if (State == ED3D12ResourceState::RenderTarget)
             {
                 RenderPassDesc.RenderTargets.push_back(Texture->Texture.get());
                 RenderPassDesc.RenderTargetAccessTypes.push_back(Texture->RenderTargetAccessType);
             }
-            else if (Desc->State == ED3D12ResourceState::DepthWrite)
+            else if (State == ED3D12ResourceState::DepthWrite)
             {
                 RenderPassDesc.DepthStencil = Texture->Texture.get();
                 RenderPassDesc.DepthAccessType = Texture->DepthStencilAccessType.first;
@@ -120,34 +141,4 @@ void RenderGraphPass::EndRenderPass()
         CmdList->EndRenderPass();
     }
 }
-
-
-void RenderGraphPass::InActiveResources()
-{
-    std::ranges::for_each(
-        std::begin(ResourcesToDestroy),
-        std::end(ResourcesToDestroy),
-        [](RenderGraphResource* InResource) { InResource->TryInActive(); }
-    );
-}
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
 
@@ -10,6 +10,18 @@ struct RenderGraphPassDesc
 
     UINT32 Width = 0;
     UINT32 Height = 0;
+
+    // 有图之外的作用(如写back buffer, 回读, UI)时设为true, 否则输出没有被使用的Pass会在编译时被剔除
+    bool bHasSideEffects = false;
+};
+
+// 由RenderGraph::Compile()按RenderGraphCore规划的状态转换填写
+struct RenderGraphPassBarrier
+{
+    RenderGraphResource* Resource;
+    D3D12_RESOURCE_STATES StateBefore;
+    D3D12_RESOURCE_STATES StateAfter;
+    D3D12_RESOURCE_BARRIER_FLAGS Flags;
 };
 
 class RenderGraphPass
@@ -30,9 +42,9 @@ public:
 
 protected:
     void ResourceAllocationAndTransition();
+    void ResourceEndTransition();
     void BeginRenderPass();
     void EndRenderPass();
-    void InActiveResources();
     
 protected:
     RenderGraphPassDesc Desc;
@@ -45,7 +57,12 @@ protected:
     std::vector<RenderGraphTexture*> WriteTextures;
     std::unordered_map<RenderGraphResource*, ED3D12ResourceState> ResourceStateMap;
     
-    std::vector<RenderGraphResource*> ResourcesToDestroy;
+    // 在本Pass首次使用的临时资源 -> 之前使用同一块内存的资源(为nullptr时表示任意), 由RenderGraph::Compile()填写
+    std::unordered_map<RenderGraphResource*, RenderGraphResource*> AliasingBarriers;
+
+    // 在本Pass开始和结束时各作为一批提交, 执行时不再读写资源的当前状态
+    std::vector<RenderGraphPassBarrier> BeginBarriers;
+    std::vector<RenderGraphPassBarrier> EndBarriers;
 };
 
 
@@ -81,9 +98,9 @@ public:
         ExecuteFunc(Data, Builder, CmdList);
         EndRenderPass();
 
-        CmdList->Close();
+        ResourceEndTransition();
 
-        InActiveResources();
+        CmdList->Close();
     }
 
     void SetCmdList(D3D12CommandList* InCmdList) override{ CmdList = InCmdList; }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "RenderGraphResource.h"
+#include "../MultiThreading/ConcurrentNameRegistry.h"
 
 class RenderGraphResourcePool
 {
@@ -20,9 +21,33 @@ public:
     void AllocateBuffer(RenderGraphBuffer* InBuffer, D3D12CommandList* InCmdList);
     void AllocateTexture(RenderGraphTexture* InTexture, D3D12CommandList* InCmdList);
 
+    RenderGraphBuffer* FindBuffer(const char* InName) const { return BufferRegistry.Find(InName); }
+    RenderGraphTexture* FindTexture(const char* InName) const { return TextureRegistry.Find(InName); }
+
+    template <typename... Args>
+    RenderGraphBuffer* AddBuffer(Args&&... Arguments)
+    {
+        RenderGraphBuffer* Buffer = Buffers.PushFront(std::forward<Args>(Arguments)...);
+        BufferRegistry.Insert(Buffer);
+        return Buffer;
+    }
+
+    template <typename... Args>
+    RenderGraphTexture* AddTexture(Args&&... Arguments)
+    {
+        RenderGraphTexture* Texture = Textures.PushFront(std::forward<Args>(Arguments)...);
+        TextureRegistry.Insert(Texture);
+        return Texture;
+    }
+
 private:
     D3D12Device* Device;
 
+    // 只用于持有资源和Tick()时回收, 不关心顺序, 所以用PushFront(), PushBack()要从头走到尾
     ConcurrentList<RenderGraphBuffer> Buffers;
     ConcurrentList<RenderGraphTexture> Textures;
+
+    // 按名字查找, 同名的资源只登记第一个
+    ConcurrentNameRegistry<RenderGraphBuffer> BufferRegistry;
+    ConcurrentNameRegistry<RenderGraphTexture> TextureRegistry;
 };
@@ -14,15 +14,17 @@ public:
     RenderGraphResource& operator=(RenderGraphResource&& rhs) noexcept;
 
 
-    bool TryActive();
-    bool TryInActive();
+    // 还未创建时为nullptr
+    virtual ID3D12Resource* GetNative() const { return nullptr; }
+    // 还未创建时修改创建时的状态
+    virtual void SetInitialState(ED3D12ResourceState InState) {}
 
 
     std::string Name;
-    std::atomic<bool> Active = false;
     
     UINT64 LastUsedFrame = 0;
-    RenderGraphPass* LastUsedPass = nullptr;
+    UINT64 PlacedOffset = INVALID_SIZE_64;     // 由RenderGraph::Compile()规划的临时资源在堆中的偏移, 与其他临时资源共用内存
+    bool bOutput = false;                       // 图的输出, 写它的Pass不会被剔除
 
     void* Data;
     D3D12Descriptor GPUDescriptor;
@@ -37,14 +39,12 @@ struct RenderGraphBuffer : public RenderGraphResource
     ~RenderGraphBuffer() noexcept override;
 
     
-    RenderGraphBuffer* GetLastAliasedBuffer() const;
+    ID3D12Resource* GetNative() const override { return Buffer ? Buffer->GetNative() : nullptr; }
+    void SetInitialState(ED3D12ResourceState InState) override { if (Desc) Desc->State = InState; }
 
     
     D3D12BufferDesc* Desc;
     std::unique_ptr<D3D12Buffer> Buffer;
-
-    RenderGraphBuffer* AliasBuffer = nullptr;
-    RenderGraphBuffer* AliasedBuffer = nullptr;
 };
 
 
@@ -55,14 +55,12 @@ struct RenderGraphTexture : public RenderGraphResource
     ~RenderGraphTexture() noexcept override;
 
     
-    RenderGraphTexture* GetLastAliasedTexture() const;
+    ID3D12Resource* GetNative() const override { return Texture ? Texture->GetNative() : nullptr; }
+    void SetInitialState(ED3D12ResourceState InState) override { if (Desc) Desc->State = InState; }
     
 
     D3D12TextureDesc* Desc;
     std::unique_ptr<D3D12Texture> Texture;
-
-    RenderGraphTexture* AliasTexture = nullptr;
-    RenderGraphTexture* AliasedTexture = nullptr;
     
     union
     {
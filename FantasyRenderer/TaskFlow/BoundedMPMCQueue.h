@@ -0,0 +1,188 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <windows.h>
+
+#include "../Utility/AlignUtil.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 有界的多生产者多消费者队列(Dmitry Vyukov的算法), 元素直接存放在环形数组中, Push/Pop不分配内存.
+ * 每个槽有一个序号: 等于入队位置时可写, 等于入队位置 + 1时可读, 读完后加上容量留给下一轮.
+ * TryPush/TryPop不加锁; Push/Pop在队列满/空时阻塞等待, 没有等待者时不会进入内核, 也不会写等待用的版本号.
+ */
+
+template <typename T>
+class BoundedMPMCQueue
+{
+    // 等待用的事件计数: 低32位为登记的等待者数, 高32位为通知的次数
+    static constexpr UINT64 WaiterNumMask = 0xFFFFFFFFull;
+    static constexpr UINT64 NotifyIncrement = 1ull << 32;
+
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> Sequence;
+        T Value;
+    };
+
+public:
+    CLASS_NO_COPY(BoundedMPMCQueue)
+
+    // 容量会向上取到2的幂
+    explicit BoundedMPMCQueue(size_t InCapacity)
+        : Capacity(AlignPow2(InCapacity, 2)), Mask(Capacity - 1), Cells(std::make_unique<Cell[]>(Capacity))
+    {
+        for (size_t ix = 0; ix < Capacity; ++ix)
+        {
+            Cells[ix].Sequence.store(ix, std::memory_order_relaxed);
+        }
+    }
+    ~BoundedMPMCQueue() = default;
+
+public:
+    bool TryPush(T InValue)
+    {
+        return TryPushImpl(InValue);
+    }
+
+    bool TryPop(T& OutValue)
+    {
+        size_t Position = DequeuePosition.load(std::memory_order_relaxed);
+        Cell* CurrCell;
+        while (true)
+        {
+            CurrCell = &Cells[Position & Mask];
+            const size_t Sequence = CurrCell->Sequence.load(std::memory_order_acquire);
+            const intptr_t Difference = static_cast<intptr_t>(Sequence) - static_cast<intptr_t>(Position + 1);
+            if (Difference == 0)
+            {
+                if (DequeuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) break;
+            }
+            else if (Difference < 0)
+            {
+                return false;   // 空
+            }
+            else
+            {
+                Position = DequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        OutValue = std::move(CurrCell->Value);
+        CurrCell->Sequence.store(Position + Mask + 1, std::memory_order_release);
+
+        Notify(PopEvent);
+        return true;
+    }
+
+    // 队列满时阻塞, 直到有元素出队
+    void Push(T InValue)
+    {
+        while (!TryPushImpl(InValue))
+        {
+            if (WaitUnless(PopEvent, [this, &InValue]() { return TryPushImpl(InValue); })) return;
+        }
+    }
+
+    // 队列空时阻塞, 直到有元素入队
+    T Pop()
+    {
+        T Output;
+        while (!TryPop(Output))
+        {
+            if (WaitUnless(PushEvent, [this, &Output]() { return TryPop(Output); })) break;
+        }
+        return Output;
+    }
+
+    // 只是一个瞬时的近似值
+    bool Empty() const
+    {
+        return DequeuePosition.load(std::memory_order_acquire) >= EnqueuePosition.load(std::memory_order_acquire);
+    }
+
+    size_t GetCapacity() const { return Capacity; }
+
+private:
+    // 只在成功时移走InValue
+    bool TryPushImpl(T& InValue)
+    {
+        size_t Position = EnqueuePosition.load(std::memory_order_relaxed);
+        Cell* CurrCell;
+        while (true)
+        {
+            CurrCell = &Cells[Position & Mask];
+            const size_t Sequence = CurrCell->Sequence.load(std::memory_order_acquire);
+            const intptr_t Difference = static_cast<intptr_t>(Sequence) - static_cast<intptr_t>(Position);
+            if (Difference == 0)
+            {
+                if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) break;
+            }
+            else if (Difference < 0)
+            {
+                return false;   // 满
+            }
+            else
+            {
+                Position = EnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        CurrCell->Value = std::move(InValue);
+        CurrCell->Sequence.store(Position + 1, std::memory_order_release);
+
+        Notify(PushEvent);
+        return true;
+    }
+
+    // 写入或取走元素后, 栅栏与等待方登记后的重试构成Dekker式同步: 要么这里看到等待者, 要么等待方的重试看到这次修改.
+    // 没有等待者时只有一个栅栏和一次读, 不写共享的缓存行. 一次通知唤醒所有已登记的等待者并把等待者数清零,
+    // 所以在它们醒来之前的其他通知不会重复进入内核
+    static void Notify(std::atomic<UINT64>& InOutEvent)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        UINT64 Event = InOutEvent.load(std::memory_order_relaxed);
+        while ((Event & WaiterNumMask) != 0)
+        {
+            if (InOutEvent.compare_exchange_weak(Event, (Event & ~WaiterNumMask) + NotifyIncrement, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                InOutEvent.notify_all();
+                return;
+            }
+        }
+    }
+
+    // 先登记为等待者, 再重试一次, 重试失败才睡眠, 直到通知次数改变. 重试成功时取消登记, 已被通知清零的就不用再减
+    template <typename F>
+    static bool WaitUnless(std::atomic<UINT64>& InOutEvent, const F& InTryFunc)
+    {
+        UINT64 Event = InOutEvent.fetch_add(1, std::memory_order_seq_cst) + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const UINT64 NotifyNum = Event >> 32;
+
+        if (InTryFunc())
+        {
+            while ((Event >> 32) == NotifyNum && !InOutEvent.compare_exchange_weak(Event, Event - 1, std::memory_order_relaxed)) {}
+            return true;
+        }
+
+        // 其他线程登记时值也会变, 这时通知次数没变, 继续等
+        while ((Event >> 32) == NotifyNum)
+        {
+            InOutEvent.wait(Event, std::memory_order_acquire);
+            Event = InOutEvent.load(std::memory_order_acquire);
+        }
+        return false;
+    }
+
+private:
+    const size_t Capacity;
+    const size_t Mask;
+    std::unique_ptr<Cell[]> Cells;
+
+    alignas(64) std::atomic<size_t> EnqueuePosition = 0;
+    alignas(64) std::atomic<size_t> DequeuePosition = 0;
+
+    alignas(64) std::atomic<UINT64> PushEvent = 0;     // Pop()在上面等待
+    alignas(64) std::atomic<UINT64> PopEvent = 0;      // Push()在上面等待
+};
@@ -0,0 +1,412 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/*
+ * 基于ThreadPool的协程.
+ * CoTask<T>是惰性启动的, 被co_await或SyncWait()时才开始执行, 完成后通过对称转移恢复等待它的协程.
+ * co_await TaskExecutor::Schedule()可以让协程转到线程池的工作线程上继续执行, 不会阻塞任何线程.
+ */
+
+template <typename T = void>
+class CoTask;
+
+class CoPromiseBase
+{
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> InHandle) noexcept
+        {
+            const std::coroutine_handle<> Continuation = InHandle.promise().Continuation;
+            return Continuation ? Continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception()
+    {
+        Exception = std::current_exception();
+    }
+
+    void SetContinuation(std::coroutine_handle<> InContinuation)
+    {
+        Continuation = InContinuation;
+    }
+
+protected:
+    void RethrowIfFailed() const
+    {
+        if (Exception) std::rethrow_exception(Exception);
+    }
+
+private:
+    std::coroutine_handle<> Continuation;
+    std::exception_ptr Exception;
+};
+
+template <typename T>
+class CoPromise : public CoPromiseBase
+{
+public:
+    CoTask<T> get_return_object() noexcept;
+
+    template <typename V>
+    void return_value(V&& InValue)
+    {
+        Value.emplace(std::forward<V>(InValue));
+    }
+
+    T TakeResult()
+    {
+        RethrowIfFailed();
+        return std::move(*Value);
+    }
+
+private:
+    std::optional<T> Value;
+};
+
+template <>
+class CoPromise<void> : public CoPromiseBase
+{
+public:
+    CoTask<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void TakeResult() const
+    {
+        RethrowIfFailed();
+    }
+};
+
+
+template <typename T>
+class [[nodiscard]] CoTask
+{
+public:
+    using promise_type = CoPromise<T>;
+    using HandleType = std::coroutine_handle<promise_type>;
+
+private:
+    // 启动协程并在完成后恢复等待者, bTakeResult为false时只等待完成, 不取结果也不抛出协程中的异常
+    template <bool bTakeResult>
+    struct Awaiter
+    {
+        bool await_ready() const
+        {
+            ThrowIfFalse(Handle != nullptr, "Cannot await an empty CoTask.");
+            return Handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> InContinuation) noexcept
+        {
+            Handle.promise().SetContinuation(InContinuation);
+            return Handle;
+        }
+
+        decltype(auto) await_resume()
+        {
+            if constexpr (bTakeResult) return Handle.promise().TakeResult();
+        }
+
+        HandleType Handle;
+    };
+
+public:
+    CoTask() = default;
+    explicit CoTask(HandleType InHandle) : Handle(InHandle) {}
+    ~CoTask()
+    {
+        if (Handle) Handle.destroy();
+    }
+
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    CoTask(CoTask&& rhs) noexcept : Handle(rhs.Handle)
+    {
+        rhs.Handle = nullptr;
+    }
+
+    CoTask& operator=(CoTask&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            if (Handle) Handle.destroy();
+            Handle = rhs.Handle;
+            rhs.Handle = nullptr;
+        }
+        return *this;
+    }
+
+public:
+    auto operator co_await() const noexcept
+    {
+        return Awaiter<true>{ Handle };
+    }
+
+    auto WhenReady() const noexcept
+    {
+        return Awaiter<false>{ Handle };
+    }
+
+    bool IsEmpty() const
+    {
+        return !Handle;
+    }
+
+    bool IsReady() const
+    {
+        ThrowIfFalse(Handle != nullptr, "Empty CoTask has no state.");
+        return Handle.done();
+    }
+
+    // 只能在完成后调用
+    decltype(auto) TakeResult() const
+    {
+        ThrowIfFalse(Handle != nullptr, "Empty CoTask has no result.");
+        return Handle.promise().TakeResult();
+    }
+
+private:
+    HandleType Handle = nullptr;
+};
+
+template <typename T>
+CoTask<T> CoPromise<T>::get_return_object() noexcept
+{
+    return CoTask<T>(std::coroutine_handle<CoPromise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> CoPromise<void>::get_return_object() noexcept
+{
+    return CoTask<void>(std::coroutine_handle<CoPromise<void>>::from_promise(*this));
+}
+
+
+// 让协程转到线程池的工作线程上继续执行
+class ScheduleAwaiter
+{
+public:
+    explicit ScheduleAwaiter(ThreadPool* InPool) : Pool(InPool) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> InHandle) const
+    {
+        Pool->SubmitDetached([InHandle]() { InHandle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    ThreadPool* Pool = nullptr;
+};
+
+
+// 立即开始执行, 结束时自己销毁, 只用来实现下面的组合函数
+struct CoDetachedTask
+{
+    struct promise_type
+    {
+        CoDetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+template <typename T, typename F>
+CoDetachedTask RunCoTaskDetached(const CoTask<T>& InTask, F InOnFinished)
+{
+    co_await InTask.WhenReady();
+    InOnFinished();
+}
+
+
+template <typename T>
+class WhenAllAwaiter
+{
+public:
+    explicit WhenAllAwaiter(const std::vector<CoTask<T>>& InTasks) : Tasks(InTasks), UnfinishedNum(InTasks.size() + 1) {}
+
+    bool await_ready() const noexcept
+    {
+        return Tasks.empty();
+    }
+
+    // 计数多出的1由这里减去, 保证所有任务都已启动后才可能恢复等待者
+    bool await_suspend(std::coroutine_handle<> InContinuation)
+    {
+        Continuation = InContinuation;
+        for (const auto& Task : Tasks)
+        {
+            RunCoTaskDetached(
+                Task,
+                [this]()
+                {
+                    if (UnfinishedNum.fetch_sub(1, std::memory_order_acq_rel) == 1) Continuation.resume();
+                }
+            );
+        }
+        return UnfinishedNum.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    const std::vector<CoTask<T>>& Tasks;
+    std::atomic<size_t> UnfinishedNum;
+    std::coroutine_handle<> Continuation;
+};
+
+/*
+ * 等待所有任务完成, 结果按输入顺序返回.
+ * 每个任务从当前线程开始执行, 直到它第一次挂起; 需要并行执行时在任务开头co_await TaskExecutor::Schedule().
+ */
+template <typename T>
+CoTask<std::vector<T>> WhenAll(std::vector<CoTask<T>> InTasks)
+{
+    ThrowIfFalse(std::ranges::none_of(InTasks, [](const CoTask<T>& InTask) { return InTask.IsEmpty(); }), "Cannot await an empty CoTask.");
+    co_await WhenAllAwaiter<T>(InTasks);
+
+    std::vector<T> Results;
+    Results.reserve(InTasks.size());
+    for (const auto& Task : InTasks)
+    {
+        Results.emplace_back(Task.TakeResult());
+    }
+    co_return Results;
+}
+
+inline CoTask<void> WhenAll(std::vector<CoTask<void>> InTasks)
+{
+    ThrowIfFalse(std::ranges::none_of(InTasks, [](const CoTask<void>& InTask) { return InTask.IsEmpty(); }), "Cannot await an empty CoTask.");
+    co_await WhenAllAwaiter<void>(InTasks);
+
+    for (const auto& Task : InTasks)
+    {
+        Task.TakeResult();
+    }
+}
+
+
+template <typename T>
+class WhenAnyAwaiter
+{
+    struct SharedState
+    {
+        explicit SharedState(std::vector<CoTask<T>> InTasks) : Tasks(std::move(InTasks)) {}
+
+        std::vector<CoTask<T>> Tasks;
+        std::atomic<bool> bAnyFinished = false;
+        std::atomic<UINT32> ResumeCount = 2;   // 第一个完成的任务和await_suspend()各减一次
+        size_t FirstIndex = 0;
+        std::coroutine_handle<> Continuation;
+    };
+
+public:
+    explicit WhenAnyAwaiter(std::vector<CoTask<T>> InTasks) : State(std::make_shared<SharedState>(std::move(InTasks))) {}
+
+    bool await_ready() const noexcept
+    {
+        return State->Tasks.empty();
+    }
+
+    bool await_suspend(std::coroutine_handle<> InContinuation)
+    {
+        State->Continuation = InContinuation;
+        for (size_t ix = 0; ix < State->Tasks.size(); ++ix)
+        {
+            // 其余任务完成前State不能释放, 所以每个任务都持有一份
+            RunCoTaskDetached(
+                State->Tasks[ix],
+                [State = State, ix]()
+                {
+                    if (State->bAnyFinished.exchange(true, std::memory_order_acq_rel)) return;
+
+                    State->FirstIndex = ix;
+                    if (State->ResumeCount.fetch_sub(1, std::memory_order_acq_rel) == 1) State->Continuation.resume();
+                }
+            );
+        }
+        return State->ResumeCount.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    std::shared_ptr<SharedState> await_resume() const noexcept
+    {
+        return State;
+    }
+
+private:
+    std::shared_ptr<SharedState> State;
+};
+
+/*
+ * 等待第一个完成的任务, 返回它的下标和结果. 其余的任务不会被取消, 会在后台继续执行完.
+ * InTasks不能为空.
+ */
+template <typename T>
+CoTask<std::pair<size_t, T>> WhenAny(std::vector<CoTask<T>> InTasks)
+{
+    ThrowIfFalse(std::ranges::none_of(InTasks, [](const CoTask<T>& InTask) { return InTask.IsEmpty(); }), "Cannot await an empty CoTask.");
+    const auto State = co_await WhenAnyAwaiter<T>(std::move(InTasks));
+    co_return std::pair<size_t, T>(State->FirstIndex, State->Tasks[State->FirstIndex].TakeResult());
+}
+
+inline CoTask<size_t> WhenAny(std::vector<CoTask<void>> InTasks)
+{
+    ThrowIfFalse(std::ranges::none_of(InTasks, [](const CoTask<void>& InTask) { return InTask.IsEmpty(); }), "Cannot await an empty CoTask.");
+    const auto State = co_await WhenAnyAwaiter<void>(std::move(InTasks));
+    State->Tasks[State->FirstIndex].TakeResult();
+    co_return State->FirstIndex;
+}
+
+
+// 阻塞当前线程直到任务完成, 不能在工作线程中调用
+template <typename T>
+T SyncWait(CoTask<T> InTask)
+{
+    ThrowIfFalse(!InTask.IsEmpty(), "Cannot await an empty CoTask.");
+
+    std::mutex Mutex;
+    std::condition_variable ConditionVariable;
+    bool bFinished = false;
+
+    RunCoTaskDetached(
+        InTask,
+        [&]()
+        {
+            // 持锁通知, 保证SyncWait()返回前不会再访问这些局部变量
+            std::lock_guard LockGuard(Mutex);
+            bFinished = true;
+            ConditionVariable.notify_all();
+        }
+    );
+
+    {
+        std::unique_lock Lock(Mutex);
+        ConditionVariable.wait(Lock, [&bFinished]() { return bFinished; });
+    }
+    return InTask.TakeResult();
+}
@@ -1,41 +1,96 @@
 ﻿#pragma once
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <type_traits>
+
+/*
+ * 只可移动的可调用对象包装.
+ * 捕获不超过InlineSize字节的可调用对象直接存放在内部缓冲中, 只有较大的捕获才会在堆上分配.
+ */
 
 class FunctionWrapper
 {
-    struct ImplBase
+    static constexpr size_t InlineSize = 48;
+
+    struct VTable
     {
-        virtual void Call() = 0;
-        virtual ~ImplBase() = default;
+        void (*Call)(void* InStorage);
+        void (*Move)(void* OutStorage, void* InStorage);     // 移动到OutStorage中, 并析构InStorage中的对象
+        void (*Destroy)(void* InStorage);
     };
 
     template <typename F>
-    struct ImplType : ImplBase
+    static constexpr bool StoreInline = sizeof(F) <= InlineSize &&
+                                        alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<F>;
+
+    template <typename F>
+    struct InlineImpl
     {
-        explicit ImplType(F&& InFunc) noexcept : Func(InFunc) {}
-        void Call() override { Func(); }
-        
-        F Func;
+        static void Call(void* InStorage) { (*static_cast<F*>(InStorage))(); }
+        static void Move(void* OutStorage, void* InStorage)
+        {
+            F* Func = static_cast<F*>(InStorage);
+            new (OutStorage) F(std::move(*Func));
+            Func->~F();
+        }
+        static void Destroy(void* InStorage) { static_cast<F*>(InStorage)->~F(); }
+
+        static constexpr VTable Table{ &Call, &Move, &Destroy };
     };
-    
+
+    template <typename F>
+    struct HeapImpl
+    {
+        static void Call(void* InStorage) { (**static_cast<F**>(InStorage))(); }
+        static void Move(void* OutStorage, void* InStorage) { *static_cast<F**>(OutStorage) = *static_cast<F**>(InStorage); }
+        static void Destroy(void* InStorage) { delete *static_cast<F**>(InStorage); }
+
+        static constexpr VTable Table{ &Call, &Move, &Destroy };
+    };
+
 public:
     FunctionWrapper() = default;
-    ~FunctionWrapper() = default;
+    ~FunctionWrapper()
+    {
+        Reset();
+    }
 
-    template <typename F, typename = std::enable_if_t<std::is_rvalue_reference_v<F&&>>>
-    FunctionWrapper(F&& InFunc) : Func(std::make_unique<ImplType<F>>(std::forward<F>(InFunc))) {}
+    template <
+        typename F,
+        typename = std::enable_if_t<std::is_rvalue_reference_v<F&&> && !std::is_same_v<std::decay_t<F>, FunctionWrapper>>
+    >
+    FunctionWrapper(F&& InFunc)
+    {
+        using FuncType = std::decay_t<F>;
+        if constexpr (StoreInline<FuncType>)
+        {
+            new (Storage) FuncType(std::forward<F>(InFunc));
+            Table = &InlineImpl<FuncType>::Table;
+        }
+        else
+        {
+            *reinterpret_cast<FuncType**>(Storage) = new FuncType(std::forward<F>(InFunc));
+            Table = &HeapImpl<FuncType>::Table;
+        }
+    }
 
     FunctionWrapper(const FunctionWrapper&) = delete;
     FunctionWrapper& operator=(const FunctionWrapper&) = delete;
 
     FunctionWrapper(FunctionWrapper&& rhs) noexcept
-        : Func(std::move(rhs.Func))
     {
+        MoveFrom(rhs);
     }
 
     FunctionWrapper& operator=(FunctionWrapper&& rhs) noexcept
     {
-        Func = std::move(rhs.Func);
+        if (this != &rhs)
+        {
+            Reset();
+            MoveFrom(rhs);
+        }
         return *this;
     }
 
@@ -43,9 +98,35 @@ public:
 
     void operator()() const
     {
-        Func->Call();
+        Table->Call(const_cast<std::byte*>(Storage));
+    }
+
+    explicit operator bool() const
+    {
+        return Table != nullptr;
+    }
+
+    void Reset()
+    {
+        if (Table != nullptr)
+        {
+            Table->Destroy(Storage);
+            Table = nullptr;
+        }
+    }
+
+private:
+    void MoveFrom(FunctionWrapper& InOther) noexcept
+    {
+        if (InOther.Table != nullptr)
+        {
+            InOther.Table->Move(Storage, InOther.Storage);
+            Table = InOther.Table;
+            InOther.Table = nullptr;
+        }
     }
 
 private:
-    std::unique_ptr<ImplBase> Func;
+    alignas(std::max_align_t) std::byte Storage[InlineSize];
+    const VTable* Table = nullptr;
 };
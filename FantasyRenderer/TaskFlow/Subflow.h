@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <functional>
+#include <type_traits>
+
+#include "Task.h"
+
+/*
+ * 任务在执行时创建子任务用的接口, 只在任务函数执行期间有效.
+ * 任务函数返回后子任务才开始调度, 全部完成后父任务才算完成, 父任务的后继任务也是在这之后才会执行.
+ */
+
+class Subflow
+{
+    friend class TaskFlow;
+public:
+    CLASS_NO_COPY(Subflow)
+
+    explicit Subflow(TaskNode* InParent) : Parent(InParent) {}
+    ~Subflow() = default;
+
+public:
+    template <typename F, typename... Args>
+    requires (sizeof...(Args) > 0 || !std::is_invocable_v<F&, Subflow&>)
+    Task Emplace(F&& InFunc, Args&&... Arguments)
+    {
+        auto Func = std::bind(std::forward<F>(InFunc), std::forward<Args>(Arguments)...);
+        return Task(Parent->EmplaceChild([Func]() { Func(); }));
+    }
+
+    // 子任务也可以是Subflow任务
+    template <typename F>
+    requires std::is_invocable_v<F&, Subflow&>
+    Task Emplace(F&& InFunc)
+    {
+        return Task(BindSubflowFunc(Parent->EmplaceChild(FunctionWrapper()), std::forward<F>(InFunc)));
+    }
+
+    template <typename T, typename... Args>
+    Task Emplace(T* Instance, void(T::*MemberFunc)(Args...), Args... Arguments)
+    {
+        auto Func = [Instance, MemberFunc](Args... FuncArgs) { (Instance->*MemberFunc)(std::forward<Args>(FuncArgs)...); };
+        return Task(Parent->EmplaceChild([=]() { Func(Arguments...); }));
+    }
+
+private:
+    template <typename F>
+    static TaskNode* BindSubflowFunc(TaskNode* InNode, F&& InFunc)
+    {
+        InNode->Func = FunctionWrapper(
+            [Func = std::forward<F>(InFunc), InNode]() mutable
+            {
+                Subflow Flow(InNode);
+                Func(Flow);
+            }
+        );
+        return InNode;
+    }
+
+private:
+    TaskNode* Parent = nullptr;
+};
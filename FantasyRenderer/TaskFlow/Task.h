@@ -30,6 +30,18 @@ public:
         (Node->Precede(Arguments.Node), ...);
     }
 
+    // 需要在TaskFlow::Compile()之前设置
+    void SetPriority(UINT32 InPriority)
+    {
+        Node->SetPriority(InPriority);
+    }
+
+    // 用于TaskTrace中显示
+    void SetName(std::string InName)
+    {
+        Node->SetName(std::move(InName));
+    }
+
 private:
     TaskNode* Node = nullptr;
 };
@@ -1,5 +1,10 @@
 #pragma once
-#include "TaskQueue.h"
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <string>
+#include "BoundedMPMCQueue.h"
+#include "Coroutine.h"
 #include "TaskFlow.h"
 #include "ThreadPool.h"
 #include "../Utility/Exception.h"
@@ -10,6 +15,7 @@ public:
     CLASS_NO_COPY(TaskExecutor)
     
     explicit TaskExecutor(UINT32 InThreadNum = 0) : Pool(std::make_unique<ThreadPool>(InThreadNum)) {}
+    explicit TaskExecutor(const ThreadPoolDesc& InDesc) : Pool(std::make_unique<ThreadPool>(InDesc)) {}
     ~TaskExecutor() = default;
 
 public:
@@ -24,51 +30,360 @@ public:
     {
         ThrowIfFalse(!InFlow.Empty());
 
-        UINT32 TotalUnfinishedTaskNum = InFlow.TotalTaskNum;
+        // 子任务的调度依赖编译后的执行方式
+        if (!InFlow.Compiled && InFlow.bHasSubflow)
+        {
+            InFlow.Compile();
+        }
 
-        const auto& SrcNodes = InFlow.GetSrcNodes();
-        for (const auto& Node : SrcNodes)
+        if (InFlow.Compiled)
         {
-            Notify(Node);
+            RunCompiled(InFlow);
+            return;
         }
+
+        // 编译后执行过的TaskFlow依赖计数都是0, 之后再Emplace()或Precede()也不会恢复, 这里先统一恢复
+        InFlow.ResetDependentTaskNum();
+
+        UINT32 TotalUnfinishedTaskNum = InFlow.TotalTaskNum;
+
+        // 工作线程完成任务后阻塞在NodeQueue.Push()上时不会再取共享队列中的任务, 所以这里不能阻塞在提交上:
+        // 共享队列满时就绪的任务先留在ReadyNodes中, 转而处理已完成的任务, 腾出NodeQueue的空间
+        const auto& SrcNodes = InFlow.GetSrcNodes();
+        std::deque<TaskNode*> ReadyNodes(SrcNodes.begin(), SrcNodes.end());
         
         while (TotalUnfinishedTaskNum > 0)
         {
-            NodeQueue.Wait();
-            TotalUnfinishedTaskNum--;
+            while (!ReadyNodes.empty() && TryNotify(ReadyNodes.front()))
+            {
+                ReadyNodes.pop_front();
+            }
 
-            TaskNode* Node = NodeQueue.Pop();
+            TaskNode* Node = nullptr;
+            if (ReadyNodes.empty())
+            {
+                Node = NodeQueue.Pop();
+            }
+            else if (!NodeQueue.TryPop(Node))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            TotalUnfinishedTaskNum--;
             for (const auto& Successor : Node->Successors)
             {
-                Successor->UnfinishedDependentTaskNum--;
-                if (Successor->UnfinishedDependentTaskNum == 0)
+                if (--Successor->UnfinishedDependentTaskNum == 0)
                 {
-                    Notify(Successor);
-                    Successor->UnfinishedDependentTaskNum = Successor->UnfinishedDependentTaskNumBackup;    // It keeps the TaskFlow's initial state
+                    ReadyNodes.push_back(Successor);
                 }
             }
         }
     }
+    // 线程函数抛出的异常保存在返回的future中, 不会终止程序
     template <typename T, typename... Args>
-    void BeginThread(T* Instance, void(T::*MemberFunc)(Args...), Args... Arguments)
+    std::future<void> BeginThread(T* Instance, void(T::*MemberFunc)(Args...), Args... Arguments)
     {
         auto Func = [Instance, MemberFunc](Args... FuncArgs) { (Instance->*MemberFunc)(std::forward<Args>(FuncArgs)...); };
-        Pool->Submit( [=]() {Func(Arguments...);} );
+        return Pool->Submit( [=]() {Func(Arguments...);} );
+    }
+
+    // co_await Schedule()之后协程在工作线程上继续执行
+    ScheduleAwaiter Schedule()
+    {
+        return ScheduleAwaiter(Pool.get());
+    }
+
+    // 在工作线程上读取整个文件, 等待的协程不占用线程
+    CoTask<std::vector<char>> ReadFileAsync(std::string InPath)
+    {
+        co_await Schedule();
+
+        std::ifstream Input(InPath, std::ios::binary | std::ios::ate);
+        ThrowIfFalse(Input.is_open(), "Open file " + InPath + " failed.");
+
+        std::vector<char> Data(static_cast<size_t>(Input.tellg()));
+        Input.seekg(0, std::ios::beg);
+        Input.read(Data.data(), static_cast<std::streamsize>(Data.size()));
+        ThrowIfFalse(Input.good() || Input.eof(), "Read file " + InPath + " failed.");
+
+        co_return Data;
+    }
+
+    /*
+     * 把[InBegin, InEnd)分成大小为InGrainSize的块, 递归拆分到各工作线程上执行InBody(UINT64 InIndex).
+     * InGrainSize为0时自动选择. 调用线程在等待期间也会执行任务, 可以在任务中嵌套调用.
+     * InBody抛出的第一个异常在所有块结束后重新抛出, 之后还没开始的块不再执行.
+     */
+    template <typename F>
+    void ParallelFor(UINT64 InBegin, UINT64 InEnd, UINT64 InGrainSize, F&& InBody)
+    {
+        if (InBegin >= InEnd) return;
+
+        const UINT64 GrainSize = CalcGrainSize(InEnd - InBegin, InGrainSize);
+        const UINT64 ChunkNum = (InEnd - InBegin + GrainSize - 1) / GrainSize;
+
+        RunChunks(
+            ChunkNum,
+            [&](UINT64 InChunkIndex)
+            {
+                const UINT64 ChunkBegin = InBegin + InChunkIndex * GrainSize;
+                const UINT64 ChunkEnd = InEnd - ChunkBegin > GrainSize ? ChunkBegin + GrainSize : InEnd;
+                for (UINT64 ix = ChunkBegin; ix < ChunkEnd; ++ix)
+                {
+                    InBody(ix);
+                }
+            }
+        );
+    }
+
+    /*
+     * 每块从InIdentity开始用InBody(UINT64 InIndex, T& InOutValue)累积, 再按块的顺序用InJoin(const T&, const T&)合并.
+     * 合并顺序固定, 所以相同的输入和InGrainSize总能得到相同的结果. 异常的处理与ParallelFor()相同.
+     */
+    template <typename T, typename F, typename J>
+    T ParallelReduce(UINT64 InBegin, UINT64 InEnd, UINT64 InGrainSize, const T& InIdentity, F&& InBody, J&& InJoin)
+    {
+        if (InBegin >= InEnd) return InIdentity;
+
+        const UINT64 GrainSize = CalcGrainSize(InEnd - InBegin, InGrainSize);
+        const UINT64 ChunkNum = (InEnd - InBegin + GrainSize - 1) / GrainSize;
+
+        std::vector<T> PartialValues(ChunkNum, InIdentity);
+        RunChunks(
+            ChunkNum,
+            [&](UINT64 InChunkIndex)
+            {
+                const UINT64 ChunkBegin = InBegin + InChunkIndex * GrainSize;
+                const UINT64 ChunkEnd = InEnd - ChunkBegin > GrainSize ? ChunkBegin + GrainSize : InEnd;
+
+                T& Value = PartialValues[InChunkIndex];
+                for (UINT64 ix = ChunkBegin; ix < ChunkEnd; ++ix)
+                {
+                    InBody(ix, Value);
+                }
+            }
+        );
+
+        T Result = InIdentity;
+        for (const auto& Value : PartialValues)
+        {
+            Result = InJoin(Result, Value);
+        }
+        return Result;
     }
 
 private:
-    void Notify(TaskNode* InNode)
+    // 一次ParallelFor()或ParallelReduce()的所有块共享的状态
+    struct ChunkGroup
     {
-        Pool->Submit(
-            [InNode, this]()
+        explicit ChunkGroup(UINT64 InChunkNum) : UnfinishedChunkNum(InChunkNum) {}
+
+        std::atomic<UINT64> UnfinishedChunkNum;
+        std::atomic<bool> bFailed = false;
+        std::exception_ptr Exception;   // 只由把bFailed设为true的线程写入
+        std::mutex FinishMutex;
+        std::condition_variable FinishConditionVariable;
+        bool Finished = false;
+    };
+
+    UINT64 CalcGrainSize(UINT64 InCount, UINT64 InGrainSize) const
+    {
+        if (InGrainSize > 0) return InGrainSize;
+
+        // 每个线程大约分到8块, 便于负载均衡
+        const UINT64 GrainSize = InCount / (Pool->GetThreadNum() * 8);
+        return GrainSize > 0 ? GrainSize : 1;
+    }
+
+    template <typename F>
+    void RunChunks(UINT64 InChunkNum, const F& InChunkFunc)
+    {
+        ChunkGroup Group(InChunkNum);
+        SplitChunks(0, InChunkNum, InChunkFunc, Group);
+
+        // 先帮忙执行待处理的任务, 没有可执行的任务时休眠到最后一块完成
+        while (Group.UnfinishedChunkNum.load(std::memory_order_acquire) > 0 && Pool->TryRunPendingTask()) {}
+        {
+            std::unique_lock Lock(Group.FinishMutex);
+            Group.FinishConditionVariable.wait(Lock, [&Group]() { return Group.Finished; });
+        }
+
+        if (Group.Exception) std::rethrow_exception(Group.Exception);
+    }
+
+    template <typename F>
+    void SplitChunks(UINT64 InBegin, UINT64 InEnd, const F& InChunkFunc, ChunkGroup& InOutGroup)
+    {
+        // 每次把后一半交给其他线程, 自己继续拆分前一半, 直到只剩一块
+        while (InEnd - InBegin > 1)
+        {
+            const UINT64 Middle = InBegin + (InEnd - InBegin) / 2;
+            Pool->SubmitDetached(
+                [this, Middle, InEnd, &InChunkFunc, &InOutGroup]()
+                {
+                    SplitChunks(Middle, InEnd, InChunkFunc, InOutGroup);
+                }
+            );
+            InEnd = Middle;
+        }
+
+        if (!InOutGroup.bFailed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                InChunkFunc(InBegin);
+            }
+            catch (...)
             {
+                if (!InOutGroup.bFailed.exchange(true, std::memory_order_relaxed)) InOutGroup.Exception = std::current_exception();
+            }
+        }
+
+        if (InOutGroup.UnfinishedChunkNum.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // 持锁通知, 保证RunChunks()返回前不会再访问InOutGroup
+            std::lock_guard LockGuard(InOutGroup.FinishMutex);
+            InOutGroup.Finished = true;
+            InOutGroup.FinishConditionVariable.notify_all();
+        }
+    }
+
+    void RunCompiled(TaskFlow& InFlow)
+    {
+        // 上一次Run()结束时依赖计数都被减到了0, 这里一次性恢复
+        InFlow.ResetDependentTaskNum();
+        InFlow.UnfinishedTaskNum.store(InFlow.TotalTaskNum, std::memory_order_relaxed);
+        InFlow.Finished = false;
+
+        if (InFlow.LaunchExecutor != this)
+        {
+            for (const auto& Node : InFlow.GetNodes())
+            {
+                TaskNode* NodePtr = Node.get();
+                NodePtr->Launcher.Func = FunctionWrapper([this, &InFlow, NodePtr]() { RunCompiledNode(InFlow, NodePtr); });
+            }
+            InFlow.LaunchExecutor = this;
+        }
+
+        for (const auto& Node : InFlow.GetCompiledSrcNodes())
+        {
+            Pool->SubmitTask(&Node->Launcher);
+        }
+
+        std::unique_lock Lock(InFlow.FinishMutex);
+        InFlow.FinishConditionVariable.wait(Lock, [&InFlow]() { return InFlow.Finished; });
+    }
+
+    void RunCompiledNode(TaskFlow& InFlow, TaskNode* InNode)
+    {
+        while (InNode != nullptr)
+        {
+            InNode->Children.clear();
+            {
+                TASK_TRACE_SCOPE(InNode->GetName());
                 InNode->Run();
+            }
+
+            if (InNode->Children.empty())
+            {
+                InNode = FinishCompiledNode(InFlow, InNode);
+            }
+            else
+            {
+                // 有子任务时不阻塞等待, 由最后完成的子任务来完成这个节点
+                InNode = LaunchChildren(InFlow, InNode);
+            }
+        }
+    }
+
+    TaskNode* LaunchChildren(TaskFlow& InFlow, TaskNode* InNode)
+    {
+        InNode->UnfinishedChildrenTaskNum.store(static_cast<UINT32>(InNode->Children.size()), std::memory_order_relaxed);
+        for (const auto& Child : InNode->Children)
+        {
+            TaskNode* ChildPtr = Child.get();
+            ChildPtr->Launcher.Func = FunctionWrapper([this, &InFlow, ChildPtr]() { RunCompiledNode(InFlow, ChildPtr); });
+        }
+
+        // 留在当前线程的子任务完成之前InNode不会完成, 所以遍历Children是安全的
+        TaskNode* NextNode = nullptr;
+        for (const auto& Child : InNode->Children)
+        {
+            if (Child->Dependents.empty())
+            {
+                ScheduleReadyNode(NextNode, Child.get());
+            }
+        }
+        return NextNode;
+    }
+
+    // 最先应该执行的就绪任务留在当前线程继续执行, 其余的放入当前工作线程的本地队列
+    void ScheduleReadyNode(TaskNode*& InOutNextNode, TaskNode* InReadyNode)
+    {
+        if (InOutNextNode == nullptr)
+        {
+            InOutNextNode = InReadyNode;
+        }
+        else if (InReadyNode->RunsBefore(InOutNextNode))
+        {
+            Pool->SubmitTask(&InOutNextNode->Launcher);
+            InOutNextNode = InReadyNode;
+        }
+        else
+        {
+            Pool->SubmitTask(&InReadyNode->Launcher);
+        }
+    }
+
+    // 返回需要在当前线程继续执行的节点
+    TaskNode* FinishCompiledNode(TaskFlow& InFlow, TaskNode* InNode)
+    {
+        TaskNode* NextNode = nullptr;
+        for (const auto& Successor : InNode->Successors)
+        {
+            if (Successor->UnfinishedDependentTaskNum.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                ScheduleReadyNode(NextNode, Successor);
+            }
+        }
+
+        if (TaskNode* Parent = InNode->Parent)
+        {
+            if (Parent->UnfinishedChildrenTaskNum.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                if (TaskNode* ParentNextNode = FinishCompiledNode(InFlow, Parent))
+                {
+                    ScheduleReadyNode(NextNode, ParentNextNode);
+                }
+            }
+        }
+        else if (InFlow.UnfinishedTaskNum.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // 持锁通知, 保证Run()返回前不会再访问InFlow
+            std::lock_guard LockGuard(InFlow.FinishMutex);
+            InFlow.Finished = true;
+            InFlow.FinishConditionVariable.notify_all();
+        }
+
+        return NextNode;
+    }
+
+    bool TryNotify(TaskNode* InNode)
+    {
+        return Pool->TrySubmitDetached(
+            [InNode, this]()
+            {
+                {
+                    TASK_TRACE_SCOPE(InNode->GetName());
+                    InNode->Run();
+                }
                 NodeQueue.Push(InNode);     // 入队就说明已经完成了
             }
         );
     }
     
 private:
-    TaskQueue<TaskNode*> NodeQueue;
+    BoundedMPMCQueue<TaskNode*> NodeQueue{ 1024 };
     std::unique_ptr<ThreadPool> Pool;
 };
@@ -1,8 +1,12 @@
 ﻿#pragma once
 
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 
-#include "Task.h"
+#include "Subflow.h"
+
+class TaskExecutor;
 
 class TaskFlow
 {
@@ -16,27 +20,57 @@ public:
 public:
 
     template <typename F, typename... Args>
+    requires (sizeof...(Args) > 0 || !std::is_invocable_v<F&, Subflow&>)
     Task Emplace(F&& InFunc, Args&&... Arguments)
     {
         TotalTaskNum++;
+        Compiled = false;
         
         auto Func = std::bind(std::forward<F>(InFunc), std::forward<Args>(Arguments)...);
         return Task(Graph.EmplaceBack([Func]() { Func(); }));
     }
 
+    // InFunc(Subflow&)在执行时可以创建子任务, 所有子任务完成后这个任务才算完成
+    template <typename F>
+    requires std::is_invocable_v<F&, Subflow&>
+    Task Emplace(F&& InFunc)
+    {
+        TotalTaskNum++;
+        Compiled = false;
+        bHasSubflow = true;
+
+        return Task(Subflow::BindSubflowFunc(Graph.EmplaceBack(FunctionWrapper()), std::forward<F>(InFunc)));
+    }
+
     template <typename T, typename... Args>
     Task Emplace(T* Instance, void(T::*MemberFunc)(Args...), Args... Arguments)
     {
         TotalTaskNum++;
+        Compiled = false;
         
         auto Func = [Instance, MemberFunc](Args... FuncArgs) { (Instance->*MemberFunc)(std::forward<Args>(FuncArgs)...); };
         return Task(Graph.EmplaceBack([=]() { Func(Arguments...); }));
     }
 
+    /*
+     * 在所有任务和依赖关系都建立好之后调用, 之后可以反复Run().
+     * 编译后的TaskFlow由工作线程自己递减后继任务的依赖计数并直接提交就绪的后继任务, 不再经过TaskExecutor的分发线程.
+     * 同时计算每个节点的关键路径长度, 就绪的任务按优先级和关键路径长度调度; bCriticalPathOrder为false时只按优先级和添加顺序调度.
+     */
+    void Compile(bool bCriticalPathOrder = true)
+    {
+        Graph.FindSrcNode();
+        Graph.ComputeCriticalPath(bCriticalPathOrder);
+        Compiled = true;
+        LaunchExecutor = nullptr;
+    }
+
     void Reset()
     {
         Graph.Clear();
         TotalTaskNum = 0;
+        Compiled = false;
+        bHasSubflow = false;
     }
 
 private:
@@ -45,6 +79,21 @@ private:
         return Graph.FindSrcNode();
     }
     
+    const std::vector<std::unique_ptr<TaskNode>>& GetNodes() const
+    {
+        return Graph.Nodes;
+    }
+
+    const std::vector<TaskNode*>& GetCompiledSrcNodes() const
+    {
+        return Graph.SrcNodes;
+    }
+
+    void ResetDependentTaskNum()
+    {
+        Graph.ResetDependentTaskNum();
+    }
+    
     bool Empty() const
     {
         return TotalTaskNum == 0;
@@ -54,4 +103,12 @@ private:
     TaskGraph Graph;
 
     UINT32 TotalTaskNum = 0;
+
+    bool Compiled = false;
+    bool bHasSubflow = false;
+    const TaskExecutor* LaunchExecutor = nullptr;    // TaskNode::Launcher是为哪个TaskExecutor创建的
+    std::atomic<UINT32> UnfinishedTaskNum = 0;
+    std::mutex FinishMutex;
+    std::condition_variable FinishConditionVariable;
+    bool Finished = false;
 };
@@ -1,11 +1,16 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <future>
 #include "../Utility/Macros.h"
+#include "../Utility/Exception.h"
+#include "ThreadPool.h"
 
 class TaskNode
 {
     friend class TaskGraph;
     friend class TaskExecutor;
+    friend class Subflow;
 public:
     CLASS_NO_COPY(TaskNode)
     
@@ -26,24 +31,53 @@ public:
         Func();
     }
 
-    /*void AddChildren(TaskNode* InNode)
+    void SetPriority(UINT32 InPriority)
     {
-        Children.push_back(InNode);
-        InNode->Parent = this;
-        UnfinishedChildrenTaskNum++;
-    }*/
+        Priority = InPriority;
+    }
+
+    void SetName(std::string InName)
+    {
+        Name = std::move(InName);
+    }
+
+    const char* GetName() const
+    {
+        return Name.empty() ? "Task" : Name.c_str();
+    }
+
+    // 优先级高的先执行, 优先级相同时剩余关键路径长的先执行
+    bool RunsBefore(const TaskNode* InOther) const
+    {
+        if (Priority != InOther->Priority) return Priority > InOther->Priority;
+        return CriticalPathLength > InOther->CriticalPathLength;
+    }
+
+    // 只能在自己的任务函数执行期间调用
+    TaskNode* EmplaceChild(FunctionWrapper InFunc)
+    {
+        Children.emplace_back(std::make_unique<TaskNode>(std::move(InFunc)));
+        Children.back()->Parent = this;
+        return Children.back().get();
+    }
     
 private:
     std::vector<TaskNode*> Successors;
     std::vector<TaskNode*> Dependents;
-    UINT32 UnfinishedDependentTaskNum = 0;
+    std::atomic<UINT32> UnfinishedDependentTaskNum = 0;
     UINT32 UnfinishedDependentTaskNumBackup = 0;
 
-    /*TaskNode* Parent = nullptr;
-    std::vector<TaskNode*> Children;
-    UINT32 UnfinishedChildrenTaskNum = 0;*/
+    UINT32 Priority = 0;
+    UINT32 CriticalPathLength = 0;     // 从这个节点到汇点的最长路径上的节点数, 在TaskFlow::Compile()中计算
 
+    // Subflow在运行时创建的子任务, 每次执行前清空
+    TaskNode* Parent = nullptr;
+    std::vector<std::unique_ptr<TaskNode>> Children;
+    std::atomic<UINT32> UnfinishedChildrenTaskNum = 0;
+
+    std::string Name;
     FunctionWrapper Func;
+    ThreadPoolTask Launcher;    // 编译后的TaskFlow用它提交自己, 避免每次运行都分配任务
 };
 
 class TaskGraph
@@ -71,6 +105,14 @@ public:
         Nodes.clear();
     }
 
+    void ResetDependentTaskNum()
+    {
+        for (const auto& Node : Nodes)
+        {
+            Node->UnfinishedDependentTaskNum.store(Node->UnfinishedDependentTaskNumBackup, std::memory_order_relaxed);
+        }
+    }
+
 private:
     std::vector<TaskNode*>& FindSrcNode()
     {
@@ -85,6 +127,50 @@ private:
         return SrcNodes;
     }
 
+    void ComputeCriticalPath(bool bCriticalPathOrder)
+    {
+        // 拓扑排序
+        std::vector<TaskNode*> SortedNodes;
+        std::vector<UINT32> DependentNums(Nodes.size());
+        SortedNodes.reserve(Nodes.size());
+        for (UINT32 ix = 0; ix < Nodes.size(); ++ix)
+        {
+            Nodes[ix]->CriticalPathLength = ix;     // 暂时借用作为下标
+            DependentNums[ix] = Nodes[ix]->UnfinishedDependentTaskNumBackup;
+            if (DependentNums[ix] == 0) SortedNodes.push_back(Nodes[ix].get());
+        }
+        for (UINT32 ix = 0; ix < SortedNodes.size(); ++ix)
+        {
+            for (const auto& Successor : SortedNodes[ix]->Successors)
+            {
+                if (--DependentNums[Successor->CriticalPathLength] == 0) SortedNodes.push_back(Successor);
+            }
+        }
+        ThrowIfFalse(SortedNodes.size() == Nodes.size(), "TaskFlow contains a cycle.");
+
+        for (auto Iterator = SortedNodes.rbegin(); Iterator != SortedNodes.rend(); ++Iterator)
+        {
+            TaskNode* Node = *Iterator;
+            UINT32 SuccessorPathLength = 0;
+            for (const auto& Successor : Node->Successors)
+            {
+                if (Successor->CriticalPathLength > SuccessorPathLength) SuccessorPathLength = Successor->CriticalPathLength;
+            }
+            Node->CriticalPathLength = SuccessorPathLength + 1;
+        }
+        if (!bCriticalPathOrder)
+        {
+            for (const auto& Node : Nodes) Node->CriticalPathLength = 0;
+        }
+
+        // 后继节点按从低到高排列, 执行时最后就绪的(最高的)留在当前线程, 次高的在本地队列顶端
+        for (const auto& Node : Nodes)
+        {
+            std::ranges::stable_sort(Node->Successors, [](const TaskNode* InLhs, const TaskNode* InRhs) { return InRhs->RunsBefore(InLhs); });
+        }
+        std::ranges::stable_sort(SrcNodes, [](const TaskNode* InLhs, const TaskNode* InRhs) { return InLhs->RunsBefore(InRhs); });
+    }
+
 private:
     std::vector<TaskNode*> SrcNodes;
     std::vector<std::unique_ptr<TaskNode>> Nodes;
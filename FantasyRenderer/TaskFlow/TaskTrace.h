@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#include "../Utility/Exception.h"
+#include "../Utility/Macros.h"
+
+/*
+ * 任务执行的跟踪记录, 可以导出为Chrome trace JSON(chrome://tracing 或 Perfetto).
+ * 每个线程写自己的环形缓冲, 写满后覆盖最旧的记录.
+ * TASK_TRACE_ENABLE为0时下面的宏全部为空; 为1但运行时没有调用TaskTracer::SetEnabled(true)时, 每处只多一次原子读.
+ * 默认只在Debug构建中为1, Release构建需要跟踪时在工程中定义TASK_TRACE_ENABLE=1.
+ */
+
+#ifndef TASK_TRACE_ENABLE
+#ifdef _DEBUG
+#define TASK_TRACE_ENABLE 1
+#else
+#define TASK_TRACE_ENABLE 0
+#endif
+#endif
+
+enum class ETaskTraceEventType : UINT8
+{
+    Task,
+    Idle,
+    Steal
+};
+
+struct TaskTraceEvent
+{
+    char Name[48];
+    UINT64 BeginTime;   // 微秒
+    UINT64 EndTime;
+    ETaskTraceEventType Type;
+    UINT32 Value;       // Steal时为被窃取的线程下标
+};
+
+class TaskTracer
+{
+    static constexpr UINT64 BufferEventNum = 1 << 14;
+
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(UINT32 InThreadId, std::string InThreadName)
+            : ThreadId(InThreadId), ThreadName(std::move(InThreadName)), Events(BufferEventNum)
+        {}
+
+        UINT32 ThreadId;
+        std::string ThreadName;
+        std::vector<TaskTraceEvent> Events;
+        std::atomic<UINT64> WriteIndex = 0;
+    };
+
+public:
+    CLASS_NO_COPY(TaskTracer)
+
+    TaskTracer() = default;
+    ~TaskTracer() = default;
+
+public:
+    static void SetEnabled(bool bInEnabled)
+    {
+        bEnabled.store(bInEnabled, std::memory_order_relaxed);
+    }
+
+    static bool IsEnabled()
+    {
+        return bEnabled.load(std::memory_order_relaxed);
+    }
+
+    static UINT64 Now()
+    {
+        return static_cast<UINT64>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - StartTime
+        ).count());
+    }
+
+    // 需要在该线程第一次记录之前调用
+    static void SetThreadName(std::string InName)
+    {
+        ThreadName = std::move(InName);
+    }
+
+    static void Record(ETaskTraceEventType InType, const char* InName, UINT64 InBeginTime, UINT64 InEndTime, UINT32 InValue = 0)
+    {
+        ThreadBuffer* Buffer = GetThreadBuffer();
+
+        const UINT64 Index = Buffer->WriteIndex.load(std::memory_order_relaxed);
+        TaskTraceEvent& Event = Buffer->Events[Index & (BufferEventNum - 1)];
+        const size_t NameLength = strnlen(InName, sizeof(Event.Name) - 1);    // 过长的名字截断
+        memcpy(Event.Name, InName, NameLength);
+        Event.Name[NameLength] = '\0';
+        Event.BeginTime = InBeginTime;
+        Event.EndTime = InEndTime;
+        Event.Type = InType;
+        Event.Value = InValue;
+
+        Buffer->WriteIndex.store(Index + 1, std::memory_order_release);
+    }
+
+    // 导出时正在写入的记录可能不完整, 最好先SetEnabled(false)
+    static void ExportChromeTrace(const std::string& InFilePath)
+    {
+        std::ofstream Output(InFilePath, std::ios::trunc);
+        ThrowIfFalse(Output.is_open(), "Open trace file " + InFilePath + " failed.");
+
+        Output << "{\"traceEvents\":[\n";
+
+        bool bFirstEvent = true;
+        auto WriteSeparator = [&]()
+        {
+            if (!bFirstEvent) Output << ",\n";
+            bFirstEvent = false;
+        };
+
+        std::lock_guard LockGuard(BuffersMutex);
+        for (const auto& Buffer : Buffers)
+        {
+            WriteSeparator();
+            Output << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << Buffer->ThreadId
+                   << R"(,"args":{"name":")" << EscapeString(Buffer->ThreadName.c_str()) << "\"}}";
+
+            const UINT64 EndIndex = Buffer->WriteIndex.load(std::memory_order_acquire);
+            const UINT64 BeginIndex = EndIndex > BufferEventNum ? EndIndex - BufferEventNum : 0;
+            for (UINT64 ix = BeginIndex; ix < EndIndex; ++ix)
+            {
+                const TaskTraceEvent& Event = Buffer->Events[ix & (BufferEventNum - 1)];
+
+                WriteSeparator();
+                switch (Event.Type)
+                {
+                case ETaskTraceEventType::Task:
+                case ETaskTraceEventType::Idle:
+                    Output << R"({"name":")" << EscapeString(Event.Name)
+                           << R"(","cat":")" << (Event.Type == ETaskTraceEventType::Task ? "Task" : "Idle")
+                           << R"(","ph":"X","pid":0,"tid":)" << Buffer->ThreadId
+                           << R"(,"ts":)" << Event.BeginTime
+                           << R"(,"dur":)" << Event.EndTime - Event.BeginTime << "}";
+                    break;
+                case ETaskTraceEventType::Steal:
+                    Output << R"({"name":"Steal","cat":"Steal","ph":"i","s":"t","pid":0,"tid":)" << Buffer->ThreadId
+                           << R"(,"ts":)" << Event.BeginTime
+                           << R"(,"args":{"Victim":)" << Event.Value << "}}";
+                    break;
+                }
+            }
+        }
+
+        Output << "\n]}\n";
+    }
+
+private:
+    static ThreadBuffer* GetThreadBuffer()
+    {
+        if (LocalBuffer == nullptr)
+        {
+            std::lock_guard LockGuard(BuffersMutex);
+
+            const UINT32 ThreadId = static_cast<UINT32>(Buffers.size());
+            std::string Name = ThreadName.empty() ? "Thread " + std::to_string(ThreadId) : ThreadName;
+            Buffers.emplace_back(std::make_unique<ThreadBuffer>(ThreadId, std::move(Name)));
+            LocalBuffer = Buffers.back().get();
+        }
+        return LocalBuffer;
+    }
+
+    static std::string EscapeString(const char* InString)
+    {
+        std::string Output;
+        for (const char* Char = InString; *Char != '\0'; ++Char)
+        {
+            if (*Char == '"' || *Char == '\\') Output.push_back('\\');
+            if (static_cast<unsigned char>(*Char) >= 0x20) Output.push_back(*Char);
+        }
+        return Output;
+    }
+
+private:
+    inline static std::atomic<bool> bEnabled = false;
+    inline static const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+
+    // 线程结束后缓冲仍然保留, 以便导出
+    inline static std::mutex BuffersMutex;
+    inline static std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+
+    inline static thread_local ThreadBuffer* LocalBuffer = nullptr;
+    inline static thread_local std::string ThreadName;
+};
+
+
+class TaskTraceScope
+{
+public:
+    CLASS_NO_COPY(TaskTraceScope)
+
+    TaskTraceScope(ETaskTraceEventType InType, const char* InName)
+        : Type(InType), Name(InName), BeginTime(TaskTracer::IsEnabled() ? TaskTracer::Now() : INVALID_TIME)
+    {}
+
+    ~TaskTraceScope()
+    {
+        if (BeginTime != INVALID_TIME)
+        {
+            TaskTracer::Record(Type, Name, BeginTime, TaskTracer::Now());
+        }
+    }
+
+private:
+    static constexpr UINT64 INVALID_TIME = ~0ull;
+
+    ETaskTraceEventType Type;
+    const char* Name;
+    UINT64 BeginTime;
+};
+
+
+#if TASK_TRACE_ENABLE
+
+#define TASK_TRACE_CONCAT_IMPL(A, B) A##B
+#define TASK_TRACE_CONCAT(A, B) TASK_TRACE_CONCAT_IMPL(A, B)
+
+#define TASK_TRACE_SCOPE(Name) TaskTraceScope TASK_TRACE_CONCAT(TaskTraceScope, __LINE__)(ETaskTraceEventType::Task, Name)
+#define TASK_TRACE_IDLE_SCOPE() TaskTraceScope TASK_TRACE_CONCAT(TaskTraceScope, __LINE__)(ETaskTraceEventType::Idle, "Idle")
+#define TASK_TRACE_STEAL(VictimIndex)                                                                       \
+    do                                                                                                      \
+    {                                                                                                       \
+        if (TaskTracer::IsEnabled())                                                                        \
+        {                                                                                                   \
+            const UINT64 TaskTraceTime = TaskTracer::Now();                                                 \
+            TaskTracer::Record(ETaskTraceEventType::Steal, "Steal", TaskTraceTime, TaskTraceTime, static_cast<UINT32>(VictimIndex)); \
+        }                                                                                                   \
+    } while (false)
+#define TASK_TRACE_THREAD_NAME(Name) TaskTracer::SetThreadName(Name)
+
+#else
+
+#define TASK_TRACE_SCOPE(Name)
+#define TASK_TRACE_IDLE_SCOPE()
+#define TASK_TRACE_STEAL(VictimIndex)
+#define TASK_TRACE_THREAD_NAME(Name)
+
+#endif
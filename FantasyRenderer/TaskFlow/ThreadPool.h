@@ -1,30 +1,108 @@
 ﻿#pragma once
 
+#include <condition_variable>
 #include <future>
 #include <queue>
+#include <string>
 #include <vector>
 #include <windows.h>
 
-#include "ConcurrentQueue.h"
+#include "BoundedMPMCQueue.h"
 #include "FunctionWrapper.h"
+#include "TaskTrace.h"
+#include "../MultiThreading/CPUTopology.h"
+#include "../MultiThreading/LockFreeQueue.h"
+
+/*
+ * 线程池队列中的任务.
+ * bPoolOwned为true的任务由线程池创建, 执行完后由线程池回收复用; 否则由提交者持有, 提交者需保证执行完之前一直有效.
+ */
+struct ThreadPoolTask
+{
+    FunctionWrapper Func;
+    bool bPoolOwned = false;
+};
+
+enum class EThreadAffinityMode : UINT8
+{
+    None,       // 由系统调度
+    Core,       // 每个线程绑定到一个逻辑核, 优先占满物理核
+    NumaNode    // 所有线程绑定到NumaNode上的逻辑核
+};
+
+struct ThreadPoolDesc
+{
+    UINT32 ThreadNum = 0;           // 为0时使用物理核数, NumaNode模式下为该节点的物理核数
+    std::string Name = "TaskWorker";
+    EThreadAffinityMode AffinityMode = EThreadAffinityMode::None;
+    UINT32 FirstCore = 0;           // Core模式下第ix个线程绑定到CPUTopology::LogicalCoreOrder[FirstCore + ix]
+    UINT32 NumaNode = 0;
+};
+
+struct ThreadPoolStats
+{
+    UINT64 SpinNum = 0;     // 空闲时自旋查找任务的次数
+    UINT64 ParkNum = 0;     // 进入休眠的次数
+    UINT64 WakeupNum = 0;   // 从休眠中被唤醒的次数
+};
 
 class ThreadPool
 {
+    static constexpr UINT32 WorkerSpinMinNum = 16;
+    static constexpr UINT32 WorkerSpinMaxNum = 1024;
+    static constexpr size_t WorkerFreeTaskMaxNum = 256;
+    static constexpr size_t SharedQueueCapacity = 4096;
+
+    struct alignas(64) WorkerData
+    {
+        ~WorkerData()
+        {
+            for (const auto Task : FreeTasks) delete Task;
+        }
+
+        LockFreeQueue<ThreadPoolTask*> Queue;
+        std::vector<ThreadPoolTask*> FreeTasks;   // 只由工作线程自己访问
+        UINT32 SpinLimit = WorkerSpinMinNum;
+
+        std::atomic<UINT64> SpinNum = 0;
+        std::atomic<UINT64> ParkNum = 0;
+        std::atomic<UINT64> WakeupNum = 0;
+    };
+
 public:
     CLASS_NO_COPY(ThreadPool)
-        
-    ThreadPool(UINT32 InThreadNum = 0)
+
+    explicit ThreadPool(UINT32 InThreadNum = 0) : ThreadPool(ThreadPoolDesc{ .ThreadNum = InThreadNum }) {}
+
+    explicit ThreadPool(const ThreadPoolDesc& InDesc) : Desc(InDesc)
     {
-        size_t MaxThreadNum = std::thread::hardware_concurrency() / 4;
-        if (InThreadNum > 0) MaxThreadNum = InThreadNum;
-        
+        const CPUTopology& Topology = CPUTopology::Get();
+        if (Desc.NumaNode >= Topology.NumaNodeCores.size()) Desc.NumaNode = 0;
+
+        size_t MaxThreadNum = Desc.ThreadNum;
+        if (MaxThreadNum == 0)
+        {
+            MaxThreadNum = Topology.PhysicalCoreNum;
+            if (Desc.AffinityMode == EThreadAffinityMode::NumaNode)
+            {
+                // 按超线程比例换算成该节点的物理核数
+                MaxThreadNum = Topology.NumaNodeCores[Desc.NumaNode].size() * Topology.PhysicalCoreNum / Topology.LogicalCoreNum;
+            }
+        }
+        if (MaxThreadNum == 0) MaxThreadNum = 1;
+
+        for (size_t ix = 0; ix < MaxThreadNum; ++ix)
+        {
+            Workers.emplace_back(std::make_unique<WorkerData>());
+        }
+
         try
         {
             for (size_t ix = 0; ix < MaxThreadNum; ++ix)
             {
                 Threads.emplace_back(&ThreadPool::WorkerThread, this, ix);
             }
-        
+
         }
         catch (...)
         {
@@ -42,36 +120,294 @@ public:
     auto Submit(F&& InFunc, Args&&... Arguments) -> std::future<decltype(InFunc(Arguments...))>
     {
         using ReturnType = decltype(InFunc(Arguments...));
-        
-        auto Task = std::make_shared<std::packaged_task<ReturnType()>>(std::bind(std::forward<F>(InFunc), std::forward<Args>(Arguments)...));
-        std::future<ReturnType> Result(Task->get_future());
 
-        PoolTaskQueue.Push([Task]() { (*Task)(); });
+        std::packaged_task<ReturnType()> Task(
+            [Func = std::forward<F>(InFunc), ...FuncArgs = std::forward<Args>(Arguments)]() mutable { return Func(FuncArgs...); }
+        );
+        std::future<ReturnType> Result(Task.get_future());
+
+        Enqueue(AllocateTask([Task = std::move(Task)]() mutable { Task(); }));
 
         return Result;
     }
 
+    // 不需要返回值的任务, 不创建future. 任务中没有被捕获的异常会终止程序, 可能抛出异常的任务需要用Submit()
+    template <typename F, typename... Args>
+    void SubmitDetached(F&& InFunc, Args&&... Arguments)
+    {
+        if constexpr (sizeof...(Args) == 0)
+        {
+            Enqueue(AllocateTask(std::forward<F>(InFunc)));
+        }
+        else
+        {
+            Enqueue(AllocateTask(
+                [Func = std::forward<F>(InFunc), ...FuncArgs = std::forward<Args>(Arguments)]() mutable { Func(FuncArgs...); }
+            ));
+        }
+    }
+
+    // 与SubmitDetached()相同, 但共享队列满时不等待, 不提交并返回false
+    template <typename F>
+    bool TrySubmitDetached(F&& InFunc)
+    {
+        ThreadPoolTask* Task = AllocateTask(std::forward<F>(InFunc));
+        if (TryEnqueue(Task)) return true;
+
+        RecycleTask(Task);
+        return false;
+    }
+
+    // 提交由调用者持有的任务, 在它执行完之前不能再次提交
+    void SubmitTask(ThreadPoolTask* InTask)
+    {
+        Enqueue(InTask);
+    }
+
+    // 在当前线程执行一个待处理的任务, 用于等待时帮忙, 没有任务时返回false
+    bool TryRunPendingTask()
+    {
+        ThreadPoolTask* Task = nullptr;
+        if (WorkerPool == this)
+        {
+            Task = TryGetTask(WorkerIndex, HelperSeed);
+        }
+        else if (!SharedQueue.TryPop(Task))
+        {
+            Task = TrySteal(Workers.size(), HelperSeed);
+        }
+
+        if (Task == nullptr) return false;
+        RunTask(Task);
+        return true;
+    }
+
+    size_t GetThreadNum() const { return Threads.size(); }
+
+    ThreadPoolStats GetStats() const
+    {
+        ThreadPoolStats Stats;
+        for (const auto& Worker : Workers)
+        {
+            Stats.SpinNum += Worker->SpinNum.load(std::memory_order_relaxed);
+            Stats.ParkNum += Worker->ParkNum.load(std::memory_order_relaxed);
+            Stats.WakeupNum += Worker->WakeupNum.load(std::memory_order_relaxed);
+        }
+        return Stats;
+    }
+
 private:
+    template <typename F>
+    ThreadPoolTask* AllocateTask(F&& InFunc)
+    {
+        // 工作线程优先复用自己缓存的任务对象
+        ThreadPoolTask* Task = nullptr;
+        if (WorkerPool == this && !Workers[WorkerIndex]->FreeTasks.empty())
+        {
+            Task = Workers[WorkerIndex]->FreeTasks.back();
+            Workers[WorkerIndex]->FreeTasks.pop_back();
+        }
+        else
+        {
+            Task = new ThreadPoolTask();
+            Task->bPoolOwned = true;
+        }
+        Task->Func = FunctionWrapper(std::forward<F>(InFunc));
+        return Task;
+    }
+
+    void RunTask(ThreadPoolTask* InTask)
+    {
+        // 不归线程池所有的任务执行完后可能已经被提交者释放, 需要提前读取
+        const bool bPoolOwned = InTask->bPoolOwned;
+        InTask->Func();
+        if (bPoolOwned) RecycleTask(InTask);
+    }
+
+    void RecycleTask(ThreadPoolTask* InTask)
+    {
+        InTask->Func.Reset();
+        if (WorkerPool == this && Workers[WorkerIndex]->FreeTasks.size() < WorkerFreeTaskMaxNum)
+        {
+            Workers[WorkerIndex]->FreeTasks.push_back(InTask);
+        }
+        else
+        {
+            delete InTask;
+        }
+    }
+
+    void Enqueue(ThreadPoolTask* InTask)
+    {
+        // 工作线程提交的任务直接放入自己的本地队列, 其他线程提交的任务放入共享队列, 共享队列满时等待工作线程取走任务
+        if (WorkerPool == this)
+        {
+            Workers[WorkerIndex]->Queue.Push(InTask);
+        }
+        else
+        {
+            SharedQueue.Push(InTask);
+        }
+        WakeOne();
+    }
+
+    bool TryEnqueue(ThreadPoolTask* InTask)
+    {
+        if (WorkerPool == this)
+        {
+            Workers[WorkerIndex]->Queue.Push(InTask);
+        }
+        else if (!SharedQueue.TryPush(InTask))
+        {
+            return false;
+        }
+        WakeOne();
+        return true;
+    }
+
+    void WakeOne()
+    {
+        // 与Park()中的SleepingNum++构成Dekker式同步: 要么这里看到休眠的线程, 要么休眠前的线程看到新任务
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (SleepingNum.load(std::memory_order_relaxed) == 0) return;
+
+        {
+            std::lock_guard LockGuard(ParkMutex);
+            if (WakeupTokenNum >= SleepingNum.load(std::memory_order_relaxed)) return;
+            WakeupTokenNum++;
+        }
+        ParkConditionVariable.notify_one();
+    }
+
+    bool HasPendingTask() const
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!SharedQueue.Empty()) return true;
+        for (const auto& Worker : Workers)
+        {
+            if (!Worker->Queue.Empty()) return true;
+        }
+        return false;
+    }
+
+    void Park(WorkerData& InWorker)
+    {
+        std::unique_lock Lock(ParkMutex);
+        SleepingNum.fetch_add(1, std::memory_order_seq_cst);
+
+        if (!Done && !HasPendingTask())
+        {
+            InWorker.ParkNum.fetch_add(1, std::memory_order_relaxed);
+            TASK_TRACE_IDLE_SCOPE();
+            ParkConditionVariable.wait(Lock, [this]() { return WakeupTokenNum > 0 || Done; });
+            if (WakeupTokenNum > 0) WakeupTokenNum--;
+            InWorker.WakeupNum.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        SleepingNum.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    ThreadPoolTask* TryGetTask(size_t InIndex, UINT32& InOutSeed)
+    {
+        if (ThreadPoolTask* Task = Workers[InIndex]->Queue.Pop()) return Task;
+
+        ThreadPoolTask* Task = nullptr;
+        if (SharedQueue.TryPop(Task)) return Task;
+
+        return TrySteal(InIndex, InOutSeed);
+    }
+
+    ThreadPoolTask* TrySteal(size_t InIndex, UINT32& InOutSeed)
+    {
+        const size_t QueueNum = Workers.size();
+        if (QueueNum == 0) return nullptr;
+
+        // xorshift32, 随机选择开始窃取的线程
+        InOutSeed ^= InOutSeed << 13;
+        InOutSeed ^= InOutSeed >> 17;
+        InOutSeed ^= InOutSeed << 5;
+
+        const size_t StartIndex = InOutSeed % QueueNum;
+        for (size_t ix = 0; ix < QueueNum; ++ix)
+        {
+            const size_t VictimIndex = (StartIndex + ix) % QueueNum;
+            if (VictimIndex == InIndex) continue;
+
+            if (ThreadPoolTask* Task = Workers[VictimIndex]->Queue.Steal())
+            {
+                TASK_TRACE_STEAL(VictimIndex);
+                return Task;
+            }
+        }
+        return nullptr;
+    }
+
+    void PlaceWorkerThread(size_t InIndex) const
+    {
+        const std::string ThreadName = Desc.Name + " " + std::to_string(InIndex);
+        SetCurrentThreadName(ThreadName);
+        TASK_TRACE_THREAD_NAME(ThreadName);
+
+        const CPUTopology& Topology = CPUTopology::Get();
+        switch (Desc.AffinityMode)
+        {
+        case EThreadAffinityMode::Core:
+            SetCurrentThreadAffinity({ Topology.LogicalCoreOrder[(Desc.FirstCore + InIndex) % Topology.LogicalCoreNum] });
+            break;
+        case EThreadAffinityMode::NumaNode:
+            SetCurrentThreadAffinity(Topology.NumaNodeCores[Desc.NumaNode]);
+            break;
+        case EThreadAffinityMode::None:
+            break;
+        }
+    }
 
     void WorkerThread(size_t InIndex)
     {
+        WorkerPool = this;
+        WorkerIndex = InIndex;
+        PlaceWorkerThread(InIndex);
+
+        WorkerData& Worker = *Workers[InIndex];
+
+        UINT32 Seed = static_cast<UINT32>(InIndex) * 2654435761u + 1;
+        UINT32 SpinCount = 0;
         while (!Done)
         {
-            FunctionWrapper Task;
-            if (PoolTaskQueue.TryPop(Task))
+            if (ThreadPoolTask* Task = TryGetTask(InIndex, Seed))
             {
-                Task();
+                // 自旋期间等到了任务, 说明任务来得频繁, 下次多自旋一会
+                if (SpinCount > 0 && Worker.SpinLimit < WorkerSpinMaxNum) Worker.SpinLimit <<= 1;
+                SpinCount = 0;
+
+                RunTask(Task);
             }
-            else
+            else if (SpinCount < Worker.SpinLimit)
             {
+                SpinCount++;
+                Worker.SpinNum.fetch_add(1, std::memory_order_relaxed);
                 std::this_thread::yield();
             }
+            else
+            {
+                if (Worker.SpinLimit > WorkerSpinMinNum) Worker.SpinLimit >>= 1;
+                SpinCount = 0;
+
+                Park(Worker);
+            }
         }
+
+        WorkerPool = nullptr;
     }
 
     void FinishPool()
     {
         Done = true;
+        {
+            std::lock_guard LockGuard(ParkMutex);
+        }
+        ParkConditionVariable.notify_all();
+
         for (auto& Thread : Threads)
         {
             if (Thread.joinable())
@@ -79,11 +415,36 @@ private:
                 Thread.join();
             }
         }
+
+        // 释放没有被执行的任务
+        for (const auto& Worker : Workers)
+        {
+            while (ThreadPoolTask* Task = Worker->Queue.Steal())
+            {
+                if (Task->bPoolOwned) delete Task;
+            }
+        }
+        ThreadPoolTask* Task = nullptr;
+        while (SharedQueue.TryPop(Task))
+        {
+            if (Task->bPoolOwned) delete Task;
+        }
     }
 
 private:
+    ThreadPoolDesc Desc;
     std::atomic<bool> Done = false;
 
     std::vector<std::thread> Threads;
-    ConcurrentQueue<FunctionWrapper> PoolTaskQueue;
+    std::vector<std::unique_ptr<WorkerData>> Workers;
+    BoundedMPMCQueue<ThreadPoolTask*> SharedQueue{ SharedQueueCapacity };
+
+    std::mutex ParkMutex;
+    std::condition_variable ParkConditionVariable;
+    std::atomic<UINT32> SleepingNum = 0;
+    UINT32 WakeupTokenNum = 0;
+
+    inline static thread_local ThreadPool* WorkerPool = nullptr;
+    inline static thread_local size_t WorkerIndex = 0;
+    inline static thread_local UINT32 HelperSeed = 2463534242u;
 };
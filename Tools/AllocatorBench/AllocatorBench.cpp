@@ -0,0 +1,497 @@
+﻿#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../FantasyRenderer/MultiThreading/ConcurrentBitmapBuddyAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentBuddyAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentFreeListAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentIndexAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentRingAllocator.h"
+
+/*
+ * MultiThreading中并发分配器的多线程压力测试和吞吐量测试, 只用CPU.
+ * buddy: 多个线程反复分配和释放placed buffer大小(64KB~4MB)的块, 比较位图伙伴分配器和链表伙伴分配器,
+ *        同时检查分配出的块没有重叠; 再用同样大小的块占满整个空间反复释放和分配, 这时任何一次分配失败都是错误.
+ * index: 描述符下标的分配和释放, 比较ConcurrentIndexAllocator和ConcurrentFreeListAllocator在1到n个线程下的吞吐量.
+ *        容量正好等于所有线程同时持有的下标数, 下标在其他线程的缓存中时也必须能分配到; 线程退出后缓存中的下标必须全部还回.
+ * ring:  多个线程按帧在ConcurrentRingAllocator上分配1~16大小的区间(描述符表, 常量缓冲), 每帧结束时MarkFrame, 
+ *        两帧之后RetireFrames, 检查同时存活的区间没有重叠, 容量足够时没有失败, 全部回收后已用大小为0. 线程数从1倍增到n.
+ *
+ * 用法: AllocatorBench <buddy|index|ring> [--threads <n>] [--ops <n>]
+ */
+
+struct BenchConfig
+{
+    UINT32 ThreadNum = 8;
+    UINT32 OpNum = 100000;     // 每个线程的分配次数
+};
+
+static double ElapsedMs(std::chrono::steady_clock::time_point InBegin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - InBegin).count();
+}
+
+// 在InThreadNum个线程上同时执行InFunc(UINT32 InThreadIndex), 返回耗时
+template <typename F>
+static double RunThreads(UINT32 InThreadNum, const F& InFunc)
+{
+    std::atomic<bool> bStart = false;
+    std::vector<std::thread> Threads;
+    for (UINT32 ix = 0; ix < InThreadNum; ++ix)
+    {
+        Threads.emplace_back(
+            [&bStart, &InFunc, ix]()
+            {
+                while (!bStart.load(std::memory_order_acquire)) std::this_thread::yield();
+                InFunc(ix);
+            }
+        );
+    }
+
+    const auto Begin = std::chrono::steady_clock::now();
+    bStart.store(true, std::memory_order_release);
+    for (auto& Thread : Threads) Thread.join();
+    return ElapsedMs(Begin);
+}
+
+// 按InPageSize记录每一页属于哪个线程, 用来发现重叠的分配
+class OverlapChecker
+{
+public:
+    OverlapChecker(size_t InCapacity, size_t InPageSize) : PageSize(InPageSize), PageNum(InCapacity / InPageSize), Owners(std::make_unique<std::atomic<UINT32>[]>(PageNum)) {}
+
+    void Acquire(size_t InOffset, size_t InSize, UINT32 InOwner)
+    {
+        for (size_t ix = InOffset / PageSize; ix < (InOffset + InSize) / PageSize; ++ix)
+        {
+            UINT32 Expected = 0;
+            if (ix >= PageNum || !Owners[ix].compare_exchange_strong(Expected, InOwner, std::memory_order_relaxed)) ErrorNum.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Release(size_t InOffset, size_t InSize)
+    {
+        for (size_t ix = InOffset / PageSize; ix < (InOffset + InSize) / PageSize && ix < PageNum; ++ix)
+        {
+            Owners[ix].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    UINT64 GetErrorNum() const { return ErrorNum.load(); }
+
+private:
+    size_t PageSize;
+    size_t PageNum;
+    std::unique_ptr<std::atomic<UINT32>[]> Owners;
+    std::atomic<UINT64> ErrorNum = 0;
+};
+
+
+struct BuddyResult
+{
+    double Time = 0.0;
+    UINT64 FailedNum = 0;
+    UINT64 OverlapNum = 0;
+    UINT64 FreeSize = 0;     // 全部释放后的空闲大小, 应该等于容量
+    UINT64 FreeBlockNum = 0; // 全部释放后应该合并成一块
+};
+
+// 每个线程最多同时持有InLiveNum个块, 满了之后随机释放一个再分配
+template <typename A>
+static BuddyResult RunBuddyChurn(A& InAllocator, size_t InCapacity, const BenchConfig& InConfig, UINT32 InLiveNum, bool bInUniformSize)
+{
+    static constexpr size_t PageSize = 64 * 1024;
+    static constexpr size_t Sizes[] = { 64 * 1024, 128 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+
+    struct LiveBlock
+    {
+        size_t Offset;
+        size_t Size;
+    };
+
+    OverlapChecker Checker(InCapacity, PageSize);
+    std::atomic<UINT64> FailedNum = 0;
+
+    BuddyResult Result;
+    Result.Time = RunThreads(
+        InConfig.ThreadNum,
+        [&](UINT32 InThreadIndex)
+        {
+            std::mt19937 Random(InThreadIndex + 1);
+            std::vector<LiveBlock> LiveBlocks;
+            LiveBlocks.reserve(InLiveNum);
+
+            for (UINT32 ix = 0; ix < InConfig.OpNum; ++ix)
+            {
+                if (LiveBlocks.size() == InLiveNum)
+                {
+                    const size_t VictimIndex = Random() % LiveBlocks.size();
+                    const LiveBlock Victim = LiveBlocks[VictimIndex];
+                    LiveBlocks[VictimIndex] = LiveBlocks.back();
+                    LiveBlocks.pop_back();
+
+                    Checker.Release(Victim.Offset, Victim.Size);
+                    InAllocator.TryFree(Victim.Offset, Victim.Size);
+                }
+
+                const size_t Size = bInUniformSize ? PageSize : Sizes[Random() % 5];
+                size_t Offset = 0;
+                if (InAllocator.TryAllocate(&Offset, Size))
+                {
+                    Checker.Acquire(Offset, Size, InThreadIndex + 1);
+                    LiveBlocks.push_back({ Offset, Size });
+                }
+                else
+                {
+                    FailedNum.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            for (const auto& Block : LiveBlocks)
+            {
+                Checker.Release(Block.Offset, Block.Size);
+                InAllocator.TryFree(Block.Offset, Block.Size);
+            }
+        }
+    );
+
+    AllocatorStats Stats;
+    InAllocator.GetStats(&Stats);
+    Result.FailedNum = FailedNum.load();
+    Result.OverlapNum = Checker.GetErrorNum();
+    Result.FreeSize = Stats.FreeSize;
+    Result.FreeBlockNum = Stats.FreeBlockNum;
+    return Result;
+}
+
+static void PrintBuddyResult(const char* InName, UINT32 InThreadNum, const BuddyResult& InResult, const BenchConfig& InConfig)
+{
+    const double OpNum = 2.0 * InThreadNum * InConfig.OpNum;
+    printf_s(
+        "%-32s %8u %10.2f %10.1f %10llu %10llu %14llu %8llu\n",
+        InName, InThreadNum, InResult.Time, InResult.Time * 1e6 / OpNum, InResult.FailedNum, InResult.OverlapNum, InResult.FreeSize / 1024, InResult.FreeBlockNum
+    );
+}
+
+static bool BenchBuddy(const BenchConfig& InConfig)
+{
+    static constexpr size_t Capacity = 512ull * 1024 * 1024;     // HEAP_DEFAULT_SIZE
+    static constexpr size_t MinBlockSize = 64 * 1024;            // D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+    static constexpr size_t MixedLiveSize = Capacity / 2;        // 混合大小时所有线程合起来大约持有一半容量
+
+    BenchConfig SingleThreadConfig = InConfig;
+    SingleThreadConfig.ThreadNum = 1;
+
+    const auto GetMixedLiveNum = [](const BenchConfig& InRunConfig) { return static_cast<UINT32>(MixedLiveSize / InRunConfig.ThreadNum / (1100 * 1024)); };
+
+    printf_s("%u allocations per thread, capacity %llu MB\n\n", InConfig.OpNum, static_cast<UINT64>(Capacity >> 20));
+    printf_s("%-32s %8s %10s %10s %10s %10s %14s %8s\n", "Allocator", "Threads", "Time(ms)", "ns/op", "Failed", "Overlaps", "FreeAfter(KB)", "Blocks");
+
+    // 链表伙伴分配器在多线程同时合并时会死锁, 只在单线程下对比
+    {
+        ConcurrentBuddyAllocator Allocator(Capacity, MinBlockSize);
+        PrintBuddyResult("ConcurrentBuddyAllocator", 1, RunBuddyChurn(Allocator, Capacity, SingleThreadConfig, GetMixedLiveNum(SingleThreadConfig), false), SingleThreadConfig);
+    }
+
+    bool bPassed = true;
+    for (const BenchConfig& RunConfig : { SingleThreadConfig, InConfig })
+    {
+        ConcurrentBitmapBuddyAllocator Allocator(Capacity, MinBlockSize);
+        const BuddyResult Result = RunBuddyChurn(Allocator, Capacity, RunConfig, GetMixedLiveNum(RunConfig), false);
+        PrintBuddyResult("ConcurrentBitmapBuddyAllocator", RunConfig.ThreadNum, Result, RunConfig);
+        bPassed &= Result.OverlapNum == 0 && Result.FreeSize == Capacity && Result.FreeBlockNum == 1;
+    }
+
+    printf_s("\nUniform 64KB blocks filling the whole heap, every allocation must succeed:\n");
+    {
+        ConcurrentBitmapBuddyAllocator Allocator(Capacity, MinBlockSize);
+        const BuddyResult Result = RunBuddyChurn(Allocator, Capacity, InConfig, static_cast<UINT32>(Capacity / MinBlockSize / InConfig.ThreadNum), true);
+        PrintBuddyResult("ConcurrentBitmapBuddyAllocator", InConfig.ThreadNum, Result, InConfig);
+        bPassed &= Result.FailedNum == 0 && Result.OverlapNum == 0 && Result.FreeSize == Capacity && Result.FreeBlockNum == 1;
+    }
+
+    printf_s("\n%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+
+struct IndexResult
+{
+    double Time = 0.0;
+    UINT64 FailedNum = 0;
+    UINT64 OverlapNum = 0;
+    UINT64 UsedSize = 0;     // 全部释放后应该为0
+};
+
+// 每个线程最多同时持有InLiveNum个下标, 满了之后随机释放一个再分配
+template <typename A>
+static IndexResult RunIndexChurn(A& InAllocator, UINT32 InCapacity, UINT32 InThreadNum, UINT32 InOpNum, UINT32 InLiveNum)
+{
+    OverlapChecker Checker(InCapacity, 1);
+    std::atomic<UINT64> FailedNum = 0;
+
+    IndexResult Result;
+    Result.Time = RunThreads(
+        InThreadNum,
+        [&](UINT32 InThreadIndex)
+        {
+            std::mt19937 Random(InThreadIndex + 1);
+            std::vector<size_t> LiveIndices;
+            LiveIndices.reserve(InLiveNum);
+
+            for (UINT32 ix = 0; ix < InOpNum; ++ix)
+            {
+                if (LiveIndices.size() == InLiveNum)
+                {
+                    const size_t VictimIndex = Random() % LiveIndices.size();
+                    const size_t Victim = LiveIndices[VictimIndex];
+                    LiveIndices[VictimIndex] = LiveIndices.back();
+                    LiveIndices.pop_back();
+
+                    Checker.Release(Victim, 1);
+                    InAllocator.TryFree(Victim);
+                }
+
+                size_t Index = 0;
+                if (InAllocator.TryAllocate(&Index))
+                {
+                    Checker.Acquire(Index, 1, InThreadIndex + 1);
+                    LiveIndices.push_back(Index);
+                }
+                else
+                {
+                    FailedNum.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            for (size_t Index : LiveIndices)
+            {
+                Checker.Release(Index, 1);
+                InAllocator.TryFree(Index);
+            }
+        }
+    );
+
+    AllocatorStats Stats;
+    InAllocator.GetStats(&Stats);
+    Result.FailedNum = FailedNum.load();
+    Result.OverlapNum = Checker.GetErrorNum();
+    Result.UsedSize = Stats.UsedSize;
+    return Result;
+}
+
+static void PrintIndexResult(const char* InName, UINT32 InThreadNum, const IndexResult& InResult, UINT32 InOpNum)
+{
+    const double OpNum = 2.0 * InThreadNum * InOpNum;
+    printf_s(
+        "%-32s %8u %10.2f %10.1f %10llu %10llu %10llu\n",
+        InName, InThreadNum, InResult.Time, InResult.Time * 1e6 / OpNum, InResult.FailedNum, InResult.OverlapNum, InResult.UsedSize
+    );
+}
+
+static bool BenchIndex(const BenchConfig& InConfig)
+{
+    static constexpr UINT32 LiveNum = 64;     // 每个线程同时持有的描述符数
+
+    printf_s("%u allocations per thread, %u live indices per thread\n\n", InConfig.OpNum, LiveNum);
+    printf_s("%-32s %8s %10s %10s %10s %10s %10s\n", "Allocator", "Threads", "Time(ms)", "ns/op", "Failed", "Overlaps", "UsedAfter");
+
+    bool bPassed = true;
+    for (UINT32 ThreadNum = 1; ThreadNum <= InConfig.ThreadNum; ThreadNum *= 2)
+    {
+        const UINT32 Capacity = ThreadNum * LiveNum;
+        {
+            // ConcurrentFreeListAllocator在链表为空时释放会在头节点的锁上自锁死, 给它两倍容量让链表不会变空
+            ConcurrentFreeListAllocator Allocator(Capacity * 2);
+            PrintIndexResult("ConcurrentFreeListAllocator", ThreadNum, RunIndexChurn(Allocator, Capacity * 2, ThreadNum, InConfig.OpNum, LiveNum), InConfig.OpNum);
+        }
+        {
+            ConcurrentIndexAllocator Allocator(Capacity);
+            const IndexResult Result = RunIndexChurn(Allocator, Capacity, ThreadNum, InConfig.OpNum, LiveNum);
+            PrintIndexResult("ConcurrentIndexAllocator", ThreadNum, Result, InConfig.OpNum);
+            bPassed &= Result.FailedNum == 0 && Result.OverlapNum == 0 && Result.UsedSize == 0;
+        }
+    }
+
+    // 上面的线程都已退出, 缓存中的下标应该已经还回栈中, 这里在一个新线程中分配满整个容量
+    printf_s("\nAllocate the whole capacity after %u threads exited:\n", InConfig.ThreadNum);
+    {
+        const UINT32 Capacity = InConfig.ThreadNum * LiveNum;
+        ConcurrentIndexAllocator Allocator(Capacity);
+        RunIndexChurn(Allocator, Capacity, InConfig.ThreadNum, InConfig.OpNum, LiveNum);
+
+        UINT32 AllocatedNum = 0;
+        RunThreads(
+            1,
+            [&](UINT32)
+            {
+                size_t Index;
+                while (AllocatedNum < Capacity && Allocator.TryAllocate(&Index)) AllocatedNum++;
+            }
+        );
+        printf_s("%u / %u\n", AllocatedNum, Capacity);
+        bPassed &= AllocatedNum == Capacity;
+    }
+
+    printf_s("\n%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+
+struct RingResult
+{
+    double Time = 0.0;
+    UINT64 AllocationNum = 0;
+    UINT64 FailedNum = 0;
+    UINT64 OverlapNum = 0;
+    UINT64 UsedSize = 0;     // 全部回收后应该为0
+};
+
+static RingResult RunRingFrames(UINT32 InThreadNum, UINT32 InOpNum)
+{
+    static constexpr UINT32 AllocationNumPerFrame = 1000;     // 每个线程每帧的分配次数
+    static constexpr UINT32 MaxAllocationSize = 16;
+    static constexpr UINT32 FrameInFlightNum = 2;             // 第n帧结束时回收第n - 2帧
+
+    struct Range
+    {
+        size_t Offset;
+        size_t Size;
+    };
+
+    // 多留一帧的空间给环尾跳过的部分
+    const size_t Capacity = static_cast<size_t>(FrameInFlightNum + 2) * InThreadNum * AllocationNumPerFrame * MaxAllocationSize;
+    const UINT32 FrameNum = InOpNum / AllocationNumPerFrame > 0 ? InOpNum / AllocationNumPerFrame : 1;
+
+    ConcurrentRingAllocator Allocator(Capacity);
+    OverlapChecker Checker(Capacity, 1);
+    std::atomic<UINT64> FailedNum = 0;
+
+    // [线程][帧 % (FrameInFlightNum + 1)]中存放该线程在这一帧分配的区间
+    std::vector<std::vector<std::vector<Range>>> FrameRanges(InThreadNum, std::vector<std::vector<Range>>(FrameInFlightNum + 1));
+
+    UINT64 FrameIndex = 0;
+    const auto RetireFrame = [&](UINT64 InRetireFrame)
+    {
+        for (auto& ThreadRanges : FrameRanges)
+        {
+            auto& Ranges = ThreadRanges[InRetireFrame % (FrameInFlightNum + 1)];
+            for (const Range& Allocation : Ranges) Checker.Release(Allocation.Offset, Allocation.Size);
+            Ranges.clear();
+        }
+        Allocator.RetireFrames(InRetireFrame);
+    };
+
+    // 所有线程都结束一帧的分配后, 由最后到达的线程标记这一帧并回收两帧之前的分配, 相当于渲染线程等到了那一帧的fence
+    const auto FinishFrame = [&]() noexcept
+    {
+        Allocator.MarkFrame(FrameIndex);
+        if (FrameIndex >= FrameInFlightNum) RetireFrame(FrameIndex - FrameInFlightNum);
+        FrameIndex++;
+    };
+    std::barrier FrameBarrier(static_cast<std::ptrdiff_t>(InThreadNum), FinishFrame);
+
+    RingResult Result;
+    Result.Time = RunThreads(
+        InThreadNum,
+        [&](UINT32 InThreadIndex)
+        {
+            std::mt19937 Random(InThreadIndex + 1);
+            for (UINT32 Frame = 0; Frame < FrameNum; ++Frame)
+            {
+                auto& Ranges = FrameRanges[InThreadIndex][Frame % (FrameInFlightNum + 1)];
+                for (UINT32 ix = 0; ix < AllocationNumPerFrame; ++ix)
+                {
+                    const size_t Size = 1 + Random() % MaxAllocationSize;
+                    size_t Offset = 0;
+                    if (Allocator.TryAllocate(&Offset, Size))
+                    {
+                        Checker.Acquire(Offset, Size, InThreadIndex + 1);
+                        Ranges.push_back({ Offset, Size });
+                    }
+                    else
+                    {
+                        FailedNum.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                FrameBarrier.arrive_and_wait();
+            }
+        }
+    );
+
+    for (UINT64 ix = FrameIndex > FrameInFlightNum ? FrameIndex - FrameInFlightNum : 0; ix < FrameIndex; ++ix) RetireFrame(ix);
+
+    Result.AllocationNum = static_cast<UINT64>(InThreadNum) * FrameNum * AllocationNumPerFrame;
+    Result.FailedNum = FailedNum.load();
+    Result.OverlapNum = Checker.GetErrorNum();
+    Result.UsedSize = Allocator.GetUsedSize();
+    return Result;
+}
+
+static bool BenchRing(const BenchConfig& InConfig)
+{
+    printf_s("%u allocations per thread, sizes 1~16, frames retired 2 frames later\n\n", InConfig.OpNum);
+    printf_s("%-32s %8s %10s %10s %10s %10s %10s\n", "Allocator", "Threads", "Time(ms)", "ns/op", "Failed", "Overlaps", "UsedAfter");
+
+    bool bPassed = true;
+    for (UINT32 ThreadNum = 1; ThreadNum <= InConfig.ThreadNum; ThreadNum *= 2)
+    {
+        const RingResult Result = RunRingFrames(ThreadNum, InConfig.OpNum);
+        printf_s(
+            "%-32s %8u %10.2f %10.1f %10llu %10llu %10llu\n",
+            "ConcurrentRingAllocator", ThreadNum, Result.Time, Result.Time * 1e6 / static_cast<double>(Result.AllocationNum), Result.FailedNum, Result.OverlapNum, Result.UsedSize
+        );
+        bPassed &= Result.FailedNum == 0 && Result.OverlapNum == 0 && Result.UsedSize == 0;
+    }
+
+    printf_s("\n%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf_s("Usage: AllocatorBench <buddy|index|ring> [--threads <n>] [--ops <n>]\n");
+        return 1;
+    }
+
+    BenchConfig Config;
+    for (int ix = 2; ix + 1 < argc; ix += 2)
+    {
+        if (strcmp(argv[ix], "--threads") == 0) Config.ThreadNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--ops") == 0) Config.OpNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+    }
+    if (Config.ThreadNum == 0 || Config.OpNum == 0)
+    {
+        printf_s("--threads and --ops must be greater than 0.\n");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "buddy") == 0)
+    {
+        if (!BenchBuddy(Config)) return 1;
+    }
+    else if (strcmp(argv[1], "index") == 0)
+    {
+        if (!BenchIndex(Config)) return 1;
+    }
+    else if (strcmp(argv[1], "ring") == 0)
+    {
+        if (!BenchRing(Config)) return 1;
+    }
+    else
+    {
+        printf_s("Unknown benchmark %s.\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
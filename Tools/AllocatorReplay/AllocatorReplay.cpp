@@ -0,0 +1,413 @@
+﻿#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../FantasyRenderer/MultiThreading/AllocatorTrace.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentBitmapBuddyAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentBuddyAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentSegListAllocator.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentTLSFAllocator.h"
+
+/*
+ * 把D3D12ResourceAllocator录制的分配记录重放到不同的分配器上, 只用CPU, 不需要GPU.
+ * 所有类型的分配放到同一个地址空间中重放(可以用--type只重放一种), 常量缓冲在FrameRetire时按帧整体释放.
+ * 每个分配器输出耗时, 峰值, 最高地址, 失败次数, 以及每帧结束时采样的碎片率.
+ * --sponza: 不读录制文件, 按Sponza.gltf中每张贴图的实际尺寸生成贴图分配序列(先全部加载, 之后每帧随机卸载和重新加载一部分),
+ *           贴图和ImageLoader一样按RGBA8, 1个mip计算大小, 按64KB对齐.
+ *
+ * 用法: AllocatorReplay <trace file> [--capacity <bytes>] [--type <0-4>]
+ *       AllocatorReplay --sponza <gltf file> [--capacity <bytes>] [--frames <n>]
+ */
+
+static constexpr UINT8 TextureType = 1;            // ED3D12ResourceLocationType::Texture
+static constexpr UINT8 ConstantBufferType = 2;     // ED3D12ResourceLocationType::ConstantBuffer
+static constexpr size_t TextureAlignment = 64 * 1024;     // D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+static constexpr size_t MinBlockSize = 256;        // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+static constexpr size_t DefaultCapacity = 512ull * 1024 * 1024;     // HEAP_DEFAULT_SIZE
+
+class ReplayTarget
+{
+public:
+    virtual ~ReplayTarget() = default;
+
+    virtual const char* GetName() const = 0;
+    virtual bool Allocate(size_t* OutOffset, size_t InSize, size_t InAlignment) = 0;
+    virtual void Free(size_t InOffset, size_t InSize, size_t InAlignment) = 0;
+    virtual void GetStats(AllocatorStats* OutStats) const = 0;
+};
+
+// 伙伴类的块总是按自身大小对齐, 把大小取到不小于对齐即可满足对齐要求
+class BitmapBuddyTarget : public ReplayTarget
+{
+public:
+    explicit BitmapBuddyTarget(size_t InCapacity) : Allocator(InCapacity, MinBlockSize) {}
+
+    const char* GetName() const override { return "ConcurrentBitmapBuddyAllocator"; }
+    bool Allocate(size_t* OutOffset, size_t InSize, size_t InAlignment) override { return Allocator.TryAllocate(OutOffset, InSize > InAlignment ? InSize : InAlignment); }
+    void Free(size_t InOffset, size_t InSize, size_t InAlignment) override { Allocator.TryFree(InOffset, InSize > InAlignment ? InSize : InAlignment); }
+    void GetStats(AllocatorStats* OutStats) const override { Allocator.GetStats(OutStats); }
+
+private:
+    ConcurrentBitmapBuddyAllocator Allocator;
+};
+
+class BuddyTarget : public ReplayTarget
+{
+public:
+    explicit BuddyTarget(size_t InCapacity) : Allocator(InCapacity, MinBlockSize) {}
+
+    const char* GetName() const override { return "ConcurrentBuddyAllocator"; }
+    bool Allocate(size_t* OutOffset, size_t InSize, size_t InAlignment) override { return Allocator.TryAllocate(OutOffset, InSize > InAlignment ? InSize : InAlignment); }
+    void Free(size_t InOffset, size_t InSize, size_t InAlignment) override { Allocator.TryFree(InOffset, InSize > InAlignment ? InSize : InAlignment); }
+    void GetStats(AllocatorStats* OutStats) const override { Allocator.GetStats(OutStats); }
+
+private:
+    ConcurrentBuddyAllocator Allocator;
+};
+
+// 每个大小级别是一个ConcurrentFreeListAllocator, 所以这也是FreeList分配器的重放方式
+class SegListTarget : public ReplayTarget
+{
+public:
+    SegListTarget(size_t InCapacity, size_t InBlockMaxSize)
+        : Allocator(InCapacity, InBlockMaxSize, MinBlockSize), BlockMaxSize(InBlockMaxSize)
+    {}
+
+    const char* GetName() const override { return "ConcurrentSegListAllocator"; }
+
+    bool Allocate(size_t* OutOffset, size_t InSize, size_t InAlignment) override
+    {
+        const size_t Size = InSize > InAlignment ? InSize : InAlignment;
+        if (Size > BlockMaxSize) return false;
+
+        size_t BlockIndex;
+        return Allocator.TryAllocate(OutOffset, &BlockIndex, Size);
+    }
+
+    void Free(size_t InOffset, size_t InSize, size_t InAlignment) override { Allocator.TryFree(InOffset, InSize > InAlignment ? InSize : InAlignment); }
+    void GetStats(AllocatorStats* OutStats) const override { Allocator.GetStats(OutStats); }
+
+private:
+    ConcurrentSegListAllocator Allocator;
+    size_t BlockMaxSize;
+};
+
+class TLSFTarget : public ReplayTarget
+{
+public:
+    explicit TLSFTarget(size_t InCapacity) : Allocator(InCapacity) {}
+
+    const char* GetName() const override { return "ConcurrentTLSFAllocator"; }
+    bool Allocate(size_t* OutOffset, size_t InSize, size_t InAlignment) override { return Allocator.TryAllocate(OutOffset, InSize, InAlignment); }
+    void Free(size_t InOffset, size_t, size_t) override { Allocator.TryFree(InOffset); }
+    void GetStats(AllocatorStats* OutStats) const override { Allocator.GetStats(OutStats); }
+
+private:
+    ConcurrentTLSFAllocator Allocator;
+};
+
+
+struct ReplayResult
+{
+    double Milliseconds = 0.0;
+    UINT64 AllocationNum = 0;
+    UINT64 FailedAllocationNum = 0;
+    UINT64 PeakUsedSize = 0;
+    UINT64 HighWaterMark = 0;     // 用到的最高地址, 即真正需要的堆大小
+    double AverageFragmentation = 0.0;
+    double MaxFragmentation = 0.0;
+};
+
+static ReplayResult Replay(ReplayTarget* InTarget, const std::vector<AllocatorTraceRecord>& InRecords, int InTypeFilter)
+{
+    struct LiveAllocation
+    {
+        size_t Offset;
+        size_t Size;
+        size_t Alignment;
+    };
+
+    ReplayResult Result;
+    std::map<std::pair<UINT8, UINT64>, LiveAllocation> LiveAllocations;     // (Type, 录制时的Offset) -> 重放时的分配
+    std::multimap<UINT64, LiveAllocation> FrameAllocations;                    // 按帧回收的分配, 以帧号为键
+
+    std::chrono::steady_clock::duration ReplayTime{};
+    UINT64 FrameNum = 0;
+
+    for (const AllocatorTraceRecord& Record : InRecords)
+    {
+        if (InTypeFilter >= 0 && (Record.Op == EAllocatorTraceOp::Allocate || Record.Op == EAllocatorTraceOp::Free) && Record.Type != InTypeFilter) continue;
+
+        switch (Record.Op)
+        {
+        case EAllocatorTraceOp::Allocate:
+            {
+                // 录制时就失败的分配也照常重放, 看候选分配器能不能放下
+                size_t Offset;
+                const size_t Alignment = Record.Alignment > 0 ? Record.Alignment : 1;
+                const auto BeginTime = std::chrono::steady_clock::now();
+                const bool bSucceeded = InTarget->Allocate(&Offset, Record.Size, Alignment);
+                ReplayTime += std::chrono::steady_clock::now() - BeginTime;
+
+                Result.AllocationNum++;
+                if (!bSucceeded)
+                {
+                    Result.FailedAllocationNum++;
+                    break;
+                }
+                if (Offset + Record.Size > Result.HighWaterMark) Result.HighWaterMark = Offset + Record.Size;
+
+                const LiveAllocation Allocation{ Offset, Record.Size, Alignment };
+                if (Record.Type == ConstantBufferType) FrameAllocations.emplace(Record.Frame, Allocation);
+                else if (Record.bSucceeded) LiveAllocations[{ Record.Type, Record.Offset }] = Allocation;
+            }
+            break;
+        case EAllocatorTraceOp::Free:
+            {
+                const auto Iter = LiveAllocations.find({ Record.Type, Record.Offset });
+                if (Iter == LiveAllocations.end()) break;
+
+                const auto BeginTime = std::chrono::steady_clock::now();
+                InTarget->Free(Iter->second.Offset, Iter->second.Size, Iter->second.Alignment);
+                ReplayTime += std::chrono::steady_clock::now() - BeginTime;
+
+                LiveAllocations.erase(Iter);
+            }
+            break;
+        case EAllocatorTraceOp::FrameRetire:
+            {
+                const auto EndIter = FrameAllocations.upper_bound(Record.Frame);
+
+                const auto BeginTime = std::chrono::steady_clock::now();
+                for (auto Iter = FrameAllocations.begin(); Iter != EndIter; ++Iter) InTarget->Free(Iter->second.Offset, Iter->second.Size, Iter->second.Alignment);
+                ReplayTime += std::chrono::steady_clock::now() - BeginTime;
+
+                FrameAllocations.erase(FrameAllocations.begin(), EndIter);
+            }
+            break;
+        case EAllocatorTraceOp::FrameEnd:
+            {
+                AllocatorStats Stats;
+                InTarget->GetStats(&Stats);
+
+                const double Fragmentation = Stats.GetFragmentation();
+                Result.AverageFragmentation += Fragmentation;
+                if (Fragmentation > Result.MaxFragmentation) Result.MaxFragmentation = Fragmentation;
+                FrameNum++;
+            }
+            break;
+        }
+    }
+
+    AllocatorStats Stats;
+    InTarget->GetStats(&Stats);
+    Result.PeakUsedSize = Stats.PeakUsedSize;
+    Result.Milliseconds = std::chrono::duration<double, std::milli>(ReplayTime).count();
+    if (FrameNum > 0) Result.AverageFragmentation /= static_cast<double>(FrameNum);
+    return Result;
+}
+
+static UINT32 ReadBigEndian16(const std::vector<UINT8>& InData, size_t InIndex)
+{
+    return (static_cast<UINT32>(InData[InIndex]) << 8) | InData[InIndex + 1];
+}
+
+// 只读PNG的IHDR或JPEG的SOF段得到图片大小, 不解码
+static bool ReadImageSize(const std::string& InFilePath, UINT32* OutWidth, UINT32* OutHeight)
+{
+    std::ifstream Input(InFilePath, std::ios::binary);
+    if (!Input) return false;
+    const std::vector<UINT8> Data((std::istreambuf_iterator<char>(Input)), std::istreambuf_iterator<char>());
+
+    if (Data.size() >= 24 && Data[0] == 0x89 && Data[1] == 'P' && Data[2] == 'N' && Data[3] == 'G')
+    {
+        *OutWidth = (ReadBigEndian16(Data, 16) << 16) | ReadBigEndian16(Data, 18);
+        *OutHeight = (ReadBigEndian16(Data, 20) << 16) | ReadBigEndian16(Data, 22);
+        return true;
+    }
+
+    if (Data.size() < 4 || Data[0] != 0xFF || Data[1] != 0xD8) return false;
+
+    size_t Index = 2;
+    while (Index + 9 < Data.size())
+    {
+        if (Data[Index] != 0xFF) return false;
+
+        const UINT8 Marker = Data[Index + 1];
+        if (Marker == 0xFF) { Index++; continue; }     // 填充字节
+        if (Marker == 0x01 || (Marker >= 0xD0 && Marker <= 0xD7)) { Index += 2; continue; }     // 没有长度的标记
+
+        // SOF0~SOF15, 其中C4(DHT), C8(JPG), CC(DAC)不是帧头
+        if (Marker >= 0xC0 && Marker <= 0xCF && Marker != 0xC4 && Marker != 0xC8 && Marker != 0xCC)
+        {
+            *OutHeight = ReadBigEndian16(Data, Index + 5);
+            *OutWidth = ReadBigEndian16(Data, Index + 7);
+            return true;
+        }
+        Index += 2 + ReadBigEndian16(Data, Index + 2);
+    }
+    return false;
+}
+
+// 返回gltf中images数组里每张图片按RGBA8计算的贴图大小
+static std::vector<UINT64> LoadGLTFTextureSizes(const std::string& InFilePath)
+{
+    std::ifstream Input(InFilePath, std::ios::binary);
+    ThrowIfFalse(Input.is_open(), "Open gltf file failed.");
+    const std::string Text((std::istreambuf_iterator<char>(Input)), std::istreambuf_iterator<char>());
+
+    const size_t ImagesIndex = Text.find("\"images\"");
+    ThrowIfFalse(ImagesIndex != std::string::npos, "The gltf file has no images.");
+
+    const std::string Directory = InFilePath.substr(0, InFilePath.find_last_of("/\\") + 1);
+    const size_t ArrayBegin = Text.find('[', ImagesIndex);
+    const size_t ArrayEnd = Text.find(']', ArrayBegin);     // images中的元素没有嵌套的数组
+
+    std::vector<UINT64> Sizes;
+    for (size_t Index = Text.find("\"uri\"", ArrayBegin); Index < ArrayEnd; Index = Text.find("\"uri\"", Index))
+    {
+        const size_t UriBegin = Text.find('"', Text.find(':', Index)) + 1;
+        const size_t UriEnd = Text.find('"', UriBegin);
+        const std::string Uri = Text.substr(UriBegin, UriEnd - UriBegin);
+
+        UINT32 Width, Height;
+        ThrowIfFalse(ReadImageSize(Directory + Uri, &Width, &Height), "Read image size failed: " + Uri);
+
+        const UINT64 Size = static_cast<UINT64>(Width) * Height * 4;
+        Sizes.push_back((Size + TextureAlignment - 1) / TextureAlignment * TextureAlignment);
+        Index = UriEnd;
+    }
+    return Sizes;
+}
+
+// 第0帧加载全部贴图, 第1帧卸载四分之一, 之后每帧卸载八分之一的常驻贴图, 再加载同样数量之前不常驻的贴图
+static std::vector<AllocatorTraceRecord> BuildTextureStreamingTrace(const std::vector<UINT64>& InTextureSizes, UINT32 InFrameNum)
+{
+    std::vector<AllocatorTraceRecord> Records;
+    const auto AddRecord = [&Records](EAllocatorTraceOp InOp, UINT64 InFrame, UINT64 InTextureIndex, UINT64 InSize)
+    {
+        AllocatorTraceRecord Record{};
+        Record.Frame = InFrame;
+        Record.Offset = InTextureIndex;     // 录制时的Offset只用来配对Allocate和Free, 这里用贴图编号
+        Record.Size = InSize;
+        Record.Alignment = static_cast<UINT32>(TextureAlignment);
+        Record.Op = InOp;
+        Record.Type = TextureType;
+        Record.bSucceeded = 1;
+        Records.push_back(Record);
+    };
+
+    const UINT64 TextureNum = InTextureSizes.size();
+    std::vector<UINT64> Resident;
+    std::vector<UINT64> NonResident;
+    for (UINT64 ix = 0; ix < TextureNum; ++ix)
+    {
+        AddRecord(EAllocatorTraceOp::Allocate, 0, ix, InTextureSizes[ix]);
+        Resident.push_back(ix);
+    }
+    AddRecord(EAllocatorTraceOp::FrameEnd, 0, 0, 0);
+
+    std::mt19937 Random(1);
+    for (UINT64 Frame = 1; Frame <= InFrameNum; ++Frame)
+    {
+        const UINT64 EvictNum = Frame == 1 ? TextureNum / 4 : (TextureNum / 8 < NonResident.size() ? TextureNum / 8 : NonResident.size());
+        std::shuffle(NonResident.begin(), NonResident.end(), Random);
+        std::vector<UINT64> Loads(NonResident.begin(), NonResident.begin() + (Frame == 1 ? 0 : EvictNum));
+        NonResident.erase(NonResident.begin(), NonResident.begin() + Loads.size());
+
+        std::shuffle(Resident.begin(), Resident.end(), Random);
+        for (UINT64 ix = 0; ix < EvictNum; ++ix)
+        {
+            AddRecord(EAllocatorTraceOp::Free, Frame, Resident.back(), InTextureSizes[Resident.back()]);
+            NonResident.push_back(Resident.back());
+            Resident.pop_back();
+        }
+        for (UINT64 TextureIndex : Loads)
+        {
+            AddRecord(EAllocatorTraceOp::Allocate, Frame, TextureIndex, InTextureSizes[TextureIndex]);
+            Resident.push_back(TextureIndex);
+        }
+        AddRecord(EAllocatorTraceOp::FrameEnd, Frame, 0, 0);
+    }
+    return Records;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || (strcmp(argv[1], "--sponza") == 0 && argc < 3))
+    {
+        printf_s("Usage: AllocatorReplay <trace file> [--capacity <bytes>] [--type <0-4>]\n");
+        printf_s("       AllocatorReplay --sponza <gltf file> [--capacity <bytes>] [--frames <n>]\n");
+        return 1;
+    }
+
+    const bool bSponza = strcmp(argv[1], "--sponza") == 0;
+    size_t Capacity = DefaultCapacity;
+    int TypeFilter = -1;
+    UINT32 FrameNum = 600;
+    for (int ix = bSponza ? 3 : 2; ix + 1 < argc; ix += 2)
+    {
+        if (strcmp(argv[ix], "--capacity") == 0) Capacity = std::strtoull(argv[ix + 1], nullptr, 10);
+        else if (strcmp(argv[ix], "--type") == 0) TypeFilter = std::atoi(argv[ix + 1]);
+        else if (strcmp(argv[ix], "--frames") == 0) FrameNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+    }
+
+    std::vector<AllocatorTraceRecord> Records;
+    try
+    {
+        if (bSponza)
+        {
+            const std::vector<UINT64> TextureSizes = LoadGLTFTextureSizes(argv[2]);
+
+            UINT64 TotalSize = 0;
+            for (UINT64 Size : TextureSizes) TotalSize += Size;
+            printf_s("%llu textures, %llu KB in total, %u streaming frames\n", static_cast<UINT64>(TextureSizes.size()), TotalSize / 1024, FrameNum);
+
+            Records = BuildTextureStreamingTrace(TextureSizes, FrameNum);
+        }
+        else
+        {
+            Records = AllocatorTraceRecorder::LoadAllocatorTrace(argv[1]);
+        }
+    }
+    catch (const Exception&)
+    {
+        printf_s("\n");    // ThrowIfFalse已经输出了原因
+        return 1;
+    }
+    printf_s("%llu records, capacity %llu bytes\n\n", static_cast<UINT64>(Records.size()), static_cast<UINT64>(Capacity));
+
+    std::vector<std::unique_ptr<ReplayTarget>> Targets;
+    Targets.emplace_back(std::make_unique<BitmapBuddyTarget>(Capacity));
+    Targets.emplace_back(std::make_unique<TLSFTarget>(Capacity));
+    Targets.emplace_back(std::make_unique<BuddyTarget>(Capacity));
+    Targets.emplace_back(std::make_unique<SegListTarget>(Capacity, Capacity / 4));
+
+    printf_s("%-32s %10s %10s %8s %12s %12s %8s %8s\n", "Allocator", "Time(ms)", "Allocs", "Failed", "Peak(KB)", "HighMark(KB)", "AvgFrag", "MaxFrag");
+    for (const auto& Target : Targets)
+    {
+        const ReplayResult Result = Replay(Target.get(), Records, TypeFilter);
+        printf_s(
+            "%-32s %10.3f %10llu %8llu %12llu %12llu %8.3f %8.3f\n",
+            Target->GetName(),
+            Result.Milliseconds,
+            Result.AllocationNum,
+            Result.FailedAllocationNum,
+            Result.PeakUsedSize / 1024,
+            Result.HighWaterMark / 1024,
+            Result.AverageFragmentation,
+            Result.MaxFragmentation
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,474 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../FantasyRenderer/MultiThreading/ConcurrentList.h"
+#include "../../FantasyRenderer/MultiThreading/ConcurrentNameRegistry.h"
+
+/*
+ * MultiThreading中并发容器的性能测试, 只用CPU.
+ * registry: 模拟RenderGraphBuilder的Setup, 每个Mesh导入两个Buffer, 每个Buffer按名字查找两次(Import和TransitionRead),
+ *           在100, 1k, 10k个资源下比较加锁链表的FindFirstIf和ConcurrentNameRegistry的耗时;
+ *           并检查多个线程同时插入和查找时每个名字都能找到.
+ * list: 以读为主的链表遍历, 64个元素, 每个线程每--write-every次遍历做一次PushBack和RemoveIf, 线程数从1倍增到n,
+ *       比较每个节点一个锁的旧ConcurrentList和无锁的ConcurrentList; 再让一半线程不停地插入删除, 另一半遍历,
+ *       检查遍历不会看到已析构的元素, 结束后链表中正好剩下最初的元素.
+ * Legacy开头的类拷贝自重写之前的代码, 只用于对比.
+ *
+ * 用法: ContainerBench registry [--threads <n>]
+ *       ContainerBench list [--threads <n>] [--ops <n>] [--write-every <n>]
+ */
+
+struct BenchConfig
+{
+    UINT32 ThreadNum = 8;
+    UINT32 OpNum = 20000;           // 每个线程的遍历次数
+    UINT32 WriteInterval = 100;     // 每多少次遍历做一次插入和删除
+};
+
+static double ElapsedMs(std::chrono::steady_clock::time_point InBegin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - InBegin).count();
+}
+
+// 在InThreadNum个线程上同时执行InFunc(UINT32 InThreadIndex), 返回耗时
+template <typename F>
+static double RunThreads(UINT32 InThreadNum, const F& InFunc)
+{
+    std::atomic<bool> bStart = false;
+    std::vector<std::thread> Threads;
+    for (UINT32 ix = 0; ix < InThreadNum; ++ix)
+    {
+        Threads.emplace_back(
+            [&bStart, &InFunc, ix]()
+            {
+                while (!bStart.load(std::memory_order_acquire)) std::this_thread::yield();
+                InFunc(ix);
+            }
+        );
+    }
+
+    const auto Begin = std::chrono::steady_clock::now();
+    bStart.store(true, std::memory_order_release);
+    for (auto& Thread : Threads) Thread.join();
+    return ElapsedMs(Begin);
+}
+
+
+// 重写之前的ConcurrentList, 每个节点一个锁, 遍历时逐个节点交替加锁
+template <typename T>
+class LegacyConcurrentList
+{
+    struct Node
+    {
+        std::mutex Mutex;
+        std::unique_ptr<T> Data;
+        std::unique_ptr<Node> Next;
+    };
+
+public:
+    CLASS_NO_COPY(LegacyConcurrentList)
+
+    LegacyConcurrentList() { Tail = &Head; }
+    ~LegacyConcurrentList() = default;
+
+public:
+    template <typename... Args>
+    T* PushBack(Args&&... Arguments)
+    {
+        std::unique_ptr<Node> NewNode = std::make_unique<Node>();
+        NewNode->Data = std::make_unique<T>(std::forward<Args>(Arguments)...);
+
+        std::lock_guard TailLock(TailMutex);
+        std::lock_guard HeadLock(Head.Mutex);
+        Tail->Next = std::move(NewNode);
+        Tail = Tail->Next.get();
+
+        return Tail->Data.get();
+    }
+
+    template <typename F>
+    void ForEach(F Func)
+    {
+        Node* CurrentNode = &Head;
+        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+
+        while (Node* const NextNode = CurrentNode->Next.get())
+        {
+            std::unique_lock NextNodeLock(NextNode->Mutex);
+            CurrentNodeLock.unlock();
+
+            Func(NextNode->Data.get());
+
+            CurrentNode = NextNode;
+            CurrentNodeLock = std::move(NextNodeLock);
+        }
+    }
+
+    template <typename F>
+    T* FindFirstIf(F Func)
+    {
+        Node* CurrentNode = &Head;
+        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+
+        while (Node* const NextNode = CurrentNode->Next.get())
+        {
+            std::unique_lock NextNodeLock(NextNode->Mutex);
+            CurrentNodeLock.unlock();
+
+            if (Func(NextNode->Data.get()))
+            {
+                return NextNode->Data.get();
+            }
+            CurrentNode = NextNode;
+            CurrentNodeLock = std::move(NextNodeLock);
+        }
+        return nullptr;
+    }
+
+    // 和原来一样删除尾节点时不会更新Tail, 测试中只删除不在尾部的元素
+    template <typename F>
+    bool RemoveIf(F Func)
+    {
+        bool Success = false;
+
+        Node* CurrentNode = &Head;
+        std::unique_lock CurrentNodeLock(CurrentNode->Mutex);
+
+        while (Node* const NextNode = CurrentNode->Next.get())
+        {
+            std::unique_lock NextNodeLock(NextNode->Mutex);
+
+            if (Func(NextNode->Data.get()))
+            {
+                std::unique_ptr<Node> OldNextNode = std::move(CurrentNode->Next);
+                CurrentNode->Next = std::move(NextNode->Next);
+                NextNodeLock.unlock();
+
+                Success = true;
+            }
+            else
+            {
+                CurrentNodeLock.unlock();
+                CurrentNode = NextNode;
+                CurrentNodeLock = std::move(NextNodeLock);
+            }
+        }
+
+        return Success;
+    }
+
+private:
+    Node Head;
+    Node* Tail;
+    std::mutex TailMutex;
+};
+
+
+struct BenchResource
+{
+    explicit BenchResource(std::string InName) : Name(std::move(InName)) {}
+
+    std::string Name;
+};
+
+static std::string GetResourceName(UINT32 InIndex)
+{
+    // 和SamplePass一样, 每个Mesh一个顶点Buffer和一个索引Buffer
+    return "Mesh" + std::to_string(InIndex / 2) + (InIndex % 2 == 0 ? "VertexBuffer" : "IndexBuffer");
+}
+
+struct SetupResult
+{
+    double InsertTime = 0.0;
+    double FindTime = 0.0;
+    UINT32 MissNum = 0;     // 没找到或找错的次数, 应该为0
+};
+
+// InAdd(Name)返回登记后的指针, InFind(Name)按名字查找
+template <typename A, typename F>
+static SetupResult RunSetup(const std::vector<std::string>& InNames, const A& InAdd, const F& InFind)
+{
+    SetupResult Result;
+    std::vector<BenchResource*> Resources(InNames.size());
+
+    auto Begin = std::chrono::steady_clock::now();
+    for (size_t ix = 0; ix < InNames.size(); ++ix) Resources[ix] = InAdd(InNames[ix]);
+    Result.InsertTime = ElapsedMs(Begin);
+
+    Begin = std::chrono::steady_clock::now();
+    for (UINT32 Pass = 0; Pass < 2; ++Pass)
+    {
+        for (size_t ix = 0; ix < InNames.size(); ++ix)
+        {
+            if (InFind(InNames[ix]) != Resources[ix]) Result.MissNum++;
+        }
+    }
+    Result.FindTime = ElapsedMs(Begin);
+    return Result;
+}
+
+static void PrintSetupResult(const char* InName, size_t InResourceNum, const SetupResult& InResult)
+{
+    printf_s(
+        "%-36s %10llu %12.3f %12.3f %12.3f %8u\n",
+        InName, static_cast<UINT64>(InResourceNum), InResult.InsertTime, InResult.FindTime, InResult.InsertTime + InResult.FindTime, InResult.MissNum
+    );
+}
+
+static bool BenchRegistry(const BenchConfig& InConfig)
+{
+    printf_s("%-36s %10s %12s %12s %12s %8s\n", "Lookup", "Resources", "Insert(ms)", "Find(ms)", "Setup(ms)", "Missed");
+
+    bool bPassed = true;
+    for (UINT32 ResourceNum : { 100u, 1000u, 10000u })
+    {
+        std::vector<std::string> Names;
+        for (UINT32 ix = 0; ix < ResourceNum; ++ix) Names.push_back(GetResourceName(ix));
+
+        {
+            LegacyConcurrentList<BenchResource> List;
+            const SetupResult Result = RunSetup(
+                Names,
+                [&List](const std::string& InName) { return List.PushBack(InName); },
+                [&List](const std::string& InName) { return List.FindFirstIf([&InName](BenchResource* InResource) { return InResource->Name == InName; }); }
+            );
+            PrintSetupResult("LegacyConcurrentList::FindFirstIf", ResourceNum, Result);
+        }
+        {
+            // 和RenderGraphResourcePool::AddBuffer()一样, 链表用于遍历, 查找走哈希表
+            ConcurrentList<BenchResource> List;
+            ConcurrentNameRegistry<BenchResource> Registry;
+            const SetupResult Result = RunSetup(
+                Names,
+                [&List, &Registry](const std::string& InName)
+                {
+                    BenchResource* Resource = List.PushFront(InName);
+                    Registry.Insert(Resource);
+                    return Resource;
+                },
+                [&Registry](const std::string& InName) { return Registry.Find(InName); }
+            );
+            PrintSetupResult("ConcurrentNameRegistry::Find", ResourceNum, Result);
+            bPassed &= Result.MissNum == 0;
+        }
+    }
+
+    // 每个线程插入自己的名字, 插入后立即查找, 同时查找其他线程已经插入的名字, 期间会多次扩容
+    static constexpr UINT32 NameNumPerThread = 10000;
+    printf_s("\nConcurrent insert and find, %u threads x %u names:\n", InConfig.ThreadNum, NameNumPerThread);
+    {
+        std::vector<std::unique_ptr<BenchResource>> Resources;
+        for (UINT32 ix = 0; ix < InConfig.ThreadNum * NameNumPerThread; ++ix) Resources.push_back(std::make_unique<BenchResource>(GetResourceName(ix)));
+
+        ConcurrentNameRegistry<BenchResource> Registry;
+        std::atomic<UINT32> MissNum = 0;
+        std::atomic<UINT32> WrongNum = 0;
+        const double Time = RunThreads(
+            InConfig.ThreadNum,
+            [&](UINT32 InThreadIndex)
+            {
+                for (UINT32 ix = 0; ix < NameNumPerThread; ++ix)
+                {
+                    BenchResource* Resource = Resources[ix * InConfig.ThreadNum + InThreadIndex].get();
+                    Registry.Insert(Resource);
+                    if (Registry.Find(Resource->Name) != Resource) MissNum.fetch_add(1, std::memory_order_relaxed);
+
+                    // 其他线程的名字可能还没插入, 但找到的一定是对的
+                    const BenchResource* Other = Resources[(ix * InConfig.ThreadNum + InThreadIndex + 1) % Resources.size()].get();
+                    const BenchResource* Found = Registry.Find(Other->Name);
+                    if (Found != nullptr && Found != Other) WrongNum.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        );
+        for (const auto& Resource : Resources)
+        {
+            if (Registry.Find(Resource->Name) != Resource.get()) MissNum.fetch_add(1, std::memory_order_relaxed);
+        }
+        printf_s("%.2f ms, %llu names registered, %u missed, %u wrong\n", Time, Registry.Size(), MissNum.load(), WrongNum.load());
+        bPassed &= MissNum.load() == 0 && WrongNum.load() == 0 && Registry.Size() == Resources.size();
+    }
+
+    printf_s("\n%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+
+struct ListElement
+{
+    static constexpr UINT64 AliveMagic = 0xA11CE5A11CE5A11Cull;
+
+    explicit ListElement(UINT64 InValue) : Value(InValue) {}
+    ~ListElement() { Magic = 0; }
+
+    UINT64 Value;
+    UINT64 Magic = AliveMagic;
+};
+
+// 元素的值: 最初的元素为[1, InitElementNum], 第ix个线程插入的为(ix + 1) << 32 | 序号
+static constexpr UINT64 InitElementNum = 64;
+
+template <typename L>
+static double RunListTraversal(L& InList, UINT32 InThreadNum, const BenchConfig& InConfig)
+{
+    std::atomic<UINT64> Sink = 0;
+    return RunThreads(
+        InThreadNum,
+        [&](UINT32 InThreadIndex)
+        {
+            const UINT64 ThreadTag = static_cast<UINT64>(InThreadIndex + 1) << 32;
+            UINT64 Sum = 0;
+            UINT64 InsertedNum = 0;
+            for (UINT32 ix = 0; ix < InConfig.OpNum; ++ix)
+            {
+                if (ix % InConfig.WriteInterval == InConfig.WriteInterval - 1)
+                {
+                    // 插入一个新元素, 在尾节点之前删掉本线程更早插入的元素
+                    InList.PushBack(ThreadTag | ++InsertedNum);
+                    InList.RemoveIf([ThreadTag, InsertedNum](ListElement* InElement) { return InElement->Value == (ThreadTag | (InsertedNum - 1)); });
+                }
+                InList.ForEach([&Sum](ListElement* InElement) { Sum += InElement->Value; });
+            }
+            Sink.fetch_add(Sum, std::memory_order_relaxed);
+        }
+    );
+}
+
+static bool BenchList(const BenchConfig& InConfig)
+{
+    printf_s("%llu elements, %u traversals per thread, one insert and remove every %u traversals\n\n", InitElementNum, InConfig.OpNum, InConfig.WriteInterval);
+    printf_s("%-24s %8s %12s %14s %14s\n", "List", "Threads", "Time(ms)", "ns/traversal", "ns/element");
+
+    const auto PrintResult = [&](const char* InName, UINT32 InThreadNum, double InTime)
+    {
+        const double TraversalNum = static_cast<double>(InThreadNum) * InConfig.OpNum;
+        printf_s("%-24s %8u %12.2f %14.1f %14.2f\n", InName, InThreadNum, InTime, InTime * 1e6 / TraversalNum, InTime * 1e6 / TraversalNum / InitElementNum);
+    };
+
+    for (UINT32 ThreadNum = 1; ThreadNum <= InConfig.ThreadNum; ThreadNum *= 2)
+    {
+        {
+            LegacyConcurrentList<ListElement> List;
+            for (UINT64 ix = 1; ix <= InitElementNum; ++ix) List.PushBack(ix);
+            PrintResult("LegacyConcurrentList", ThreadNum, RunListTraversal(List, ThreadNum, InConfig));
+        }
+        {
+            ConcurrentList<ListElement> List;
+            for (UINT64 ix = 1; ix <= InitElementNum; ++ix) List.PushBack(ix);
+            PrintResult("ConcurrentList", ThreadNum, RunListTraversal(List, ThreadNum, InConfig));
+        }
+    }
+
+    // 一半线程不停地插入和删除自己的元素, 另一半遍历和查找; 析构后的元素Magic为0, 遍历看到它说明节点被提前回收了
+    const UINT32 WriterNum = InConfig.ThreadNum / 2 > 0 ? InConfig.ThreadNum / 2 : 1;
+    printf_s("\nStress: %u writers and %u readers:\n", WriterNum, InConfig.ThreadNum);
+
+    bool bPassed = true;
+    {
+        ConcurrentList<ListElement> List;
+        for (UINT64 ix = 1; ix <= InitElementNum; ++ix) List.PushBack(ix);
+
+        std::atomic<UINT32> FinishedWriterNum = 0;
+        std::atomic<UINT64> DeadNum = 0;
+        std::atomic<UINT64> MissNum = 0;
+        RunThreads(
+            WriterNum + InConfig.ThreadNum,
+            [&](UINT32 InThreadIndex)
+            {
+                if (InThreadIndex < WriterNum)
+                {
+                    const UINT64 ThreadTag = static_cast<UINT64>(InThreadIndex + 1) << 32;
+                    for (UINT64 ix = 1; ix <= InConfig.OpNum; ++ix)
+                    {
+                        if (ix % 2 == 0) List.PushFront(ThreadTag | ix);
+                        else List.PushBack(ThreadTag | ix);
+                        if (ix > 4) List.RemoveIf([Value = ThreadTag | (ix - 4)](ListElement* InElement) { return InElement->Value == Value; });
+                    }
+                    List.RemoveIf([ThreadTag](ListElement* InElement) { return (InElement->Value & ~0xFFFFFFFFull) == ThreadTag; });
+                    FinishedWriterNum.fetch_add(1, std::memory_order_release);
+                    return;
+                }
+
+                UINT64 Round = 0;
+                while (FinishedWriterNum.load(std::memory_order_acquire) < WriterNum)
+                {
+                    UINT64 InitNum = 0;
+                    List.ForEach(
+                        [&](ListElement* InElement)
+                        {
+                            if (InElement->Magic != ListElement::AliveMagic) DeadNum.fetch_add(1, std::memory_order_relaxed);
+                            if (InElement->Value <= InitElementNum) InitNum++;
+                        }
+                    );
+                    if (InitNum != InitElementNum) MissNum.fetch_add(1, std::memory_order_relaxed);
+
+                    const UINT64 Target = 1 + Round++ % InitElementNum;
+                    if (List.FindFirstIf([Target](ListElement* InElement) { return InElement->Value == Target; }) == nullptr) MissNum.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        );
+
+        UINT64 RemainingNum = 0;
+        UINT64 RemainingSum = 0;
+        List.ForEach(
+            [&](ListElement* InElement)
+            {
+                RemainingNum++;
+                RemainingSum += InElement->Value;
+            }
+        );
+        printf_s(
+            "%llu dead elements seen, %llu traversals missed an initial element, %llu elements left (expected %llu)\n",
+            DeadNum.load(), MissNum.load(), RemainingNum, InitElementNum
+        );
+        bPassed = DeadNum.load() == 0 && MissNum.load() == 0 && RemainingNum == InitElementNum && RemainingSum == InitElementNum * (InitElementNum + 1) / 2;
+    }
+
+    printf_s("\n%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf_s("Usage: ContainerBench registry [--threads <n>]\n");
+        printf_s("       ContainerBench list [--threads <n>] [--ops <n>] [--write-every <n>]\n");
+        return 1;
+    }
+
+    BenchConfig Config;
+    for (int ix = 2; ix + 1 < argc; ix += 2)
+    {
+        if (strcmp(argv[ix], "--threads") == 0) Config.ThreadNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--ops") == 0) Config.OpNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--write-every") == 0) Config.WriteInterval = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+    }
+    if (Config.ThreadNum == 0 || Config.OpNum == 0 || Config.WriteInterval == 0)
+    {
+        printf_s("--threads, --ops and --write-every must be greater than 0.\n");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "registry") == 0)
+    {
+        if (!BenchRegistry(Config)) return 1;
+    }
+    else if (strcmp(argv[1], "list") == 0)
+    {
+        if (!BenchList(Config)) return 1;
+    }
+    else
+    {
+        printf_s("Unknown benchmark %s.\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+﻿#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "../../FantasyRenderer/RenderGraph/RenderGraphCore.h"
+#include "../../FantasyRenderer/RenderGraph/RenderGraphNullBackend.h"
+
+/*
+ * 在RenderGraphNullBackend上编译并执行随机生成的RenderGraph, 只用CPU, 不需要GPU.
+ * 每个Pass读若干之前写过的资源, 再写若干资源, 其中一部分是新建的临时资源; 第一个资源作为导入的back buffer, 由最后一个Pass写入.
+ * 输出编译和执行的平均耗时, 屏障, 别名次数和需要的显存; --log时输出最后一次执行的完整记录.
+ * 转换屏障同时与执行时按每次访问转换(之前的做法)的数量比较.
+ * 显存同时与不别名, 只复用描述完全相同的已释放资源(之前的做法)两种方式以及同时存活资源的峰值比较.
+ *
+ * 只依赖标准库, 除了RenderGraphBench.vcxproj也可以用同目录的CMakeLists.txt在Linux上构建, ctest运行几组小规模的配置.
+ *
+ * 用法: RenderGraphBench [--passes <n>] [--resources <n>] [--iterations <n>] [--seed <n>] [--log]
+ */
+
+struct BenchConfig
+{
+    uint32_t PassNum = 500;
+    uint32_t ResourceNum = 2000;
+    uint32_t IterationNum = 20;
+    uint32_t Seed = 1;
+    bool bLog = false;
+};
+
+static void BuildSyntheticGraph(RenderGraphCore* OutGraph, const BenchConfig& InConfig)
+{
+    static constexpr ERenderGraphResourceState ReadStates[] = { ERenderGraphResourceState::PixelShader, ERenderGraphResourceState::NonPixelShader, ERenderGraphResourceState::CopySrc };
+    static constexpr ERenderGraphResourceState WriteStates[] = { ERenderGraphResourceState::RenderTarget, ERenderGraphResourceState::UnorderedAccess, ERenderGraphResourceState::CopyDst };
+    static constexpr uint64_t Sizes[] = { 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024 };
+
+    std::mt19937 Random(InConfig.Seed);
+
+    RenderGraphResourceDesc BackBufferDesc;
+    BackBufferDesc.Name = "BackBuffer";
+    BackBufferDesc.Kind = ERenderGraphResourceKind::Texture;
+    BackBufferDesc.InitialState = ERenderGraphResourceState::Present;
+    BackBufferDesc.bImported = true;
+    BackBufferDesc.bOutput = true;
+    OutGraph->AddResource(BackBufferDesc);
+
+    // 资源在第一次被写之后才能被读
+    std::vector<uint32_t> WrittenResources;
+    uint32_t DeclaredResourceNum = 1;
+
+    for (uint32_t PassIndex = 0; PassIndex < InConfig.PassNum; ++PassIndex)
+    {
+        const uint32_t Pass = OutGraph->AddPass("Pass" + std::to_string(PassIndex), ERenderGraphPassType::Graphics);
+
+        const uint32_t ReadNum = WrittenResources.empty() ? 0 : Random() % 4;
+        for (uint32_t ix = 0; ix < ReadNum; ++ix)
+        {
+            // 偏向最近写的资源, 让生命周期有长有短
+            const uint32_t Window = static_cast<uint32_t>(WrittenResources.size() < 32 ? WrittenResources.size() : 32);
+            const uint32_t ResourceIndex = Random() % 8 == 0 ? WrittenResources[Random() % WrittenResources.size()] : WrittenResources[WrittenResources.size() - 1 - Random() % Window];
+            OutGraph->ReadResource(Pass, ResourceIndex, ReadStates[Random() % 3]);
+        }
+
+        const uint32_t WriteNum = 1 + Random() % 2;
+        for (uint32_t ix = 0; ix < WriteNum; ++ix)
+        {
+            uint32_t ResourceIndex;
+            if (DeclaredResourceNum < InConfig.ResourceNum && (WrittenResources.empty() || Random() % 4 != 0))
+            {
+                RenderGraphResourceDesc Desc;
+                Desc.Name = "Resource" + std::to_string(DeclaredResourceNum);
+                Desc.Kind = Random() % 2 == 0 ? ERenderGraphResourceKind::Texture : ERenderGraphResourceKind::Buffer;
+                Desc.Size = Sizes[Random() % 5];
+                Desc.Alignment = 64 * 1024;
+                ResourceIndex = OutGraph->AddResource(Desc);
+                DeclaredResourceNum++;
+            }
+            else
+            {
+                ResourceIndex = WrittenResources[Random() % WrittenResources.size()];
+            }
+            OutGraph->WriteResource(Pass, ResourceIndex, WriteStates[Random() % 3]);
+            WrittenResources.push_back(ResourceIndex);
+        }
+    }
+
+    OutGraph->WriteResource(InConfig.PassNum - 1, 0, ERenderGraphResourceState::CopyDst);
+}
+
+struct TransientMemoryStats
+{
+    uint64_t NoAliasing = 0;          // 每个临时资源单独分配
+    uint64_t DescMatchedReuse = 0;    // 只复用大小和对齐完全相同的已释放资源
+    uint64_t LivePeak = 0;            // 每个Pass上同时存活的临时资源大小之和的最大值, 任何放置方式的下界
+};
+
+static TransientMemoryStats ComputeTransientMemoryStats(const RenderGraphCore& InGraph)
+{
+    TransientMemoryStats Stats;
+
+    const std::vector<uint32_t>& ExecutionOrder = InGraph.GetExecutionOrder();
+    std::vector<uint32_t> PassOrders(InGraph.GetPassNum());
+    for (uint32_t ix = 0; ix < ExecutionOrder.size(); ++ix) PassOrders[ExecutionOrder[ix]] = ix;
+
+    std::vector<std::vector<uint32_t>> CreatedResources(ExecutionOrder.size());
+    std::vector<std::vector<uint32_t>> ReleasedResources(ExecutionOrder.size());
+    for (uint32_t ix = 0; ix < InGraph.GetResourceNum(); ++ix)
+    {
+        if (InGraph.GetResource(ix).bImported || InGraph.GetResourceFirstPass(ix) == RENDER_GRAPH_INVALID_INDEX) continue;
+        CreatedResources[PassOrders[InGraph.GetResourceFirstPass(ix)]].push_back(ix);
+        ReleasedResources[PassOrders[InGraph.GetResourceLastPass(ix)]].push_back(ix);
+    }
+
+    uint64_t LiveMemory = 0;
+    std::vector<uint32_t> FreeResources;
+    for (uint32_t Order = 0; Order < ExecutionOrder.size(); ++Order)
+    {
+        for (const uint32_t ResourceIndex : CreatedResources[Order])
+        {
+            const RenderGraphResourceDesc& Desc = InGraph.GetResource(ResourceIndex);
+            Stats.NoAliasing += Desc.Size;
+            LiveMemory += Desc.Size;
+
+            bool bReused = false;
+            for (uint32_t ix = 0; ix < FreeResources.size(); ++ix)
+            {
+                const RenderGraphResourceDesc& FreeDesc = InGraph.GetResource(FreeResources[ix]);
+                if (FreeDesc.Kind == Desc.Kind && FreeDesc.Size == Desc.Size && FreeDesc.Alignment == Desc.Alignment)
+                {
+                    FreeResources.erase(FreeResources.begin() + ix);
+                    bReused = true;
+                    break;
+                }
+            }
+            if (!bReused) Stats.DescMatchedReuse += Desc.Size;
+        }
+        if (LiveMemory > Stats.LivePeak) Stats.LivePeak = LiveMemory;
+
+        for (const uint32_t ResourceIndex : ReleasedResources[Order])
+        {
+            LiveMemory -= InGraph.GetResource(ResourceIndex).Size;
+            FreeResources.push_back(ResourceIndex);
+        }
+    }
+    return Stats;
+}
+
+// 执行时按每次访问的状态逐个转换需要的屏障数, 不合并只读状态
+static uint32_t CountPerAccessBarriers(const RenderGraphCore& InGraph)
+{
+    std::vector<ERenderGraphResourceState> ResourceStates(InGraph.GetResourceNum());
+    for (uint32_t ix = 0; ix < InGraph.GetResourceNum(); ++ix) ResourceStates[ix] = InGraph.GetResource(ix).InitialState;
+
+    uint32_t BarrierNum = 0;
+    for (const uint32_t PassIndex : InGraph.GetExecutionOrder())
+    {
+        for (const RenderGraphResourceAccess& Access : InGraph.GetPass(PassIndex).Accesses)
+        {
+            if (ResourceStates[Access.ResourceIndex] == Access.State) continue;
+
+            ResourceStates[Access.ResourceIndex] = Access.State;
+            BarrierNum++;
+        }
+    }
+    return BarrierNum;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig Config;
+    for (int ix = 1; ix < argc; ++ix)
+    {
+        if (strcmp(argv[ix], "--log") == 0) Config.bLog = true;
+        else if (ix + 1 < argc && strcmp(argv[ix], "--passes") == 0) Config.PassNum = static_cast<uint32_t>(std::atoi(argv[++ix]));
+        else if (ix + 1 < argc && strcmp(argv[ix], "--resources") == 0) Config.ResourceNum = static_cast<uint32_t>(std::atoi(argv[++ix]));
+        else if (ix + 1 < argc && strcmp(argv[ix], "--iterations") == 0) Config.IterationNum = static_cast<uint32_t>(std::atoi(argv[++ix]));
+        else if (ix + 1 < argc && strcmp(argv[ix], "--seed") == 0) Config.Seed = static_cast<uint32_t>(std::atoi(argv[++ix]));
+    }
+    if (Config.PassNum == 0 || Config.ResourceNum == 0 || Config.IterationNum == 0)
+    {
+        printf("Usage: RenderGraphBench [--passes <n>] [--resources <n>] [--iterations <n>] [--seed <n>] [--log]\n");
+        return 1;
+    }
+
+    RenderGraphCore Graph;
+    BuildSyntheticGraph(&Graph, Config);
+
+    RenderGraphNullBackend Backend;
+    Backend.SetRecordEvents(false);
+
+    double CompileTime = 0.0;
+    double ExecuteTime = 0.0;
+    try
+    {
+        for (uint32_t ix = 0; ix < Config.IterationNum; ++ix)
+        {
+            // 只在最后一次执行时记录事件
+            const bool bLastIteration = ix + 1 == Config.IterationNum;
+            Backend.Reset();
+            Backend.SetRecordEvents(bLastIteration && Config.bLog);
+
+            const auto CompileBegin = std::chrono::steady_clock::now();
+            Graph.Compile();
+            const auto CompileEnd = std::chrono::steady_clock::now();
+            Graph.Execute(&Backend, &Backend);
+            const auto ExecuteEnd = std::chrono::steady_clock::now();
+
+            CompileTime += std::chrono::duration<double, std::milli>(CompileEnd - CompileBegin).count();
+            ExecuteTime += std::chrono::duration<double, std::milli>(ExecuteEnd - CompileEnd).count();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("%s\n", e.what());
+        return 1;
+    }
+
+    if (Config.bLog) printf("%s\n", Backend.DumpEvents(Graph).c_str());
+
+    uint64_t EdgeNum = 0;
+    for (uint32_t ix = 0; ix < Graph.GetPassNum(); ++ix) EdgeNum += Graph.GetPassSuccessors(ix).size();
+
+    uint32_t CulledResourceNum = 0;
+    for (uint32_t ix = 0; ix < Graph.GetResourceNum(); ++ix)
+    {
+        if (Graph.GetResourceFirstPass(ix) == RENDER_GRAPH_INVALID_INDEX) CulledResourceNum++;
+    }
+
+    printf("%u passes, %u resources, %" PRIu64 " dependency edges (%" PRIu64 " redundant removed)\n", Graph.GetPassNum(), Graph.GetResourceNum(), EdgeNum, Graph.GetRedundantEdgeNum());
+    printf("Culled passes:       %u\n", Graph.GetCulledPassNum());
+    printf("Unused resources:    %u\n", CulledResourceNum);
+    printf("Compile:  %10.3f ms\n", CompileTime / Config.IterationNum);
+    printf("Execute:  %10.3f ms\n", ExecuteTime / Config.IterationNum);
+    printf("Created resources:   %u\n", Backend.GetCreatedResourceNum());
+    printf("Transition barriers: %u (split %u, per-access %u)\n", Backend.GetTransitionBarrierNum(), Backend.GetSplitBarrierNum(), CountPerAccessBarriers(Graph));
+    printf("Barrier batches:     %u\n", Backend.GetBarrierBatchNum());
+    printf("Aliasing barriers:   %u\n", Backend.GetAliasingBarrierNum());
+    printf("Transient memory:    %" PRIu64 " KB\n", Backend.GetAllocatedMemory() / 1024);
+
+    const TransientMemoryStats Stats = ComputeTransientMemoryStats(Graph);
+    printf("  No aliasing:              %10" PRIu64 " KB\n", Stats.NoAliasing / 1024);
+    printf("  Descriptor-matched reuse: %10" PRIu64 " KB\n", Stats.DescMatchedReuse / 1024);
+    printf("  Planned heaps:            %10" PRIu64 " KB (buffer %" PRIu64 " KB, texture %" PRIu64 " KB)\n",
+        (Graph.GetTransientHeapSize(ERenderGraphResourceKind::Buffer) + Graph.GetTransientHeapSize(ERenderGraphResourceKind::Texture)) / 1024,
+        Graph.GetTransientHeapSize(ERenderGraphResourceKind::Buffer) / 1024,
+        Graph.GetTransientHeapSize(ERenderGraphResourceKind::Texture) / 1024);
+    printf("  Live peak (lower bound):  %10" PRIu64 " KB\n", Stats.LivePeak / 1024);
+    return 0;
+}
@@ -0,0 +1,970 @@
+﻿#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../FantasyRenderer/TaskFlow/TaskExecutor.h"
+#include "../../FantasyRenderer/Utility/Macros.h"
+
+/*
+ * TaskFlow的性能测试, 只用CPU.
+ * pool: 在重写前后的线程池上执行大量很小的任务, 分别测试从外部线程提交和在任务中嵌套提交.
+ * idle: 每次提交前先空闲--gap-us微秒, 测量从提交到任务开始执行的延迟; 再让线程池空闲--idle-ms毫秒, 测量进程占用的CPU时间.
+ * flow: 反复执行与RenderGraph::Compile()规模相当的随机DAG, 比较未编译(由调用线程分发)和编译后的TaskFlow;
+ *       并检查编译执行后再添加任务, 按未编译方式执行, 再重新编译执行时每个任务都正好执行一次;
+ *       以及后继数超过共享队列和完成队列容量的宽扇出DAG在两种方式下都能执行完.
+ * parallel: 在不同大小的Mesh上做顶点格式转换(ParallelFor)和AABB计算(ParallelReduce), 与单线程循环比较;
+ *           并检查嵌套调用和异常的传递.
+ * makespan: 执行形状类似一帧RenderGraph的DAG(一条长的主Pass链, 几条阴影Pass支链和大量独立的短任务),
+ *           比较按添加顺序, 按关键路径, 按关键路径并提高主Pass链优先级调度时一帧的完成时间.
+ * queue: 多个生产者和消费者通过队列传递整数, 比较BoundedMPMCQueue(容量1024, 满时Push阻塞), 重写之前的双锁链表队列
+ *        和TaskQueue(只能有一个消费者, 只测单消费者的组合), 并检查每个值都正好被取出一次.
+ * Legacy开头的类拷贝自重写之前的代码, 只用于对比.
+ *
+ * 用法: TaskFlowBench pool [--threads <n>] [--tasks <n>] [--iterations <n>]
+ *       TaskFlowBench idle [--threads <n>] [--samples <n>] [--gap-us <n>] [--idle-ms <n>]
+ *       TaskFlowBench flow [--threads <n>] [--nodes <n>] [--runs <n>] [--seed <n>]
+ *       TaskFlowBench parallel [--threads <n>] [--iterations <n>]
+ *       TaskFlowBench makespan [--threads <n>] [--runs <n>]
+ *       TaskFlowBench queue [--tasks <n>]
+ */
+
+struct BenchConfig
+{
+    UINT32 ThreadNum = 0;       // 为0时使用物理核数
+    UINT32 TaskNum = 100000;
+    UINT32 IterationNum = 10;
+    UINT32 SampleNum = 1000;
+    UINT32 GapUs = 1000;
+    UINT32 IdleMs = 2000;
+    UINT32 NodeNum = 500;
+    UINT32 RunNum = 2000;
+    UINT32 Seed = 1;
+};
+
+
+// 重写之前的ThreadPool使用的队列, 头尾各一个锁, 每次Push分配两次内存
+template <typename T>
+class LegacyConcurrentQueue
+{
+    struct Node
+    {
+        std::shared_ptr<T> Value;
+        std::unique_ptr<Node> Next;
+    };
+public:
+    CLASS_NO_COPY(LegacyConcurrentQueue)
+
+    LegacyConcurrentQueue() : Head(std::make_unique<Node>()), Tail(Head.get()) {}
+    ~LegacyConcurrentQueue() = default;
+
+public:
+    void Push(T InValue)
+    {
+        std::shared_ptr<T> Value = std::make_shared<T>(std::move(InValue));
+        std::unique_ptr<Node> NewDummyNode = std::make_unique<Node>();
+        Node* NewTail = NewDummyNode.get();
+        {
+            std::lock_guard LockGuard(TailMutex);
+            Tail->Value = Value;
+            Tail->Next = std::move(NewDummyNode);
+            Tail = NewTail;
+        }
+    }
+
+    bool TryPop(T& OutValue)
+    {
+        std::lock_guard LockGuard(HeadMutex);
+        if (Head.get() == GetTail()) return false;
+
+        OutValue = std::move(*Head->Value);
+        std::unique_ptr<Node> OldHead = std::move(Head);
+        Head = std::move(OldHead->Next);
+        return true;
+    }
+
+private:
+    Node* GetTail() const
+    {
+        std::lock_guard LockGuard(TailMutex);
+        return Tail;
+    }
+
+private:
+    std::unique_ptr<Node> Head;
+    Node* Tail;
+
+    mutable std::mutex HeadMutex;
+    mutable std::mutex TailMutex;
+};
+
+// 重写之前的TaskQueue, 一个锁加一个条件变量, 先Wait()再Pop(), 所以只能有一个消费者
+template <typename T>
+class LegacyTaskQueue
+{
+public:
+    void Push(const T& InValue)
+    {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        Queue.push_back(InValue);
+        ConditionVariable.notify_one();
+    }
+
+    T Pop()
+    {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        T Value = Queue.front();
+        Queue.pop_front();
+        return Value;
+    }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        ConditionVariable.wait(Lock, [this]() { return !Queue.empty(); });
+    }
+
+private:
+    std::condition_variable ConditionVariable;
+    std::mutex Mutex;
+    std::deque<T> Queue;
+};
+
+// 重写之前的ThreadPool, 所有线程共用一个队列, 空闲时yield自旋
+class LegacyThreadPool
+{
+public:
+    CLASS_NO_COPY(LegacyThreadPool)
+
+    explicit LegacyThreadPool(UINT32 InThreadNum)
+    {
+        for (UINT32 ix = 0; ix < InThreadNum; ++ix)
+        {
+            Threads.emplace_back(&LegacyThreadPool::WorkerThread, this);
+        }
+    }
+
+    ~LegacyThreadPool()
+    {
+        Done = true;
+        for (auto& Thread : Threads) Thread.join();
+    }
+
+    template <typename F>
+    auto Submit(F&& InFunc) -> std::future<decltype(InFunc())>
+    {
+        using ReturnType = decltype(InFunc());
+
+        auto Task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(InFunc));
+        std::future<ReturnType> Result(Task->get_future());
+
+        PoolTaskQueue.Push([Task]() { (*Task)(); });
+
+        return Result;
+    }
+
+private:
+    void WorkerThread()
+    {
+        while (!Done)
+        {
+            FunctionWrapper Task;
+            if (PoolTaskQueue.TryPop(Task))
+            {
+                Task();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    std::atomic<bool> Done = false;
+
+    std::vector<std::thread> Threads;
+    LegacyConcurrentQueue<FunctionWrapper> PoolTaskQueue;
+};
+
+
+// 所有任务完成时唤醒等待的线程. 在多次测试之间复用, 避免最后一个任务通知时它已经被销毁
+class CompletionCounter
+{
+public:
+    void Reset(UINT64 InNum)
+    {
+        UnfinishedNum.store(InNum, std::memory_order_relaxed);
+    }
+
+    void Finish()
+    {
+        if (UnfinishedNum.fetch_sub(1, std::memory_order_acq_rel) == 1) UnfinishedNum.notify_all();
+    }
+
+    void Wait() const
+    {
+        UINT64 Num = UnfinishedNum.load(std::memory_order_acquire);
+        while (Num != 0)
+        {
+            UnfinishedNum.wait(Num, std::memory_order_acquire);
+            Num = UnfinishedNum.load(std::memory_order_acquire);
+        }
+    }
+
+private:
+    std::atomic<UINT64> UnfinishedNum = 0;
+};
+
+// 模拟很小的任务, 大约几十纳秒
+static std::atomic<UINT32> WorkSink = 0;
+static void TinyWork(UINT32 InSeed)
+{
+    UINT32 Value = InSeed | 1;
+    for (UINT32 ix = 0; ix < 32; ++ix)
+    {
+        Value ^= Value << 13;
+        Value ^= Value >> 17;
+        Value ^= Value << 5;
+    }
+    WorkSink.fetch_add(Value & 1, std::memory_order_relaxed);
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point InBegin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - InBegin).count();
+}
+
+
+// 调用线程逐个提交所有任务
+template <typename S>
+static double RunExternalSubmit(const BenchConfig& InConfig, const S& InSubmit)
+{
+    CompletionCounter Counter;
+    double TotalTime = 0.0;
+    for (UINT32 Iteration = 0; Iteration < InConfig.IterationNum; ++Iteration)
+    {
+        Counter.Reset(InConfig.TaskNum);
+        const auto Begin = std::chrono::steady_clock::now();
+        for (UINT32 ix = 0; ix < InConfig.TaskNum; ++ix)
+        {
+            InSubmit([&Counter, ix]() { TinyWork(ix); Counter.Finish(); });
+        }
+        Counter.Wait();
+        TotalTime += ElapsedMs(Begin);
+    }
+    return TotalTime / InConfig.IterationNum;
+}
+
+// 每个线程一个根任务, 由根任务在工作线程上提交其余的任务, 类似每帧Pass的扇出
+template <typename S>
+static double RunNestedSubmit(const BenchConfig& InConfig, const S& InSubmit)
+{
+    const UINT32 RootNum = InConfig.ThreadNum;
+    const UINT32 ChildNum = InConfig.TaskNum / RootNum;
+
+    CompletionCounter Counter;
+    double TotalTime = 0.0;
+    for (UINT32 Iteration = 0; Iteration < InConfig.IterationNum; ++Iteration)
+    {
+        Counter.Reset(static_cast<UINT64>(RootNum) * (ChildNum + 1));
+        const auto Begin = std::chrono::steady_clock::now();
+        for (UINT32 RootIndex = 0; RootIndex < RootNum; ++RootIndex)
+        {
+            InSubmit(
+                [&Counter, &InSubmit, ChildNum, RootIndex]()
+                {
+                    for (UINT32 ix = 0; ix < ChildNum; ++ix)
+                    {
+                        InSubmit([&Counter, ix]() { TinyWork(ix); Counter.Finish(); });
+                    }
+                    TinyWork(RootIndex);
+                    Counter.Finish();
+                }
+            );
+        }
+        Counter.Wait();
+        TotalTime += ElapsedMs(Begin);
+    }
+    return TotalTime / InConfig.IterationNum;
+}
+
+static void PrintPoolResult(const char* InName, double InExternalTime, double InNestedTime, const BenchConfig& InConfig)
+{
+    printf_s(
+        "%-32s %12.3f %10.1f %12.3f %10.1f\n",
+        InName,
+        InExternalTime, InExternalTime * 1e6 / InConfig.TaskNum,
+        InNestedTime, InNestedTime * 1e6 / InConfig.TaskNum
+    );
+}
+
+static void BenchPool(const BenchConfig& InConfig)
+{
+    printf_s("%u threads, %u tasks, %u iterations\n\n", InConfig.ThreadNum, InConfig.TaskNum, InConfig.IterationNum);
+    printf_s("%-32s %12s %10s %12s %10s\n", "Pool", "External(ms)", "ns/task", "Nested(ms)", "ns/task");
+
+    {
+        LegacyThreadPool Pool(InConfig.ThreadNum);
+        const auto Submit = [&Pool](auto&& InFunc) { Pool.Submit(std::move(InFunc)); };
+        const double ExternalTime = RunExternalSubmit(InConfig, Submit);
+        const double NestedTime = RunNestedSubmit(InConfig, Submit);
+        PrintPoolResult("Legacy ThreadPool::Submit", ExternalTime, NestedTime, InConfig);
+    }
+    {
+        ThreadPool Pool(InConfig.ThreadNum);
+        const auto Submit = [&Pool](auto&& InFunc) { Pool.Submit(std::move(InFunc)); };
+        const double ExternalTime = RunExternalSubmit(InConfig, Submit);
+        const double NestedTime = RunNestedSubmit(InConfig, Submit);
+        PrintPoolResult("ThreadPool::Submit", ExternalTime, NestedTime, InConfig);
+    }
+    {
+        ThreadPool Pool(InConfig.ThreadNum);
+        const auto Submit = [&Pool](auto&& InFunc) { Pool.SubmitDetached(std::move(InFunc)); };
+        const double ExternalTime = RunExternalSubmit(InConfig, Submit);
+        const double NestedTime = RunNestedSubmit(InConfig, Submit);
+        PrintPoolResult("ThreadPool::SubmitDetached", ExternalTime, NestedTime, InConfig);
+    }
+}
+
+
+// 进程在用户态和内核态占用的CPU时间
+static double GetProcessCPUTimeMs()
+{
+#ifdef _WIN32
+    FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+    GetProcessTimes(GetCurrentProcess(), &CreationTime, &ExitTime, &KernelTime, &UserTime);
+
+    const auto ToUINT64 = [](const FILETIME& InTime) { return (static_cast<UINT64>(InTime.dwHighDateTime) << 32) | InTime.dwLowDateTime; };
+    return static_cast<double>(ToUINT64(KernelTime) + ToUINT64(UserTime)) / 10000.0;     // 100纳秒为单位
+#else
+    return static_cast<double>(std::clock()) * 1000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+struct IdleResult
+{
+    double LatencyP50 = 0.0;    // 微秒
+    double LatencyP99 = 0.0;
+    double LatencyMax = 0.0;
+    double IdleCoreNum = 0.0;   // 空闲期间平均占满的核数
+};
+
+template <typename S>
+static IdleResult RunIdle(const BenchConfig& InConfig, const S& InSubmit)
+{
+    IdleResult Result;
+
+    CompletionCounter Counter;
+    std::vector<double> Latencies(InConfig.SampleNum);
+    for (UINT32 ix = 0; ix < InConfig.SampleNum; ++ix)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(InConfig.GapUs));
+
+        std::chrono::steady_clock::time_point StartTime;
+        Counter.Reset(1);
+        const auto SubmitTime = std::chrono::steady_clock::now();
+        InSubmit([&Counter, &StartTime]() { StartTime = std::chrono::steady_clock::now(); Counter.Finish(); });
+        Counter.Wait();
+
+        Latencies[ix] = std::chrono::duration<double, std::micro>(StartTime - SubmitTime).count();
+    }
+    std::sort(Latencies.begin(), Latencies.end());
+    Result.LatencyP50 = Latencies[Latencies.size() / 2];
+    Result.LatencyP99 = Latencies[Latencies.size() * 99 / 100];
+    Result.LatencyMax = Latencies.back();
+
+    const double CPUTimeBegin = GetProcessCPUTimeMs();
+    const auto IdleBegin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(InConfig.IdleMs));
+    Result.IdleCoreNum = (GetProcessCPUTimeMs() - CPUTimeBegin) / ElapsedMs(IdleBegin);
+
+    return Result;
+}
+
+static void PrintIdleResult(const char* InName, const IdleResult& InResult)
+{
+    printf_s("%-32s %10.1f %10.1f %10.1f %12.2f\n", InName, InResult.LatencyP50, InResult.LatencyP99, InResult.LatencyMax, InResult.IdleCoreNum);
+}
+
+static void BenchIdle(const BenchConfig& InConfig)
+{
+    printf_s("%u threads, %u samples, %u us gap, %u ms idle\n\n", InConfig.ThreadNum, InConfig.SampleNum, InConfig.GapUs, InConfig.IdleMs);
+    printf_s("%-32s %10s %10s %10s %12s\n", "Pool", "P50(us)", "P99(us)", "Max(us)", "IdleCores");
+
+    {
+        LegacyThreadPool Pool(InConfig.ThreadNum);
+        PrintIdleResult("Legacy ThreadPool", RunIdle(InConfig, [&Pool](auto&& InFunc) { Pool.Submit(std::move(InFunc)); }));
+    }
+    {
+        ThreadPool Pool(InConfig.ThreadNum);
+        PrintIdleResult("ThreadPool", RunIdle(InConfig, [&Pool](auto&& InFunc) { Pool.SubmitDetached(std::move(InFunc)); }));
+
+        const ThreadPoolStats Stats = Pool.GetStats();
+        printf_s("  spins %llu, parks %llu, wakeups %llu\n", Stats.SpinNum, Stats.ParkNum, Stats.WakeupNum);
+    }
+}
+
+
+// 每个节点依赖最近的若干节点中的1~3个, 偶尔依赖很早的节点, 与RenderGraphBench生成的Pass依赖类似
+static std::vector<Task> BuildRandomFlow(TaskFlow* OutFlow, UINT32 InNodeNum, UINT32 InSeed)
+{
+    std::mt19937 Random(InSeed);
+
+    std::vector<Task> Tasks;
+    Tasks.reserve(InNodeNum);
+    for (UINT32 ix = 0; ix < InNodeNum; ++ix)
+    {
+        Tasks.push_back(OutFlow->Emplace([ix]() { TinyWork(ix); }));
+        if (ix == 0) continue;
+
+        const UINT32 DependentNum = 1 + Random() % 3;
+        for (UINT32 jx = 0; jx < DependentNum; ++jx)
+        {
+            const UINT32 Window = ix < 32 ? ix : 32;
+            const UINT32 DependentIndex = Random() % 8 == 0 ? Random() % ix : ix - 1 - Random() % Window;
+            Tasks[DependentIndex].Precede(Tasks[ix]);
+        }
+    }
+    return Tasks;
+}
+
+static bool CheckRecompile(TaskExecutor& InExecutor)
+{
+    static constexpr UINT32 NodeNum = 64;
+
+    std::vector<UINT32> RunCounts(NodeNum + 1, 0);
+    TaskFlow Flow;
+    std::vector<Task> Tasks;
+    for (UINT32 ix = 0; ix < NodeNum; ++ix)
+    {
+        Tasks.push_back(Flow.Emplace([&RunCounts, ix]() { RunCounts[ix]++; }));
+        if (ix > 0) Tasks[ix - 1].Precede(Tasks[ix]);
+        if (ix > 2) Tasks[ix / 2].Precede(Tasks[ix]);
+    }
+
+    const auto CheckRunCounts = [&RunCounts](UINT32 InExpected, UINT32 InExpectedExtra)
+    {
+        for (UINT32 ix = 0; ix < NodeNum; ++ix)
+        {
+            if (RunCounts[ix] != InExpected) return false;
+        }
+        return RunCounts[NodeNum] == InExpectedExtra;
+    };
+
+    Flow.Compile();
+    InExecutor.Run(Flow);
+    if (!CheckRunCounts(1, 0)) return false;
+
+    Task Extra = Flow.Emplace([&RunCounts]() { RunCounts[NodeNum]++; });
+    Tasks.back().Precede(Extra);
+    Tasks[0].Precede(Extra);
+    InExecutor.Run(Flow);
+    if (!CheckRunCounts(2, 1)) return false;
+
+    Flow.Compile();
+    InExecutor.Run(Flow);
+    InExecutor.Run(Flow);
+    return CheckRunCounts(4, 3);
+}
+
+static bool CheckWideFanOut(TaskExecutor& InExecutor)
+{
+    // 比线程池的共享队列(4096)和TaskExecutor的完成队列(1024)都大, 分发线程不能阻塞在提交上
+    static constexpr UINT32 SuccessorNum = 8192;
+
+    std::vector<std::atomic<UINT32>> RunCounts(SuccessorNum + 1);
+    TaskFlow Flow;
+    Task Source = Flow.Emplace([&RunCounts]() { RunCounts[SuccessorNum].fetch_add(1, std::memory_order_relaxed); });
+    for (UINT32 ix = 0; ix < SuccessorNum; ++ix)
+    {
+        Source.Precede(Flow.Emplace([&RunCounts, ix]() { RunCounts[ix].fetch_add(1, std::memory_order_relaxed); }));
+    }
+
+    const auto CheckRunCounts = [&RunCounts](UINT32 InExpected)
+    {
+        for (const auto& RunCount : RunCounts)
+        {
+            if (RunCount.load(std::memory_order_relaxed) != InExpected) return false;
+        }
+        return true;
+    };
+
+    InExecutor.Run(Flow);
+    if (!CheckRunCounts(1)) return false;
+
+    Flow.Compile();
+    InExecutor.Run(Flow);
+    return CheckRunCounts(2);
+}
+
+static bool BenchFlow(const BenchConfig& InConfig)
+{
+    printf_s("%u threads, %u nodes, %u runs\n\n", InConfig.ThreadNum, InConfig.NodeNum, InConfig.RunNum);
+
+    TaskExecutor Executor(InConfig.ThreadNum);
+
+    TaskFlow Flow;
+    BuildRandomFlow(&Flow, InConfig.NodeNum, InConfig.Seed);
+
+    printf_s("%-32s %12s %10s\n", "TaskFlow", "Run(us)", "ns/node");
+
+    auto Begin = std::chrono::steady_clock::now();
+    for (UINT32 ix = 0; ix < InConfig.RunNum; ++ix) Executor.Run(Flow);
+    double RunTime = ElapsedMs(Begin) * 1000.0 / InConfig.RunNum;
+    printf_s("%-32s %12.2f %10.1f\n", "Dispatcher thread", RunTime, RunTime * 1000.0 / InConfig.NodeNum);
+
+    Flow.Compile();
+    Begin = std::chrono::steady_clock::now();
+    for (UINT32 ix = 0; ix < InConfig.RunNum; ++ix) Executor.Run(Flow);
+    RunTime = ElapsedMs(Begin) * 1000.0 / InConfig.RunNum;
+    printf_s("%-32s %12.2f %10.1f\n", "Compiled", RunTime, RunTime * 1000.0 / InConfig.NodeNum);
+
+    const bool bRecompilePassed = CheckRecompile(Executor);
+    printf_s("\nCompile -> Run -> Emplace -> Run -> Compile -> Run: %s\n", bRecompilePassed ? "passed" : "FAILED");
+
+    const bool bFanOutPassed = CheckWideFanOut(Executor);
+    printf_s("1 -> 8192 fan-out, dispatcher thread and compiled: %s\n", bFanOutPassed ? "passed" : "FAILED");
+    return bRecompilePassed && bFanOutPassed;
+}
+
+
+struct BenchVertex
+{
+    float Position[3];
+    float Normal[3];
+    float UV[2];
+    UINT32 MeshIndex;
+};
+
+struct BenchBox
+{
+    float Min[3];
+    float Max[3];
+};
+
+static BenchBox JoinBox(const BenchBox& InLhs, const BenchBox& InRhs)
+{
+    BenchBox Result;
+    for (UINT32 ix = 0; ix < 3; ++ix)
+    {
+        Result.Min[ix] = InLhs.Min[ix] < InRhs.Min[ix] ? InLhs.Min[ix] : InRhs.Min[ix];
+        Result.Max[ix] = InLhs.Max[ix] > InRhs.Max[ix] ? InLhs.Max[ix] : InRhs.Max[ix];
+    }
+    return Result;
+}
+
+// 与ModelLoader::LoadGLTFNode()一样从按步长排列的属性中读出顶点
+static void ConvertVertex(const std::vector<float>& InAttributes, UINT64 InIndex, BenchVertex* OutVertex)
+{
+    const float* Attribute = InAttributes.data() + InIndex * 8;
+    memcpy(OutVertex->Position, Attribute, sizeof(float) * 3);
+    memcpy(OutVertex->Normal, Attribute + 3, sizeof(float) * 3);
+    memcpy(OutVertex->UV, Attribute + 6, sizeof(float) * 2);
+    OutVertex->MeshIndex = 0;
+}
+
+static void ExpandBox(const BenchVertex& InVertex, BenchBox& InOutBox)
+{
+    for (UINT32 ix = 0; ix < 3; ++ix)
+    {
+        if (InVertex.Position[ix] < InOutBox.Min[ix]) InOutBox.Min[ix] = InVertex.Position[ix];
+        if (InVertex.Position[ix] > InOutBox.Max[ix]) InOutBox.Max[ix] = InVertex.Position[ix];
+    }
+}
+
+static bool CheckParallel(TaskExecutor& InExecutor)
+{
+    // 在任务中嵌套调用
+    std::atomic<UINT64> Sum = 0;
+    InExecutor.ParallelFor(0, 64, 1, [&InExecutor, &Sum](UINT64 InOuterIndex)
+    {
+        const UINT64 InnerSum = InExecutor.ParallelReduce(0, 1000, 0, UINT64(0), [](UINT64 ix, UINT64& InOutValue) { InOutValue += ix; }, [](UINT64 InLhs, UINT64 InRhs) { return InLhs + InRhs; });
+        Sum.fetch_add(InnerSum + InOuterIndex, std::memory_order_relaxed);
+    });
+    if (Sum.load() != 64 * 499500 + 2016) return false;
+
+    // 第一个异常在所有块结束后重新抛出
+    try
+    {
+        InExecutor.ParallelFor(0, 100000, 0, [](UINT64 ix) { if (ix == 12345) throw std::runtime_error("ParallelFor"); });
+        return false;
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+    return true;
+}
+
+static bool BenchParallel(const BenchConfig& InConfig)
+{
+    static constexpr UINT64 VertexNums[] = { 1000, 10000, 100000, 1000000 };
+
+    printf_s("%u threads, %u iterations\n\n", InConfig.ThreadNum, InConfig.IterationNum);
+    printf_s("%10s %12s %12s %12s %12s %12s %12s\n", "Vertices", "For(ms)", "Par(ms)", "Par4096(ms)", "Reduce(ms)", "Par(ms)", "Par4096(ms)");
+
+    TaskExecutor Executor(InConfig.ThreadNum);
+
+    std::mt19937 Random(1);
+    std::uniform_real_distribution<float> Distribution(-100.0f, 100.0f);
+    for (const UINT64 VertexNum : VertexNums)
+    {
+        std::vector<float> Attributes(VertexNum * 8);
+        for (auto& Value : Attributes) Value = Distribution(Random);
+        std::vector<BenchVertex> Vertices(VertexNum);
+
+        double ConvertTimes[3] = {};
+        double ReduceTimes[3] = {};
+        BenchBox Boxes[3];
+        for (UINT32 Iteration = 0; Iteration < InConfig.IterationNum; ++Iteration)
+        {
+            auto Begin = std::chrono::steady_clock::now();
+            for (UINT64 ix = 0; ix < VertexNum; ++ix) ConvertVertex(Attributes, ix, &Vertices[ix]);
+            ConvertTimes[0] += ElapsedMs(Begin);
+
+            const BenchBox Identity{ { 1e30f, 1e30f, 1e30f }, { -1e30f, -1e30f, -1e30f } };
+            Begin = std::chrono::steady_clock::now();
+            Boxes[0] = Identity;
+            for (UINT64 ix = 0; ix < VertexNum; ++ix) ExpandBox(Vertices[ix], Boxes[0]);
+            ReduceTimes[0] += ElapsedMs(Begin);
+
+            for (UINT32 Mode = 1; Mode < 3; ++Mode)
+            {
+                const UINT64 GrainSize = Mode == 1 ? 0 : 4096;
+
+                Begin = std::chrono::steady_clock::now();
+                Executor.ParallelFor(0, VertexNum, GrainSize, [&](UINT64 ix) { ConvertVertex(Attributes, ix, &Vertices[ix]); });
+                ConvertTimes[Mode] += ElapsedMs(Begin);
+
+                Begin = std::chrono::steady_clock::now();
+                Boxes[Mode] = Executor.ParallelReduce(0, VertexNum, GrainSize, Identity, [&Vertices](UINT64 ix, BenchBox& InOutBox) { ExpandBox(Vertices[ix], InOutBox); }, JoinBox);
+                ReduceTimes[Mode] += ElapsedMs(Begin);
+            }
+        }
+
+        if (memcmp(&Boxes[0], &Boxes[1], sizeof(BenchBox)) != 0 || memcmp(&Boxes[0], &Boxes[2], sizeof(BenchBox)) != 0)
+        {
+            printf_s("ParallelReduce result mismatch.\n");
+            return false;
+        }
+
+        printf_s(
+            "%10llu %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n",
+            VertexNum,
+            ConvertTimes[0] / InConfig.IterationNum, ConvertTimes[1] / InConfig.IterationNum, ConvertTimes[2] / InConfig.IterationNum,
+            ReduceTimes[0] / InConfig.IterationNum, ReduceTimes[1] / InConfig.IterationNum, ReduceTimes[2] / InConfig.IterationNum
+        );
+    }
+
+    const bool bPassed = CheckParallel(Executor);
+    printf_s("\nNested calls and exception propagation: %s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+
+static void BusyWork(UINT32 InMicroseconds)
+{
+    const auto End = std::chrono::steady_clock::now() + std::chrono::microseconds(InMicroseconds);
+    while (std::chrono::steady_clock::now() < End) {}
+}
+
+struct FrameShape
+{
+    UINT32 MainPassNum = 16;        // 主Pass链, 每个依赖上一个
+    UINT32 MainPassUs = 150;
+    UINT32 ShadowPassNum = 4;       // 每个阴影Pass是两个Pass的链, 都被光照Pass依赖
+    UINT32 ShadowPassUs = 100;
+    UINT32 ShortTaskNum = 400;      // 剔除, 流式加载等互不依赖的短任务, 最后的呈现Pass依赖它们
+    UINT32 ShortTaskUs = 20;
+};
+
+// 短任务最先添加, 按添加顺序调度时会先于主Pass链执行
+static void BuildFrameFlow(TaskFlow* OutFlow, const FrameShape& InShape, bool bMainPassPriority)
+{
+    std::vector<Task> ShortTasks;
+    for (UINT32 ix = 0; ix < InShape.ShortTaskNum; ++ix)
+    {
+        ShortTasks.push_back(OutFlow->Emplace([&InShape]() { BusyWork(InShape.ShortTaskUs); }));
+    }
+
+    std::vector<Task> MainPasses;
+    for (UINT32 ix = 0; ix < InShape.MainPassNum; ++ix)
+    {
+        MainPasses.push_back(OutFlow->Emplace([&InShape]() { BusyWork(InShape.MainPassUs); }));
+        if (bMainPassPriority) MainPasses.back().SetPriority(1);
+        if (ix > 0) MainPasses[ix - 1].Precede(MainPasses[ix]);
+    }
+
+    const UINT32 LightingPassIndex = InShape.MainPassNum / 4;
+    for (UINT32 ix = 0; ix < InShape.ShadowPassNum; ++ix)
+    {
+        Task ShadowCull = OutFlow->Emplace([&InShape]() { BusyWork(InShape.ShadowPassUs); });
+        Task ShadowDraw = OutFlow->Emplace([&InShape]() { BusyWork(InShape.ShadowPassUs); });
+        ShadowCull.Precede(ShadowDraw);
+        ShadowDraw.Precede(MainPasses[LightingPassIndex]);
+    }
+
+    for (auto& ShortTask : ShortTasks) ShortTask.Precede(MainPasses.back());
+}
+
+static void BenchMakespan(const BenchConfig& InConfig)
+{
+    const FrameShape Shape;
+
+    const double CriticalPathUs = static_cast<double>(Shape.MainPassNum) * Shape.MainPassUs;
+    const double TotalWorkUs = CriticalPathUs + 2.0 * Shape.ShadowPassNum * Shape.ShadowPassUs + static_cast<double>(Shape.ShortTaskNum) * Shape.ShortTaskUs;
+    const double WorkBoundUs = TotalWorkUs / InConfig.ThreadNum;
+    printf_s("%u threads, %u runs\n", InConfig.ThreadNum, InConfig.RunNum);
+    printf_s("Lower bound: %.0f us (critical path %.0f us, total work / threads %.0f us)\n\n", CriticalPathUs > WorkBoundUs ? CriticalPathUs : WorkBoundUs, CriticalPathUs, WorkBoundUs);
+    printf_s("%-36s %12s %12s\n", "Schedule", "Avg(us)", "Max(us)");
+
+    TaskExecutor Executor(InConfig.ThreadNum);
+
+    const auto RunFlow = [&InConfig, &Executor](const char* InName, TaskFlow& InFlow)
+    {
+        double TotalTime = 0.0;
+        double MaxTime = 0.0;
+        for (UINT32 ix = 0; ix < InConfig.RunNum; ++ix)
+        {
+            const auto Begin = std::chrono::steady_clock::now();
+            Executor.Run(InFlow);
+            const double Time = ElapsedMs(Begin) * 1000.0;
+            TotalTime += Time;
+            if (Time > MaxTime) MaxTime = Time;
+        }
+        printf_s("%-36s %12.1f %12.1f\n", InName, TotalTime / InConfig.RunNum, MaxTime);
+    };
+
+    {
+        TaskFlow Flow;
+        BuildFrameFlow(&Flow, Shape, false);
+        RunFlow("Dispatcher thread", Flow);
+    }
+    {
+        TaskFlow Flow;
+        BuildFrameFlow(&Flow, Shape, false);
+        Flow.Compile(false);
+        RunFlow("Compiled, insertion order", Flow);
+    }
+    {
+        TaskFlow Flow;
+        BuildFrameFlow(&Flow, Shape, false);
+        Flow.Compile();
+        RunFlow("Compiled, critical path", Flow);
+    }
+    {
+        TaskFlow Flow;
+        BuildFrameFlow(&Flow, Shape, true);
+        Flow.Compile();
+        RunFlow("Compiled, critical path + priority", Flow);
+    }
+}
+
+
+struct QueueShape
+{
+    UINT32 ProducerNum;
+    UINT32 ConsumerNum;
+};
+
+struct QueueResult
+{
+    double Time = 0.0;
+    UINT64 PoppedNum = 0;
+    UINT64 PoppedSum = 0;
+};
+
+// 生产者推入1~n, 之后每个消费者推入一个0表示结束. InPop()阻塞直到取到一个值
+template <typename P, typename C>
+static QueueResult RunQueue(const QueueShape& InShape, UINT64 InItemNumPerProducer, const P& InPush, const C& InPop)
+{
+    std::atomic<UINT64> PoppedNum = 0;
+    std::atomic<UINT64> PoppedSum = 0;
+
+    const auto Begin = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> Consumers;
+    for (UINT32 ix = 0; ix < InShape.ConsumerNum; ++ix)
+    {
+        Consumers.emplace_back(
+            [&]()
+            {
+                UINT64 Num = 0;
+                UINT64 Sum = 0;
+                while (const UINT64 Value = InPop())
+                {
+                    Num++;
+                    Sum += Value;
+                }
+                PoppedNum.fetch_add(Num, std::memory_order_relaxed);
+                PoppedSum.fetch_add(Sum, std::memory_order_relaxed);
+            }
+        );
+    }
+
+    std::vector<std::thread> Producers;
+    for (UINT32 ix = 0; ix < InShape.ProducerNum; ++ix)
+    {
+        Producers.emplace_back(
+            [&, ix]()
+            {
+                for (UINT64 Item = 0; Item < InItemNumPerProducer; ++Item) InPush(ix * InItemNumPerProducer + Item + 1);
+            }
+        );
+    }
+
+    for (auto& Producer : Producers) Producer.join();
+    for (UINT32 ix = 0; ix < InShape.ConsumerNum; ++ix) InPush(0);
+    for (auto& Consumer : Consumers) Consumer.join();
+
+    QueueResult Result;
+    Result.Time = ElapsedMs(Begin);
+    Result.PoppedNum = PoppedNum.load();
+    Result.PoppedSum = PoppedSum.load();
+    return Result;
+}
+
+static bool BenchQueue(const BenchConfig& InConfig)
+{
+    static constexpr QueueShape Shapes[] = { { 1, 1 }, { 4, 1 }, { 1, 4 }, { 4, 4 }, { 8, 8 } };
+
+    printf_s("%u items per configuration\n\n", InConfig.TaskNum);
+    printf_s("%-28s %10s %10s %10s %10s\n", "Queue", "Producers", "Consumers", "Time(ms)", "ns/item");
+
+    bool bPassed = true;
+    for (const QueueShape& Shape : Shapes)
+    {
+        const UINT64 ItemNumPerProducer = InConfig.TaskNum / Shape.ProducerNum;
+        const UINT64 ItemNum = ItemNumPerProducer * Shape.ProducerNum;
+
+        const auto PrintResult = [&](const char* InName, const QueueResult& InResult)
+        {
+            printf_s("%-28s %10u %10u %10.2f %10.1f\n", InName, Shape.ProducerNum, Shape.ConsumerNum, InResult.Time, InResult.Time * 1e6 / static_cast<double>(ItemNum));
+            if (InResult.PoppedNum != ItemNum || InResult.PoppedSum != ItemNum * (ItemNum + 1) / 2)
+            {
+                printf_s("    FAILED: %llu of %llu items popped\n", InResult.PoppedNum, ItemNum);
+                bPassed = false;
+            }
+        };
+
+        {
+            BoundedMPMCQueue<UINT64> Queue(1024);
+            PrintResult("BoundedMPMCQueue", RunQueue(Shape, ItemNumPerProducer, [&Queue](UINT64 InValue) { Queue.Push(InValue); }, [&Queue]() { return Queue.Pop(); }));
+        }
+        {
+            // 没有阻塞的Pop, 和重写之前的线程池一样空时yield
+            LegacyConcurrentQueue<UINT64> Queue;
+            PrintResult(
+                "LegacyConcurrentQueue",
+                RunQueue(
+                    Shape, ItemNumPerProducer,
+                    [&Queue](UINT64 InValue) { Queue.Push(InValue); },
+                    [&Queue]()
+                    {
+                        UINT64 Value;
+                        while (!Queue.TryPop(Value)) std::this_thread::yield();
+                        return Value;
+                    }
+                )
+            );
+        }
+        if (Shape.ConsumerNum == 1)
+        {
+            LegacyTaskQueue<UINT64> Queue;
+            PrintResult(
+                "LegacyTaskQueue",
+                RunQueue(
+                    Shape, ItemNumPerProducer,
+                    [&Queue](UINT64 InValue) { Queue.Push(InValue); },
+                    [&Queue]()
+                    {
+                        Queue.Wait();
+                        return Queue.Pop();
+                    }
+                )
+            );
+        }
+    }
+
+    printf_s("\n%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf_s("Usage: TaskFlowBench pool [--threads <n>] [--tasks <n>] [--iterations <n>]\n");
+        printf_s("       TaskFlowBench idle [--threads <n>] [--samples <n>] [--gap-us <n>] [--idle-ms <n>]\n");
+        printf_s("       TaskFlowBench flow [--threads <n>] [--nodes <n>] [--runs <n>] [--seed <n>]\n");
+        printf_s("       TaskFlowBench parallel [--threads <n>] [--iterations <n>]\n");
+        printf_s("       TaskFlowBench makespan [--threads <n>] [--runs <n>]\n");
+        printf_s("       TaskFlowBench queue [--tasks <n>]\n");
+        return 1;
+    }
+
+    BenchConfig Config;
+    for (int ix = 2; ix + 1 < argc; ix += 2)
+    {
+        if (strcmp(argv[ix], "--threads") == 0) Config.ThreadNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--tasks") == 0) Config.TaskNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--iterations") == 0) Config.IterationNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--samples") == 0) Config.SampleNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--gap-us") == 0) Config.GapUs = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--idle-ms") == 0) Config.IdleMs = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--nodes") == 0) Config.NodeNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--runs") == 0) Config.RunNum = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+        else if (strcmp(argv[ix], "--seed") == 0) Config.Seed = static_cast<UINT32>(std::atoi(argv[ix + 1]));
+    }
+    if (Config.ThreadNum == 0) Config.ThreadNum = CPUTopology::Get().PhysicalCoreNum;
+    if (Config.ThreadNum == 0) Config.ThreadNum = 1;
+    if (Config.TaskNum == 0 || Config.IterationNum == 0 || Config.SampleNum == 0 || Config.NodeNum == 0 || Config.RunNum == 0)
+    {
+        printf_s("--tasks, --iterations, --samples, --nodes and --runs must be greater than 0.\n");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "pool") == 0)
+    {
+        BenchPool(Config);
+    }
+    else if (strcmp(argv[1], "idle") == 0)
+    {
+        BenchIdle(Config);
+    }
+    else if (strcmp(argv[1], "flow") == 0)
+    {
+        if (!BenchFlow(Config)) return 1;
+    }
+    else if (strcmp(argv[1], "parallel") == 0)
+    {
+        if (!BenchParallel(Config)) return 1;
+    }
+    else if (strcmp(argv[1], "makespan") == 0)
+    {
+        BenchMakespan(Config);
+    }
+    else if (strcmp(argv[1], "queue") == 0)
+    {
+        if (!BenchQueue(Config)) return 1;
+    }
+    else
+    {
+        printf_s("Unknown benchmark %s.\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}